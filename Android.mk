@@ -16,51 +16,185 @@ ifeq ($(TARGET_POWERHAL_VARIANT),tegra)
 
 LOCAL_PATH := $(call my-dir)
 
+# Hint engine, linked into the service and powerhal_replay. It also
+# builds for the host, with the few bionic and HIDL headers it needs
+# shimmed in host/, so it can be run against a fake tree there.
+powerhal_core_src_files := \
+    nvpowerhal.cpp \
+    timeoutpoker.cpp \
+    powerhal_framepacer.cpp \
+    powerhal_config_cache.cpp \
+    powerhal_fan.cpp \
+    powerhal_floor.cpp \
+    powerhal_governor.cpp \
+    powerhal_idle.cpp \
+    powerhal_parser.cpp \
+    powerhal_powercap.cpp \
+    powerhal_props.cpp \
+    powerhal_reload.cpp \
+    powerhal_residency.cpp \
+    powerhal_resource.cpp \
+    powerhal_session.cpp \
+    powerhal_thermal.cpp \
+    powerhal_utils.cpp
+
+powerhal_core_shared_libraries := \
+    liblog \
+    libcutils \
+    libutils \
+    libexpat
+
+# T124+ uses set interactive. Revist if <= T114 is brought back
+powerhal_cflags := -DPOWER_MODE_SET_INTERACTIVE
+powerhal_cflags += -DTARGET_TEGRA_VERSION=$(TARGET_TEGRA_VERSION:t=)
+
+# Resolve all sysfs, dev and config paths below another root, see
+# powerhal_utils.h. POWERHAL_ROOT in the environment overrides this.
+ifneq ($(TARGET_POWERHAL_ROOT),)
+    powerhal_cflags += -DPOWERHAL_ROOT=\"$(TARGET_POWERHAL_ROOT)\"
+endif
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := libpowerhal_core
+LOCAL_SRC_FILES := $(powerhal_core_src_files)
+LOCAL_SHARED_LIBRARIES := \
+    $(powerhal_core_shared_libraries) \
+    libhardware \
+    libhidlbase \
+    vendor.nvidia.hardware.power@1.0
+LOCAL_EXPORT_SHARED_LIBRARY_HEADERS := vendor.nvidia.hardware.power@1.0
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
+LOCAL_CFLAGS := $(powerhal_cflags)
+
+# Without the vendor PHS daemon, serve its client API in-process
+ifeq ($(TARGET_TEGRA_PHS),nvphs)
+    LOCAL_SHARED_LIBRARIES += libnvphs
+else
+    LOCAL_SRC_FILES += powerhal_phs.cpp
+    LOCAL_CFLAGS += -DUSE_LOCAL_PHS
+endif
+
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_OWNER := nvidia
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := libpowerhal_core
+LOCAL_SRC_FILES := $(powerhal_core_src_files) powerhal_phs.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_HEADER_LIBRARIES := libhardware_headers
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/host
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH) $(LOCAL_PATH)/host
+LOCAL_EXPORT_HEADER_LIBRARY_HEADERS := libhardware_headers
+LOCAL_CFLAGS := $(powerhal_cflags) -DUSE_LOCAL_PHS
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_STATIC_LIBRARY)
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := vendor.nvidia.hardware.power@1.0-service
 LOCAL_INIT_RC := vendor.nvidia.hardware.power@1.0-service.rc
 LOCAL_VINTF_FRAGMENTS := vendor.nvidia.hardware.power@1.0-service.xml
 
 LOCAL_SHARED_LIBRARIES := \
+    $(powerhal_core_shared_libraries) \
     libhardware \
     libhidlbase \
-    liblog \
-    libcutils \
-    libutils \
     libdl \
-    libexpat \
     vendor.nvidia.hardware.power@1.0
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
+
+ifeq ($(TARGET_TEGRA_PHS),nvphs)
+    LOCAL_SHARED_LIBRARIES += libnvphs
+endif
 
 LOCAL_SRC_FILES := \
     service.cpp \
     Power.cpp \
-    nvpowerhal.cpp \
-    timeoutpoker.cpp \
-    powerhal_parser.cpp \
-    powerhal_utils.cpp \
+    powerhal_trace.cpp \
     tegra_sata_hal.cpp
 
-ifeq ($(TARGET_TEGRA_VERSION),t210)
-    LOCAL_SRC_FILES += power_floor_t210.cpp
-endif
-
-ifeq ($(TARGET_TEGRA_VERSION), $(filter $(TARGET_TEGRA_VERSION), ap20 t30 t114 t148))
-    LOCAL_CFLAGS += -DGPU_IS_LEGACY
-endif
+LOCAL_CFLAGS := $(powerhal_cflags)
 
-# T124+ uses set interactive. Revist if <= T114 is brought back
-LOCAL_CFLAGS += -DPOWER_MODE_SET_INTERACTIVE
-LOCAL_CFLAGS += -DTARGET_TEGRA_VERSION=$(TARGET_TEGRA_VERSION:t=)
+LOCAL_MODULE_RELATIVE_PATH := hw
+LOCAL_MODULE_TAGS := optional
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_OWNER := nvidia
+include $(BUILD_EXECUTABLE)
 
+# Replays a recorded hint trace, see powerhal_trace.h
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_replay
+LOCAL_SRC_FILES := powerhal_replay.cpp
+LOCAL_SHARED_LIBRARIES := \
+    $(powerhal_core_shared_libraries) \
+    libhardware \
+    libhidlbase \
+    vendor.nvidia.hardware.power@1.0
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
 ifeq ($(TARGET_TEGRA_PHS),nvphs)
-    LOCAL_CFLAGS += -DUSE_NVPHS
     LOCAL_SHARED_LIBRARIES += libnvphs
 endif
-
-LOCAL_MODULE_RELATIVE_PATH := hw
+LOCAL_CFLAGS := $(powerhal_cflags)
 LOCAL_MODULE_TAGS := optional
 LOCAL_VENDOR_MODULE := true
 LOCAL_MODULE_OWNER := nvidia
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_replay
+LOCAL_SRC_FILES := powerhal_replay.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
+LOCAL_CFLAGS := $(powerhal_cflags)
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_EXECUTABLE)
+
+# Offline checker for powerhal XML configs, see powerhal_check.cpp
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_check
+LOCAL_SRC_FILES := powerhal_check.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
+LOCAL_CFLAGS := $(powerhal_cflags)
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_EXECUTABLE)
+
+# Host tests against a fake tree, see tests/fake_root.h
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_stress_test
+LOCAL_SRC_FILES := tests/powerhal_stress_test.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
+LOCAL_CFLAGS := $(powerhal_cflags)
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_powercap_test
+LOCAL_SRC_FILES := tests/powerhal_powercap_test.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
+LOCAL_CFLAGS := $(powerhal_cflags)
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_check_test
+LOCAL_SRC_FILES := tests/powerhal_check_test.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_STATIC_LIBRARIES := libpowerhal_core
+LOCAL_CFLAGS := $(powerhal_cflags)
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_NATIVE_TEST)
+
+# Hint engine benchmarks, see tests/powerhal_benchmark.cpp
+include $(CLEAR_VARS)
+LOCAL_MODULE := powerhal_benchmark
+LOCAL_SRC_FILES := tests/powerhal_benchmark.cpp
+LOCAL_SHARED_LIBRARIES := $(powerhal_core_shared_libraries)
+LOCAL_STATIC_LIBRARIES := libpowerhal_core libgoogle-benchmark
+LOCAL_CFLAGS := $(powerhal_cflags)
+LOCAL_MODULE_HOST_OS := linux
+include $(BUILD_HOST_EXECUTABLE)
+
 endif # TARGET_POWERHAL_VARIANT == tegra
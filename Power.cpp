@@ -25,6 +25,9 @@
 #include <android/log.h>
 #include <utils/Log.h>
 #include "Power.h"
+#include "powerhal_residency.h"
+#include "powerhal_session.h"
+#include "powerhal_trace.h"
 #include "tegra_sata_hal.h"
 
 namespace vendor {
@@ -37,7 +40,10 @@ namespace implementation {
 using ::android::hardware::power::V1_0::Feature;
 using ::android::hardware::power::V1_0::PowerHint;
 using ::android::hardware::power::V1_0::PowerStatePlatformSleepState;
+using ::android::hardware::power::V1_0::PowerStateVoter;
 using ::android::hardware::power::V1_0::Status;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
@@ -52,25 +58,37 @@ Power::Power() {
 
     pInfo->no_sclk_boost = true;
 
+    trace_open();
+    common_power_open(pInfo);
     common_power_init(pInfo);
+
+    idleStats = new IdleStats();
 }
 
 // Methods from ::vendor::nvidia::hardware::power::V1_0::IPower follow.
 Return<void> Power::powerHintExt(ExtPowerHint hint, const hidl_vec<int32_t>& data) {
-    common_power_hint(pInfo, hint, static_cast<const void*>(data.data()));
+    trace_record(TRACE_POWER_HINT_EXT, static_cast<int32_t>(hint), data.data(), data.size());
+
+    if (is_session_hint(hint)) {
+        common_power_session_hint(pInfo, hint, data.data(), data.size());
+        return Void();
+    }
+
+    common_power_hint(pInfo, hint, static_cast<const void*>(data.data()), data.size());
     return Void();
 }
 
 
 // Methods from ::android::hardware::power::V1_0::IPower follow.
 Return<void> Power::setInteractive(bool interactive)  {
-    common_power_set_interactive(pInfo, interactive ? 1 : 0);
+    int32_t on = interactive ? 1 : 0;
+
+    trace_record(TRACE_SET_INTERACTIVE, 0, &on, 1);
+    common_power_set_interactive(pInfo, on);
 
-#if TARGET_TEGRA_VERSION == 210
-    set_power_level_floor(interactive);
-#endif
+    set_power_level_floor(pInfo, interactive);
 
-    if (!access(SATA_POWER_CONTROL_PATH, F_OK)) {
+    if (!root_access(SATA_POWER_CONTROL_PATH, F_OK)) {
         /*
         * Turn-off Foster HDD at display off
         */
@@ -92,7 +110,8 @@ Return<void> Power::setInteractive(bool interactive)  {
 }
 
 Return<void> Power::powerHint(PowerHint hint, int32_t data) {
-    common_power_hint(pInfo, static_cast<ExtPowerHint>(hint), &data);
+    trace_record(TRACE_POWER_HINT, static_cast<int32_t>(hint), &data, 1);
+    common_power_hint(pInfo, static_cast<ExtPowerHint>(hint), &data, 1);
     return Void();
 }
 
@@ -111,11 +130,58 @@ Return<void> Power::setFeature(Feature feature, __attribute__ ((unused)) bool ac
 
 Return<void> Power::getPlatformLowPowerStats(getPlatformLowPowerStats_cb _hidl_cb) {
     hidl_vec<PowerStatePlatformSleepState> states;
-    states.resize(0);
+    std::vector<idle_state_t> idle;
+
+    idleStats->read(idle);
+
+    states.resize(idle.size());
+    for (size_t i = 0; i < idle.size(); i++) {
+        PowerStatePlatformSleepState &state = states[i];
+
+        state.name = idle[i].name;
+        state.residencyInMsecSinceBoot = idle[i].residency_ms;
+        state.totalTransitions = idle[i].transitions;
+        state.supportedOnlyInSuspend = false;
+
+        state.voters.resize(idle[i].voters.size());
+        for (size_t j = 0; j < idle[i].voters.size(); j++) {
+            PowerStateVoter &voter = state.voters[j];
+
+            voter.name = idle[i].voters[j].name;
+            voter.totalTimeInMsVoting = idle[i].voters[j].time_ms;
+            voter.totalNumberOfTimesVotedSinceBoot = idle[i].voters[j].usage;
+        }
+    }
+
     _hidl_cb(states, Status::SUCCESS);
     return Void();
 }
 
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+Return<void> Power::debug(const hidl_handle& fd, __attribute__ ((unused)) const hidl_vec<hidl_string>& options) {
+    std::string out;
+    size_t done = 0;
+
+    if (fd == nullptr || fd->numFds < 1)
+        return Void();
+
+    common_power_dump(pInfo, out);
+    residency_dump(out);
+
+    while (done < out.size()) {
+        ssize_t ret = write(fd->data[0], out.data() + done, out.size() - done);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("Error writing debug output: %s", strerror(errno));
+            break;
+        }
+        done += ret;
+    }
+
+    return Void();
+}
+
 status_t Power::registerAsSystemService() {
     status_t ret = 0;
 
@@ -23,6 +23,7 @@
 #include <hidl/Status.h>
 #include <hardware/power.h>
 #include "powerhal.h"
+#include "powerhal_idle.h"
 
 namespace vendor {
 namespace nvidia {
@@ -33,6 +34,8 @@ namespace implementation {
 
 using ::android::hardware::power::V1_0::Feature;
 using ::android::hardware::power::V1_0::PowerHint;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
@@ -40,6 +43,7 @@ using ::vendor::nvidia::hardware::power::V1_0::ExtPowerHint;
 
 struct Power : public IPower {
     struct powerhal_info *pInfo;
+    IdleStats *idleStats;
 
     // Methods from ::vendor::nvidia::hardware::power::V1_0::IPower follow.
 
@@ -57,6 +61,8 @@ struct Power : public IPower {
 
     // Methods from ::android::hidl::base::V1_0::IBase follow.
 
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
+
 };
 
 }  // namespace implementation
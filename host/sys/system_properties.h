@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Host shim for the bionic property API, backed by libcutils. */
+#ifndef POWER_HAL_HOST_SYSTEM_PROPERTIES_H
+#define POWER_HAL_HOST_SYSTEM_PROPERTIES_H
+
+#include <stdint.h>
+#include <cutils/properties.h>
+
+#define PROP_VALUE_MAX PROPERTY_VALUE_MAX
+
+static inline int __system_property_get(const char *name, char *value)
+{
+    return property_get(name, value, "");
+}
+
+/* Host properties never change, so nothing is ever found and the area
+ * never grows: CachedProperty reads each one once through libcutils, and
+ * the watcher stops at its first wait. */
+typedef struct prop_info prop_info;
+
+static inline const prop_info *__system_property_find(__attribute__((unused)) const char *name)
+{
+    return NULL;
+}
+
+static inline uint32_t __system_property_serial(__attribute__((unused)) const prop_info *pi)
+{
+    return 0;
+}
+
+static inline void __system_property_read_callback(__attribute__((unused)) const prop_info *pi,
+        __attribute__((unused)) void (*callback)(void *cookie, const char *name,
+                                                 const char *value, uint32_t serial),
+        __attribute__((unused)) void *cookie)
+{
+}
+
+static inline uint32_t __system_property_area_serial(void)
+{
+    return 0;
+}
+
+static inline bool __system_property_wait(__attribute__((unused)) const prop_info *pi,
+        __attribute__((unused)) uint32_t old_serial,
+        __attribute__((unused)) uint32_t *new_serial_ptr,
+        __attribute__((unused)) const struct timespec *relative_timeout)
+{
+    return false;
+}
+
+#endif  // POWER_HAL_HOST_SYSTEM_PROPERTIES_H
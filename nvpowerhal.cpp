@@ -20,13 +20,26 @@
 #include <hardware/power.h>
 #include <sys/system_properties.h>
 
-#include "powerhal_parser.h"
-#include "powerhal_utils.h"
-#include "powerhal.h"
+#include <algorithm>
+#include <math.h>
 
-#ifdef USE_NVPHS
 #include "phs.h"
+#include "powerhal_fan.h"
+#include "powerhal_floor.h"
+#include "powerhal_framepacer.h"
+#include "powerhal_governor.h"
+#include "powerhal_parser.h"
+#include "powerhal_powercap.h"
+#include "powerhal_props.h"
+#include "powerhal_reload.h"
+#include "powerhal_residency.h"
+#ifdef USE_LOCAL_PHS
+#include "powerhal_phs.h"
 #endif
+#include "powerhal_session.h"
+#include "powerhal_thermal.h"
+#include "powerhal_utils.h"
+#include "powerhal.h"
 
 using ::vendor::nvidia::hardware::power::V1_0::AppProfileKnob;
 using ::vendor::nvidia::hardware::power::V1_0::ExtPowerHint;
@@ -34,14 +47,22 @@ using ::vendor::nvidia::hardware::power::V1_0::NvCPLHintData;
 
 #ifdef POWER_MODE_SET_INTERACTIVE
 static NvCPLHintData get_system_power_mode(void);
-static void set_interactive_governor(NvCPLHintData mode);
+static void on_power_mode_changed(void *data);
 
-std::map<NvCPLHintData,interactive_data_t> interactive_data_array;
+// Read on every screen on and watched, see powerhal_props.h
+static CachedProperty power_mode_prop("persist.sys.NV_POWER_MODE");
+static CachedProperty eco_state_prop("persist.sys.NV_ECO.STATE.ISECO");
 #endif
 
+#define INTERACTIVE_TUNABLES_PATH "/sys/devices/system/cpu/cpufreq/interactive"
+
 // CPU/EMC ratio table source sysfs
 #define CPU_EMC_RATIO_SRC_NODE "/sys/kernel/tegra_cpu_emc/table_src"
 
+// VIDEO_ENCODE workload (width * height * fps) that gets the full
+// configured floors and holds them until the encode stops
+#define VIDEO_ENCODE_FULL_WORKLOAD (3840 * 2160 * 30)
+
 static void find_input_device_ids(struct powerhal_info *pInfo)
 {
     int i = 0;
@@ -52,7 +73,7 @@ static void find_input_device_ids(struct powerhal_info *pInfo)
     while (1)
     {
         snprintf(path, sizeof(path), "/sys/class/input/input%d/name", i);
-        if (access(path, F_OK) < 0)
+        if (root_access(path, F_OK) < 0)
             break;
         else {
             memset(name, 0, MAX_CHARS);
@@ -77,16 +98,22 @@ static void find_input_device_ids(struct powerhal_info *pInfo)
     }
 }
 
-static int check_hint(struct powerhal_info *pInfo, ExtPowerHint hint, uint64_t *t)
+static void log_backend(const char *resource, ResourceBackend *backend)
 {
-    struct timespec ts;
-    uint64_t time;
+    if (backend)
+        ALOGI("%s: %s backend at %s", resource, backend->type(), backend->path());
+    else
+        ALOGW("%s: no control interface found, hints will not apply", resource);
+}
 
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    time = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+static int check_hint(struct powerhal_info *pInfo, const hint_config_t *config,
+                      ExtPowerHint hint, uint64_t *t)
+{
+    uint64_t time = ns2ms(powerhal_time());
+    auto interval = config->hint_interval.find(hint);
 
-    if (pInfo->hint_time[hint] && pInfo->hint_interval[hint] &&
-        (time - pInfo->hint_time[hint] < pInfo->hint_interval[hint]))
+    if (pInfo->hint_time[hint] && interval != config->hint_interval.end() &&
+        interval->second && (time - pInfo->hint_time[hint] < interval->second))
         return -1;
 
     *t = time;
@@ -114,6 +141,9 @@ static void init_default_cpu_hints(std::map<ExtPowerHint,power_hint_data_t>& hin
     hints[ExtPowerHint::VIDEO_DECODE] = {       710000,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 1000};
+    hints[ExtPowerHint::VIDEO_ENCODE] = {       816000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1000};
     hints[ExtPowerHint::MIRACAST] = {           816000,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 1000};
@@ -133,6 +163,10 @@ static void init_default_cpu_hints(std::map<ExtPowerHint,power_hint_data_t>& hin
     hints[ExtPowerHint::VSYNC] = {              300000,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 1};
+    // CAMERA floor is held for the camera session, duration is ignored
+    hints[ExtPowerHint::CAMERA] = {             816000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1};
 }
 
 static void init_default_gpu_hints(std::map<ExtPowerHint,power_hint_data_t>& hints)
@@ -149,6 +183,13 @@ static void init_default_gpu_hints(std::map<ExtPowerHint,power_hint_data_t>& hin
     hints[ExtPowerHint::DISPLAY_ROTATION] = {   252000,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 2000};
+    hints[ExtPowerHint::CAMERA] = {             180000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1};
+    // VSYNC sets the top of the frame pacing range, duration is ignored
+    hints[ExtPowerHint::VSYNC] = {              540000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1};
 }
 
 static void init_default_emc_hints(std::map<ExtPowerHint,power_hint_data_t>& hints)
@@ -168,6 +209,16 @@ static void init_default_emc_hints(std::map<ExtPowerHint,power_hint_data_t>& hin
     hints[ExtPowerHint::AUDIO_LOW_LATENCY] = {  300000,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 1000};
+    hints[ExtPowerHint::VIDEO_ENCODE] = {       792000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1000};
+    hints[ExtPowerHint::CAMERA] = {             408000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1};
+    // VSYNC sets the top of the frame pacing range, duration is ignored
+    hints[ExtPowerHint::VSYNC] = {              792000,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1};
 }
 
 static void init_default_online_cpu_hints(std::map<ExtPowerHint,power_hint_data_t>& hints)
@@ -193,6 +244,9 @@ static void init_default_online_cpu_hints(std::map<ExtPowerHint,power_hint_data_
     hints[ExtPowerHint::VIDEO_DECODE] = {       1,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 1000};
+    hints[ExtPowerHint::VIDEO_ENCODE] = {       2,
+                                                PM_QOS_DEFAULT_VALUE,
+                                                1000};
     hints[ExtPowerHint::DISPLAY_ROTATION] = {   2,
                                                 PM_QOS_DEFAULT_VALUE,
                                                 2000};
@@ -218,6 +272,9 @@ static void init_default_hint_intervals(struct powerhal_info *pInfo)
     pInfo->hint_interval[ExtPowerHint::AUDIO_LOW_LATENCY] = 500;
     pInfo->hint_interval[ExtPowerHint::DISPLAY_ROTATION]  = 200;
     pInfo->hint_interval[ExtPowerHint::POWER_MODE]        = 0;
+    pInfo->hint_interval[ExtPowerHint::CAMERA]            = 0;
+    pInfo->hint_interval[ExtPowerHint::VIDEO_ENCODE]      = 0;
+    pInfo->hint_interval[ExtPowerHint::FRAMERATE_DATA]    = 0;
 }
 
 static void init_default_hint_parameters(struct powerhal_info *pInfo)
@@ -232,6 +289,49 @@ static void init_default_hint_parameters(struct powerhal_info *pInfo)
     init_default_hint_intervals(pInfo);
 }
 
+#if TARGET_TEGRA_VERSION == 124 || TARGET_TEGRA_VERSION == 210
+static const char *interactive_tunables[] = {
+    "hispeed_freq",
+    "target_loads",
+    "above_hispeed_delay",
+    "timer_rate",
+    "boost_factor",
+    "min_sample_time",
+    "go_hispeed_load",
+};
+
+/* By NvCPLHintData, in interactive_tunables order */
+static const char *interactive_profiles[GOVERNOR_MODE_COUNT][ARRAY_SIZE(interactive_tunables)] = {
+#if TARGET_TEGRA_VERSION == 124
+    { "624000",  "65 224000:75 624000:85", "19000",  "20000", "0", "41000", "90" },
+    { "510000",  "65 256000:75 510000:85", "19000", "300000", "0", "30000", "99" },
+    { "420000",  "45 312000:75 564000:85", "80000", "300000", "2", "30000", "99" },
+    { "510000",  "65 256000:75 510000:85", "19000", "300000", "0", "30000", "99" },
+    { "420000",  "80",                     "80000", "300000", "2", "30000", "99" },
+#else
+    { "1122000", "65 304000:75 1122000:80", "19000",  "20000", "0", "41000", "90" },
+    { "1020000", "65 256000:75 1020000:80", "19000",  "20000", "0", "30000", "99" },
+    {  "640000", "65 256000:75 640000:80",  "80000",  "20000", "2", "30000", "99" },
+    { "1020000", "65 256000:75 1020000:80", "19000",  "20000", "0", "30000", "99" },
+    {  "420000", "80",                      "80000", "300000", "2", "30000", "99" },
+#endif
+};
+#endif
+
+static void init_default_governor_profiles(struct powerhal_info *pInfo)
+{
+#if TARGET_TEGRA_VERSION == 124 || TARGET_TEGRA_VERSION == 210
+    pInfo->governor_profiles.governor = "interactive";
+    pInfo->governor_profiles.path = INTERACTIVE_TUNABLES_PATH;
+    for (int mode = 0; mode < GOVERNOR_MODE_COUNT; mode++)
+        for (size_t i = 0; i < ARRAY_SIZE(interactive_tunables); i++)
+            pInfo->governor_profiles.modes[mode].push_back(
+                    {interactive_tunables[i], interactive_profiles[mode][i]});
+#else // No other platforms have built-in tuning data
+    (void)pInfo;
+#endif
+}
+
 static void init_hint_parameters(struct powerhal_info *pInfo)
 {
     int ret = -1;
@@ -271,13 +371,14 @@ void common_power_open(struct powerhal_info *pInfo)
     readyToRun.wait();
 
     init_hint_parameters(pInfo);
+    hint_config_publish(pInfo, hint_config_take(pInfo));
     find_input_device_ids(pInfo);
 
     // Read available frequencies
     char *buf = (char*)malloc(sizeof(char) * size);
 
     for (auto &cpu_cluster : pInfo->cpu_clusters) {
-        if (access(cpu_cluster.available_freqs_path, R_OK)) {
+        if (root_access(cpu_cluster.available_freqs_path, R_OK)) {
             ALOGW("Cannot access %s. Certain power hints may not work!",
                         cpu_cluster.available_freqs_path);
             cpu_cluster.num_available_frequencies = 0;
@@ -308,6 +409,52 @@ void common_power_open(struct powerhal_info *pInfo)
         }
     }
 
+    // Pick a control interface for every resource
+    for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cpu_cluster = pInfo->cpu_clusters[i];
+        std::string name = "cpu" + std::to_string(i);
+        std::string stats;
+
+        cpu_cluster.backend = probe_cpu_backend(pInfo->mTimeoutPoker,
+                                                cpu_cluster.pmqos_constraint_path,
+                                                cpu_cluster.available_freqs_path);
+        log_backend("cpu", cpu_cluster.backend);
+
+        // cpufreq stats live next to the frequency table
+        if (cpu_cluster.available_freqs_path) {
+            stats = cpu_cluster.available_freqs_path;
+            stats = stats.substr(0, stats.rfind('/')) + "/stats/time_in_state";
+        }
+        residency_register(cpu_cluster.backend, name.c_str(),
+                           stats.empty() ? NULL : stats.c_str());
+    }
+    pInfo->resources.gpu = probe_gpu_backend(pInfo->mTimeoutPoker);
+    log_backend("gpu", pInfo->resources.gpu);
+    residency_register(pInfo->resources.gpu, "gpu", NULL);
+    pInfo->resources.emc = probe_emc_backend(pInfo->mTimeoutPoker);
+    log_backend("emc", pInfo->resources.emc);
+    residency_register(pInfo->resources.emc, "emc", NULL);
+    pInfo->resources.online_cpus = probe_online_cpus_backend(pInfo->mTimeoutPoker);
+    log_backend("online_cpus", pInfo->resources.online_cpus);
+    residency_register(pInfo->resources.online_cpus, "online_cpus", NULL);
+
+    // Touch boost uses one held request per resource
+    for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++)
+        if (pInfo->cpu_clusters[i].backend)
+            pInfo->interaction_boosts.push_back({pInfo->cpu_clusters[i].backend,
+                    HINT_TABLE_CPU, (int)i, -1, 0, 0});
+    if (pInfo->resources.gpu)
+        pInfo->interaction_boosts.push_back({pInfo->resources.gpu,
+                HINT_TABLE_GPU, -1, -1, 0, 0});
+    if (pInfo->resources.emc)
+        pInfo->interaction_boosts.push_back({pInfo->resources.emc,
+                HINT_TABLE_EMC, -1, -1, 0, 0});
+    if (pInfo->resources.online_cpus)
+        pInfo->interaction_boosts.push_back({pInfo->resources.online_cpus,
+                HINT_TABLE_ONLINE_CPUS, -1, -1, 0, 0});
+    pInfo->interaction_timer_generation = 0;
+    pInfo->interaction_timer_time = 0;
+
     // Initialize AppProfile defaults
     pInfo->defaults.min_freq = 0;
     pInfo->defaults.max_freq = PM_QOS_DEFAULT_VALUE;
@@ -315,42 +462,276 @@ void common_power_open(struct powerhal_info *pInfo)
     pInfo->defaults.gpu_cap = PM_QOS_DEFAULT_VALUE;
     pInfo->defaults.fan_cap = 70;
     pInfo->defaults.power_cap = 0;
+    pInfo->governor = NULL;
+    pInfo->platform_floor = NULL;
+    pInfo->thermal = NULL;
+    pInfo->fan_curve = NULL;
+    pInfo->power_cap = NULL;
 
     // Initialize fds
     for (auto &cpu_cluster : pInfo->cpu_clusters) {
         cpu_cluster.fd_app_min_freq = -1;
         cpu_cluster.fd_app_max_freq = -1;
-        cpu_cluster.fd_vsync_min_freq = -1;
+        cpu_cluster.fd_camera_min_freq = -1;
+        cpu_cluster.fd_encode_min_freq = -1;
     }
     pInfo->fds.app_max_online_cpus = -1;
     pInfo->fds.app_min_online_cpus = -1;
     pInfo->fds.app_max_gpu = -1;
     pInfo->fds.app_min_gpu = -1;
+    pInfo->fds.camera_gpu = -1;
+    pInfo->fds.camera_emc = -1;
+    pInfo->fds.encode_gpu = -1;
+    pInfo->fds.encode_emc = -1;
+    pInfo->fds.encode_online_cpus = -1;
+    pInfo->encode_workload = 0;
 
     // Initialize features
-    pInfo->features.fan = sysfs_exists("/sys/devices/platform/pwm-fan/pwm_cap");
+    pInfo->features.fan = sysfs_exists(FAN_PWM_CAP_NODE);
+
+    pInfo->frame_pacer = new FramePacer(pInfo);
+    pInfo->sessions = new HintSessionManager(pInfo);
+#ifdef USE_LOCAL_PHS
+    powerhal_phs_init(pInfo);
+#endif
+
+    config_reload_init(pInfo);
 
     free(buf);
 }
 
-static void set_vsync_min_cpu_freq(struct powerhal_info *pInfo, int enabled)
+/* Holds the hint's range until released, its min lowered by the thermal
+ * policy for a thermal_resource. A held range is only placed again when
+ * refresh is set, and nothing new is held then. Resources with no entry
+ * for the hint are left alone. */
+static void hold_hint_request(struct powerhal_info *pInfo, ResourceBackend *backend,
+                              const hint_map_t& hints, ExtPowerHint hint,
+                              int resource, int top, bool refresh, int *handle)
 {
-    if (enabled) {
-        for (auto &cpu_cluster : pInfo->cpu_clusters)
-            if (cpu_cluster.fd_vsync_min_freq == -1)
-                cpu_cluster.fd_vsync_min_freq =
-                pInfo->mTimeoutPoker->requestPmQos(cpu_cluster.pmqos_constraint_path,
-                                    PM_QOS_BOOST_PRIORITY, PM_QOS_DEFAULT_VALUE,
-                                    cpu_cluster.hints[ExtPowerHint::VSYNC].min);
+    const power_hint_data_t *data = hint_find(hints, hint);
+
+    if (!data || (refresh ? *handle < 0 : *handle >= 0))
+        return;
+
+    resource_update(backend, handle, PM_QOS_BOOST_PRIORITY, data->max,
+                    thermal_boost_min(pInfo, resource, data->min, top));
+}
+
+/* Must be called with media_lock held */
+static void hold_camera_floors(struct powerhal_info *pInfo, const hint_config_t *config,
+                               bool refresh)
+{
+    for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cpu_cluster = pInfo->cpu_clusters[i];
+
+        hold_hint_request(pInfo, cpu_cluster.backend, config->cpu_hints[i],
+                          ExtPowerHint::CAMERA, THERMAL_CPU, cluster_freq_top(&cpu_cluster),
+                          refresh, &cpu_cluster.fd_camera_min_freq);
+    }
+    hold_hint_request(pInfo, pInfo->resources.gpu, config->gpu_freq_hints,
+                      ExtPowerHint::CAMERA, THERMAL_GPU, 0, refresh, &pInfo->fds.camera_gpu);
+    hold_hint_request(pInfo, pInfo->resources.emc, config->emc_freq_hints,
+                      ExtPowerHint::CAMERA, THERMAL_EMC, 0, refresh, &pInfo->fds.camera_emc);
+}
+
+static void set_camera_floors(struct powerhal_info *pInfo, const hint_config_t *config, int on)
+{
+    Mutex::Autolock _l(pInfo->media_lock);
+
+    if (on) {
+        hold_camera_floors(pInfo, config, false);
     } else {
         for (auto &cpu_cluster : pInfo->cpu_clusters)
-            if (cpu_cluster.fd_vsync_min_freq >= 0) {
-                close(cpu_cluster.fd_vsync_min_freq);
-                cpu_cluster.fd_vsync_min_freq = -1;
-            }
+            resource_release(cpu_cluster.backend, &cpu_cluster.fd_camera_min_freq);
+        resource_release(pInfo->resources.gpu, &pInfo->fds.camera_gpu);
+        resource_release(pInfo->resources.emc, &pInfo->fds.camera_emc);
     }
 
-    ALOGV("%s: set min CPU floor =%i", __func__, pInfo->cpu_clusters[0].hints[ExtPowerHint::VSYNC].min);
+    ALOGV("%s: camera floors %s", __func__, on ? "held" : "released");
+}
+
+/* Scales a floor down to a fraction of the full encode workload,
+ * rounding up so that small encodes still get some headroom. */
+static int scale_to_encode_workload(int value, int64_t workload)
+{
+    if (value <= 0 || value == INT_MAX || workload >= VIDEO_ENCODE_FULL_WORKLOAD)
+        return value;
+
+    return (int)((value * workload + VIDEO_ENCODE_FULL_WORKLOAD - 1) /
+                 VIDEO_ENCODE_FULL_WORKLOAD);
+}
+
+std::shared_ptr<const hint_config_t> hint_config_get(const struct powerhal_info *pInfo)
+{
+    return std::atomic_load(&pInfo->config);
+}
+
+hint_config_t *hint_config_take(struct powerhal_info *staging)
+{
+    hint_config_t *config = new hint_config_t();
+
+    for (auto &cluster : staging->cpu_clusters) {
+        config->cpu_hints.push_back(std::move(cluster.hints));
+        cluster.hints.clear();
+    }
+    config->gpu_freq_hints.swap(staging->gpu_freq_hints);
+    config->emc_freq_hints.swap(staging->emc_freq_hints);
+    config->online_cpu_hints.swap(staging->online_cpu_hints);
+    config->hint_interval.swap(staging->hint_interval);
+
+    return config;
+}
+
+int hint_config_publish(struct powerhal_info *pInfo, hint_config_t *config)
+{
+    std::shared_ptr<const hint_config_t> next(config);
+
+    if (config->cpu_hints.size() != pInfo->cpu_clusters.size()) {
+        ALOGE("Hint config has %zu clusters, expected %zu",
+              config->cpu_hints.size(), pInfo->cpu_clusters.size());
+        return -1;
+    }
+
+    // Readers still holding the old config keep it alive until they finish
+    std::atomic_store(&pInfo->config, next);
+    return 0;
+}
+
+const power_hint_data_t *hint_find(const hint_map_t& hints, ExtPowerHint hint)
+{
+    auto it = hints.find(hint);
+
+    return it == hints.end() ? NULL : &it->second;
+}
+
+int cluster_freq_ceil(const cpu_cluster_data_t *cluster, int freq)
+{
+    for (int i = 0; i < cluster->num_available_frequencies; i++)
+        if (cluster->available_frequencies[i] >= freq)
+            return cluster->available_frequencies[i];
+
+    return freq;
+}
+
+int cluster_freq_floor(const cpu_cluster_data_t *cluster, int freq)
+{
+    for (int i = cluster->num_available_frequencies - 1; i > 0; i--)
+        if (cluster->available_frequencies[i] <= freq)
+            return cluster->available_frequencies[i];
+
+    return cluster->num_available_frequencies > 0 ? cluster->available_frequencies[0] : freq;
+}
+
+int cluster_freq_top(const cpu_cluster_data_t *cluster)
+{
+    if (cluster->num_available_frequencies <= 0)
+        return 0;
+    return cluster->available_frequencies[cluster->num_available_frequencies - 1];
+}
+
+int cluster_freq_at(const cpu_cluster_data_t *cluster, float position)
+{
+    int count = cluster->num_available_frequencies;
+    int index;
+
+    if (count <= 0 || position <= 0)
+        return 0;
+
+    index = (int)ceilf(std::min(position, 1.0f) * (count - 1));
+    return index > 0 ? cluster->available_frequencies[index] : 0;
+}
+
+/* Applies the VIDEO_ENCODE entry scaled to the workload. Full-size
+ * encodes hold it on handle for the session, smaller ones get a timed
+ * boost. With refresh set only a range held on handle is placed again. */
+static void apply_encode_request(ResourceBackend *backend, const power_hint_data_t *hint,
+                                 int min, bool session, bool refresh, int *handle)
+{
+    if (refresh) {
+        if (*handle >= 0)
+            resource_update(backend, handle, PM_QOS_BOOST_PRIORITY, hint->max, min);
+    } else if (session) {
+        *handle = resource_request(backend, PM_QOS_BOOST_PRIORITY, hint->max, min);
+    } else {
+        resource_request_timed(backend, PM_QOS_BOOST_PRIORITY, hint->max, min,
+                               hint->time_ms);
+    }
+}
+
+/* Must be called with media_lock held. Places the VIDEO_ENCODE floors
+ * for pInfo->encode_workload, their mins lowered by the thermal policy. */
+static void apply_encode_floors(struct powerhal_info *pInfo, const hint_config_t *config,
+                                bool refresh)
+{
+    const power_hint_data_t *hint;
+    int workload = pInfo->encode_workload;
+    bool session = workload >= VIDEO_ENCODE_FULL_WORKLOAD;
+
+    for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cpu_cluster = pInfo->cpu_clusters[i];
+
+        hint = hint_find(config->cpu_hints[i], ExtPowerHint::VIDEO_ENCODE);
+        if (!hint)
+            continue;
+        int min = hint->min;
+        if (cpu_cluster.num_available_frequencies > 0)
+            min = std::min(min, cpu_cluster.available_frequencies[
+                                cpu_cluster.num_available_frequencies - 1]);
+        min = cluster_freq_ceil(&cpu_cluster, scale_to_encode_workload(min, workload));
+        apply_encode_request(cpu_cluster.backend, hint,
+                thermal_boost_min(pInfo, THERMAL_CPU, min, cluster_freq_top(&cpu_cluster)),
+                session, refresh, &cpu_cluster.fd_encode_min_freq);
+    }
+    if ((hint = hint_find(config->gpu_freq_hints, ExtPowerHint::VIDEO_ENCODE)))
+        apply_encode_request(pInfo->resources.gpu, hint,
+                thermal_boost_min(pInfo, THERMAL_GPU,
+                                  scale_to_encode_workload(hint->min, workload), 0),
+                session, refresh, &pInfo->fds.encode_gpu);
+    if ((hint = hint_find(config->emc_freq_hints, ExtPowerHint::VIDEO_ENCODE)))
+        apply_encode_request(pInfo->resources.emc, hint,
+                thermal_boost_min(pInfo, THERMAL_EMC,
+                                  scale_to_encode_workload(hint->min, workload), 0),
+                session, refresh, &pInfo->fds.encode_emc);
+    // Online cores are not under the thermal policy
+    if (!refresh && (hint = hint_find(config->online_cpu_hints, ExtPowerHint::VIDEO_ENCODE)))
+        apply_encode_request(pInfo->resources.online_cpus, hint,
+                scale_to_encode_workload(hint->min, workload),
+                session, false, &pInfo->fds.encode_online_cpus);
+}
+
+/* workload is width * height * fps of the encode, 0 when it stops.
+ * Clients that only report on/off pass 1 and get the full floors. */
+static void set_video_encode(struct powerhal_info *pInfo, const hint_config_t *config, int workload)
+{
+    Mutex::Autolock _l(pInfo->media_lock);
+
+    for (auto &cpu_cluster : pInfo->cpu_clusters)
+        resource_release(cpu_cluster.backend, &cpu_cluster.fd_encode_min_freq);
+    resource_release(pInfo->resources.gpu, &pInfo->fds.encode_gpu);
+    resource_release(pInfo->resources.emc, &pInfo->fds.encode_emc);
+    resource_release(pInfo->resources.online_cpus, &pInfo->fds.encode_online_cpus);
+
+    if (workload <= 0) {
+        pInfo->encode_workload = 0;
+        return;
+    }
+    if (workload == 1)
+        workload = VIDEO_ENCODE_FULL_WORKLOAD;
+    pInfo->encode_workload = workload;
+    apply_encode_floors(pInfo, config, false);
+
+    ALOGV("%s: workload=%d session=%d", __func__, workload,
+          workload >= VIDEO_ENCODE_FULL_WORKLOAD);
+}
+
+void media_floors_refresh(struct powerhal_info *pInfo)
+{
+    std::shared_ptr<const hint_config_t> config = hint_config_get(pInfo);
+    Mutex::Autolock _l(pInfo->media_lock);
+
+    hold_camera_floors(pInfo, config.get(), true);
+    if (pInfo->encode_workload > 0)
+        apply_encode_floors(pInfo, config.get(), true);
 }
 
 static void set_app_profile_min_cpu_freq(struct powerhal_info *pInfo, int value)
@@ -359,10 +740,9 @@ static void set_app_profile_min_cpu_freq(struct powerhal_info *pInfo, int value)
         value = pInfo->defaults.min_freq;
 
     for (auto &cpu_cluster : pInfo->cpu_clusters) {
-        if (cpu_cluster.fd_app_min_freq >= 0)
-            close(cpu_cluster.fd_app_min_freq);
+        resource_release(cpu_cluster.backend, &cpu_cluster.fd_app_min_freq);
         cpu_cluster.fd_app_min_freq =
-            pInfo->mTimeoutPoker->requestPmQos(cpu_cluster.pmqos_constraint_path,
+            resource_request(cpu_cluster.backend,
                                 PM_QOS_APP_PROFILE_PRIORITY, PM_QOS_DEFAULT_VALUE, value);
     }
     ALOGV("%s: set min CPU floor =%d", __func__, value);
@@ -371,10 +751,9 @@ static void set_app_profile_min_cpu_freq(struct powerhal_info *pInfo, int value)
 static void set_app_profile_max_cpu_freq_cluster(struct powerhal_info *pInfo, int value,
                 cpu_cluster_data_t *cluster)
 {
-    if (cluster->fd_app_max_freq >= 0)
-        close(cluster->fd_app_max_freq);
+    resource_release(cluster->backend, &cluster->fd_app_max_freq);
     cluster->fd_app_max_freq =
-        pInfo->mTimeoutPoker->requestPmQos(cluster->pmqos_constraint_path,
+        resource_request(cluster->backend,
                             PM_QOS_APP_PROFILE_PRIORITY, value, PM_QOS_DEFAULT_VALUE);
 
     ALOGV("%s: set max CPU ceiling =%d", __func__, value);
@@ -405,41 +784,32 @@ static void set_app_profile_max_online_cpus(struct powerhal_info *pInfo, int val
     if (value <= 0)
         value = pInfo->defaults.core_cap;
 
-    if (pInfo->fds.app_max_online_cpus >= 0) {
-        close(pInfo->fds.app_max_online_cpus);
-        pInfo->fds.app_max_online_cpus = -1;
-    }
+    resource_release(pInfo->resources.online_cpus, &pInfo->fds.app_max_online_cpus);
     pInfo->fds.app_max_online_cpus =
-        pInfo->mTimeoutPoker->requestPmQos(PMQOS_CONSTRAINT_ONLINE_CPUS, PM_QOS_APP_PROFILE_PRIORITY, value, PM_QOS_DEFAULT_VALUE);
+        resource_request(pInfo->resources.online_cpus, PM_QOS_APP_PROFILE_PRIORITY, value, PM_QOS_DEFAULT_VALUE);
 
     ALOGV("%s: set max online CPU core =%d", __func__, value);
 }
 
 static void set_app_profile_min_online_cpus(struct powerhal_info *pInfo, int value)
 {
-    if (pInfo->fds.app_min_online_cpus >= 0) {
-        close(pInfo->fds.app_min_online_cpus);
-        pInfo->fds.app_min_online_cpus = -1;
-    }
+    resource_release(pInfo->resources.online_cpus, &pInfo->fds.app_min_online_cpus);
     pInfo->fds.app_min_online_cpus =
-        pInfo->mTimeoutPoker->requestPmQos(PMQOS_CONSTRAINT_ONLINE_CPUS, PM_QOS_APP_PROFILE_PRIORITY, PM_QOS_DEFAULT_VALUE, value);
+        resource_request(pInfo->resources.online_cpus, PM_QOS_APP_PROFILE_PRIORITY, PM_QOS_DEFAULT_VALUE, value);
 
     ALOGV("%s: set min online CPU core =%d", __func__, value);
 }
 
 static void set_app_profile_min_gpu_freq(struct powerhal_info *pInfo, int value)
 {
-    if (pInfo->fds.app_min_gpu >= 0) {
-        close(pInfo->fds.app_min_gpu);
-        pInfo->fds.app_min_gpu = -1;
-    }
+    resource_release(pInfo->resources.gpu, &pInfo->fds.app_min_gpu);
     if (value)
         value = 0;
     else
         value = INT_MAX;
 
     pInfo->fds.app_min_gpu =
-        pInfo->mTimeoutPoker->requestPmQos(PMQOS_CONSTRAINT_GPU_FREQ, PM_QOS_APP_PROFILE_PRIORITY, PM_QOS_DEFAULT_VALUE, value);
+        resource_request(pInfo->resources.gpu, PM_QOS_APP_PROFILE_PRIORITY, PM_QOS_DEFAULT_VALUE, value);
 }
 
 static void set_prism_control_enable(__attribute__((unused)) struct powerhal_info *pInfo, int value)
@@ -456,18 +826,9 @@ static void set_app_profile_max_gpu_freq(struct powerhal_info *pInfo, int value)
     if (value <= 0)
         value = pInfo->defaults.gpu_cap;
 
-#ifndef GPU_IS_LEGACY
-    if (pInfo->fds.app_max_gpu >= 0) {
-        close(pInfo->fds.app_max_gpu);
-        pInfo->fds.app_max_gpu = -1;
-    }
+    resource_release(pInfo->resources.gpu, &pInfo->fds.app_max_gpu);
     pInfo->fds.app_max_gpu =
-        pInfo->mTimeoutPoker->requestPmQos(PMQOS_CONSTRAINT_GPU_FREQ, PM_QOS_APP_PROFILE_PRIORITY, value, PM_QOS_DEFAULT_VALUE);
-#else
-    /* legacy sysfs nodes to throttle GPU on "pre-T124" chips */
-    sysfs_write_int("sys/kernel/tegra_cap/cbus_cap_state", 1);
-    sysfs_write_int("sys/kernel/tegra_cap/cbus_cap_level", value);
-#endif
+        resource_request(pInfo->resources.gpu, PM_QOS_APP_PROFILE_PRIORITY, value, PM_QOS_DEFAULT_VALUE);
 }
 
 static void set_pbc_power(struct powerhal_info *pInfo, int value)
@@ -476,6 +837,8 @@ static void set_pbc_power(struct powerhal_info *pInfo, int value)
         value = pInfo->defaults.power_cap;
 
     set_property_int(POWER_CAP_PROP, value);
+    if (pInfo->power_cap)
+        pInfo->power_cap->setBudget(value);
 }
 
 static void set_fan_cap(struct powerhal_info *pInfo, int value)
@@ -486,7 +849,10 @@ static void set_fan_cap(struct powerhal_info *pInfo, int value)
     if (value < 0)
         value = pInfo->defaults.fan_cap;
 
-    sysfs_write_int("/sys/devices/platform/pwm-fan/pwm_cap", value);
+    if (pInfo->fan_curve)
+        pInfo->fan_curve->setCap(value);
+    else
+        sysfs_write_int(FAN_PWM_CAP_NODE, value);
 }
 
 static void app_profile_set(struct powerhal_info *pInfo, std::map<AppProfileKnob,int>& data)
@@ -543,35 +909,49 @@ void common_power_init(struct powerhal_info *pInfo)
     // Boost to max frequency on initialization to decrease boot time
     for (auto &cpu_cluster : pInfo->cpu_clusters)
         if (cpu_cluster.num_available_frequencies > 0)
-            pInfo->mTimeoutPoker->requestPmQosTimed(cpu_cluster.pmqos_constraint_path,
+            resource_request_timed(cpu_cluster.backend,
                                             PM_QOS_BOOST_PRIORITY,
                                             PM_QOS_DEFAULT_VALUE,
                                             cpu_cluster.available_frequencies[cpu_cluster.num_available_frequencies - 1],
-                                            ms2ns(pInfo->boot_boost_time_ms));
+                                            pInfo->boot_boost_time_ms);
 
     pInfo->switch_cpu_emc_limit_enabled = sysfs_exists(CPU_EMC_RATIO_SRC_NODE);
 
-    // Disable interactive governor handling if no cores are detected using it
-    if (get_scaling_governor(governor, sizeof(governor)) == -1 ||
-        !is_interactive_governor(governor)) {
+    // Governor profiles are only written while the governor they were
+    // tuned for is running
+    if (pInfo->governor_profiles.modes.empty())
+        init_default_governor_profiles(pInfo);
+    if (pInfo->governor_profiles.modes.empty() ||
+        get_scaling_governor(governor, sizeof(governor)) == -1 ||
+        pInfo->governor_profiles.governor != governor)
         pInfo->no_cpufreq_interactive = true;
-    } else {
-#if TARGET_TEGRA_VERSION == 124
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_MAX_PERF, interactive_data_t({ "624000",  "65 224000:75 624000:85", "19000",  "20000", "0", "41000", "90" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_OPT_PERF, interactive_data_t({ "510000",  "65 256000:75 510000:85", "19000", "300000", "0", "30000", "99" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_BAT_SAVE, interactive_data_t({ "420000",  "45 312000:75 564000:85", "80000", "300000", "2", "30000", "99" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_USR_CUST, interactive_data_t({ "510000",  "65 256000:75 510000:85", "19000", "300000", "0", "30000", "99" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_COUNT,    interactive_data_t({ "420000",  "80",                     "80000", "300000", "2", "30000", "99" }));
-#elif TARGET_TEGRA_VERSION == 210
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_MAX_PERF, interactive_data_t({ "1122000", "65 304000:75 1122000:80", "19000",  "20000", "0", "41000", "90" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_OPT_PERF, interactive_data_t({ "1020000", "65 256000:75 1020000:80", "19000",  "20000", "0", "30000", "99" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_BAT_SAVE, interactive_data_t({  "640000", "65 256000:75 640000:80",  "80000",  "20000", "2", "30000", "99" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_USR_CUST, interactive_data_t({ "1020000", "65 256000:75 1020000:80", "19000",  "20000", "0", "30000", "99" }));
-        interactive_data_array.emplace(NvCPLHintData::NVCPL_HINT_COUNT,    interactive_data_t({  "420000", "80",                      "80000", "300000", "2", "30000", "99" }));
-#else // No other platforms have interactive tuning data, so disable handling
-        pInfo->no_cpufreq_interactive = true;
-#endif
+    if (!pInfo->no_cpufreq_interactive) {
+        pInfo->governor = GovernorPlan::build(pInfo->governor_profiles);
+        if (!pInfo->governor)
+            pInfo->no_cpufreq_interactive = true;
     }
+    pInfo->governor_profiles = governor_profiles_t();
+#ifdef POWER_MODE_SET_INTERACTIVE
+    if (pInfo->governor) {
+        property_watch(&power_mode_prop, on_power_mode_changed, pInfo);
+        property_watch(&eco_state_prop, on_power_mode_changed, pInfo);
+    }
+#endif
+
+    if (pInfo->power_floor.states.empty())
+        power_floor_defaults(&pInfo->power_floor);
+    pInfo->platform_floor = PlatformFloor::create(pInfo, pInfo->power_floor);
+    pInfo->power_floor = power_floor_config_t();
+
+    // After the floors, which it places again when its limits change
+    pInfo->thermal = ThermalMonitor::create(pInfo, pInfo->thermal_policy);
+    pInfo->thermal_policy = thermal_policy_t();
+
+    pInfo->fan_curve = FanCurve::create(pInfo, pInfo->fan_curve_config);
+    pInfo->fan_curve_config = fan_curve_config_t();
+
+    pInfo->power_cap = PowerCap::create(pInfo, pInfo->power_cap_config);
+    pInfo->power_cap_config = power_cap_config_t();
 }
 
 void common_power_set_interactive(struct powerhal_info *pInfo, int on)
@@ -592,7 +972,7 @@ void common_power_set_interactive(struct powerhal_info *pInfo, int on)
 
         dev_id = input_dev.dev_id;
         snprintf(path, sizeof(path), "/sys/class/input/input%d/enabled", dev_id);
-        if (!access(path, W_OK)) {
+        if (!root_access(path, W_OK)) {
             if (0 == on)
                 ALOGI("Disabling input device:%d", dev_id);
             else
@@ -610,62 +990,44 @@ void common_power_set_interactive(struct powerhal_info *pInfo, int on)
 
 #ifdef POWER_MODE_SET_INTERACTIVE
     NvCPLHintData power_mode = NvCPLHintData::NVCPL_HINT_COUNT;
-    if (on) {
+    if (on)
         power_mode = get_system_power_mode();
-        if (power_mode < NvCPLHintData::NVCPL_HINT_MAX_PERF ||
-            power_mode > NvCPLHintData::NVCPL_HINT_COUNT) {
-            ALOGV("%s: no system power mode info, take optimized settings", __func__);
-            power_mode = NvCPLHintData::NVCPL_HINT_OPT_PERF;
-        }
-    }
-    set_interactive_governor(power_mode);
+    pInfo->governor->apply(static_cast<int>(power_mode));
 #endif
 }
 
 #ifdef POWER_MODE_SET_INTERACTIVE
 static NvCPLHintData get_system_power_mode(void)
 {
-    char value[PROPERTY_VALUE_MAX] = { 0 };
+    std::string value = power_mode_prop.get();
     NvCPLHintData power_mode = NvCPLHintData::NVCPL_HINT_COUNT;
 
-    property_get("persist.sys.NV_POWER_MODE", value, "");
-    if (value[0] != '\0')
+    if (!value.empty())
     {
-        power_mode = static_cast<NvCPLHintData>(atoi(value));
+        power_mode = static_cast<NvCPLHintData>(atoi(value.c_str()));
     }
 
-    if (get_property_bool("persist.sys.NV_ECO.STATE.ISECO", false))
+    if (eco_state_prop.getBool(false))
     {
         power_mode = NvCPLHintData::NVCPL_HINT_BAT_SAVE;
     }
 
+    if (power_mode < NvCPLHintData::NVCPL_HINT_MAX_PERF ||
+        power_mode > NvCPLHintData::NVCPL_HINT_COUNT) {
+        ALOGV("%s: no system power mode info, take optimized settings", __func__);
+        power_mode = NvCPLHintData::NVCPL_HINT_OPT_PERF;
+    }
+
     return power_mode;
 }
 
-static void __sysfs_write(const char *file, const char *data)
+/* Applies a new power mode right away instead of at the next screen on,
+ * unless the display is off */
+static void on_power_mode_changed(void *data)
 {
-    if (data != NULL)
-    {
-        sysfs_write(file, data);
-    }
-}
+    struct powerhal_info *pInfo = static_cast<struct powerhal_info *>(data);
 
-static void set_interactive_governor(NvCPLHintData mode)
-{
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/hispeed_freq",
-            interactive_data_array[mode].hispeed_freq);
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/target_loads",
-            interactive_data_array[mode].target_loads);
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/above_hispeed_delay",
-            interactive_data_array[mode].above_hispeed_delay);
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/timer_rate",
-            interactive_data_array[mode].timer_rate);
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/boost_factor",
-            interactive_data_array[mode].boost_factor);
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/min_sample_time",
-            interactive_data_array[mode].min_sample_time);
-    __sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/go_hispeed_load",
-            interactive_data_array[mode].go_hispeed_load);
+    pInfo->governor->update(static_cast<int>(get_system_power_mode()));
 }
 
 static void set_power_mode_hint(struct powerhal_info *pInfo, NvCPLHintData mode)
@@ -689,54 +1051,191 @@ static void set_power_mode_hint(struct powerhal_info *pInfo, NvCPLHintData mode)
 
     if (status)
     {
-        set_interactive_governor(mode);
+        pInfo->governor->apply(static_cast<int>(mode));
     }
 
 }
 #endif
 
-static void apply_gpu_boost(struct powerhal_info *pInfo, ExtPowerHint hint)
+/* Timed boost with the hint's range, its min lowered by the thermal
+ * policy for a thermal_resource. Resources with no entry for the hint are
+ * left alone. */
+static void apply_timed_boost(struct powerhal_info *pInfo, ResourceBackend *backend,
+                              const hint_map_t& hints, ExtPowerHint hint,
+                              int resource, int top)
 {
-    pInfo->mTimeoutPoker->requestPmQosTimed(PMQOS_CONSTRAINT_GPU_FREQ,
-                                            PM_QOS_BOOST_PRIORITY,
-                                            pInfo->gpu_freq_hints[hint].max,
-                                            pInfo->gpu_freq_hints[hint].min,
-                                            ms2ns(pInfo->gpu_freq_hints[hint].time_ms));
+    const power_hint_data_t *data = hint_find(hints, hint);
+
+    if (!data)
+        return;
+
+    resource_request_timed(backend, PM_QOS_BOOST_PRIORITY, data->max,
+                           thermal_boost_min(pInfo, resource, data->min, top),
+                           data->time_ms);
 }
 
-static void apply_online_cpus_boost(struct powerhal_info *pInfo, ExtPowerHint hint)
+static int boost_thermal_resource(const held_boost_t& boost)
 {
-    pInfo->mTimeoutPoker->requestPmQosTimed(PMQOS_CONSTRAINT_ONLINE_CPUS,
-                                            PM_QOS_BOOST_PRIORITY,
-                                            pInfo->online_cpu_hints[hint].max,
-                                            pInfo->online_cpu_hints[hint].min,
-                                            ms2ns(pInfo->online_cpu_hints[hint].time_ms));
+    switch (boost.table) {
+    case HINT_TABLE_CPU:
+        return THERMAL_CPU;
+    case HINT_TABLE_GPU:
+        return THERMAL_GPU;
+    case HINT_TABLE_EMC:
+        return THERMAL_EMC;
+    default:
+        return -1;
+    }
 }
 
-static void apply_emc_boost(struct powerhal_info *pInfo, ExtPowerHint hint)
+static const hint_map_t& boost_table(const hint_config_t *config, const held_boost_t& boost)
 {
-    pInfo->mTimeoutPoker->requestPmQosTimed("/dev/emc_freq_min",
-                                            pInfo->emc_freq_hints[hint].min,
-                                            ms2ns(pInfo->emc_freq_hints[hint].time_ms));
+    switch (boost.table) {
+    case HINT_TABLE_CPU:
+        return config->cpu_hints[boost.cluster];
+    case HINT_TABLE_GPU:
+        return config->gpu_freq_hints;
+    case HINT_TABLE_EMC:
+        return config->emc_freq_hints;
+    default:
+        return config->online_cpu_hints;
+    }
 }
 
-void common_power_hint(struct powerhal_info *pInfo, ExtPowerHint hint, const void *data)
+/* Min of a held boost for its INTERACTION entry, lowered by the thermal
+ * policy */
+static int interaction_boost_min(struct powerhal_info *pInfo, const held_boost_t& boost,
+                                 const power_hint_data_t *hint)
 {
-    uint64_t t;
+    int top = boost.table == HINT_TABLE_CPU ?
+            cluster_freq_top(&pInfo->cpu_clusters[boost.cluster]) : 0;
 
-    if (!pInfo)
+    return thermal_boost_min(pInfo, boost_thermal_resource(boost), hint->min, top);
+}
+
+static void interaction_boost_timeout(struct powerhal_info *pInfo, int generation);
+
+class InteractionTimeoutTask : public TimeoutPoker::Task {
+public:
+    InteractionTimeoutTask(struct powerhal_info *pInfo, int generation) :
+        pInfo(pInfo), generation(generation) {}
+    virtual void run() { interaction_boost_timeout(pInfo, generation); }
+private:
+    struct powerhal_info *pInfo;
+    int generation;
+};
+
+/* Must be called with interaction_lock held. Makes sure a timeout is
+ * pending for the earliest held boost to expire. */
+static void interaction_boost_schedule(struct powerhal_info *pInfo, nsecs_t now)
+{
+    nsecs_t next = 0;
+
+    for (auto &boost : pInfo->interaction_boosts)
+        if (boost.handle >= 0 && (!next || boost.end_time < next))
+            next = boost.end_time;
+
+    if (!next) {
+        pInfo->interaction_timer_time = 0;
         return;
+    }
 
-    if (check_hint(pInfo, hint, &t) < 0)
+    // A pending timeout firing early is harmless, it simply reschedules.
+    if (pInfo->interaction_timer_time && pInfo->interaction_timer_time <= next)
         return;
 
+    pInfo->interaction_timer_time = next;
+    pInfo->mTimeoutPoker->postTaskDelayed(
+            new InteractionTimeoutTask(pInfo, ++pInfo->interaction_timer_generation),
+            next > now ? next - now : 0);
+}
+
+static void interaction_boost_timeout(struct powerhal_info *pInfo, int generation)
+{
+    Mutex::Autolock _l(pInfo->interaction_lock);
+    nsecs_t now = powerhal_time();
+
+    // Superseded by an earlier timeout
+    if (generation != pInfo->interaction_timer_generation)
+        return;
+
+    for (auto &boost : pInfo->interaction_boosts) {
+        if (boost.handle >= 0 && boost.end_time <= now)
+            resource_release(boost.backend, &boost.handle);
+    }
+
+    pInfo->interaction_timer_time = 0;
+    interaction_boost_schedule(pInfo, now);
+}
+
+/* Touch boost. The framework passes the wanted duration, which is capped
+ * by the per-resource duration from the hint table. Touches that arrive
+ * while a boost is held only push its end time out. */
+static void apply_interaction_boost(struct powerhal_info *pInfo, const hint_config_t *config,
+                                    int duration_ms)
+{
+    Mutex::Autolock _l(pInfo->interaction_lock);
+    nsecs_t now = powerhal_time();
+
+    for (auto &boost : pInfo->interaction_boosts) {
+        const power_hint_data_t *hint = hint_find(boost_table(config, boost),
+                                                  ExtPowerHint::INTERACTION);
+        if (!hint)
+            continue;
+
+        int time_ms = hint->time_ms;
+
+        if (duration_ms > 0 && duration_ms < time_ms)
+            time_ms = duration_ms;
+        if (time_ms <= 0)
+            continue;
+
+        int min = interaction_boost_min(pInfo, boost, hint);
+
+        if (boost.handle < 0) {
+            boost.handle = resource_request(boost.backend, PM_QOS_BOOST_PRIORITY, hint->max, min);
+            if (boost.handle < 0)
+                continue;
+            boost.end_time = 0;
+        } else if (min != boost.min) {
+            // The thermal limits moved since the boost was placed
+            resource_update(boost.backend, &boost.handle, PM_QOS_BOOST_PRIORITY, hint->max, min);
+        }
+        boost.min = min;
+
+        if (now + ms2ns(time_ms) > boost.end_time)
+            boost.end_time = now + ms2ns(time_ms);
+    }
+
+    interaction_boost_schedule(pInfo, now);
+}
+
+void interaction_boost_refresh(struct powerhal_info *pInfo)
+{
+    std::shared_ptr<const hint_config_t> config = hint_config_get(pInfo);
+    Mutex::Autolock _l(pInfo->interaction_lock);
+
+    for (auto &boost : pInfo->interaction_boosts) {
+        const power_hint_data_t *hint;
+        int min;
+
+        if (boost.handle < 0)
+            continue;
+        hint = hint_find(boost_table(config.get(), boost), ExtPowerHint::INTERACTION);
+        if (!hint)
+            continue;
+
+        min = interaction_boost_min(pInfo, boost, hint);
+        if (min == boost.min)
+            continue;
+        resource_update(boost.backend, &boost.handle, PM_QOS_BOOST_PRIORITY, hint->max, min);
+        boost.min = min;
+    }
+}
+
+bool hint_is_timed_boost(ExtPowerHint hint)
+{
     switch (hint) {
-    case ExtPowerHint::VSYNC:
-        if (data)
-            set_vsync_min_cpu_freq(pInfo, *(int *)data);
-        break;
-    case ExtPowerHint::INTERACTION:
-        break;
     case ExtPowerHint::MULTITHREAD_BOOST:
     case ExtPowerHint::APP_LAUNCH:
     case ExtPowerHint::LAUNCH:
@@ -748,30 +1247,71 @@ void common_power_hint(struct powerhal_info *pInfo, ExtPowerHint hint, const voi
     case ExtPowerHint::AUDIO_SPEAKER:
     case ExtPowerHint::AUDIO_OTHER:
     case ExtPowerHint::AUDIO_LOW_LATENCY:
-        for (auto &cpu_cluster : pInfo->cpu_clusters) {
-            pInfo->mTimeoutPoker->requestPmQosTimed(cpu_cluster.pmqos_constraint_path,
-                                                PM_QOS_BOOST_PRIORITY,
-                                                cpu_cluster.hints[hint].max,
-                                                cpu_cluster.hints[hint].min,
-                                                ms2ns(cpu_cluster.hints[hint].time_ms));
-        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+void common_power_hint(struct powerhal_info *pInfo, ExtPowerHint hint, const void *data,
+                       size_t len)
+{
+    std::shared_ptr<const hint_config_t> config;
+    uint64_t t;
+
+    if (!pInfo)
+        return;
 
-        apply_gpu_boost(pInfo, hint);
-        apply_online_cpus_boost(pInfo, hint);
-        apply_emc_boost(pInfo, hint);
+    // From here on a non-NULL data holds at least one int
+    if (!len)
+        data = NULL;
+
+    // The whole hint is handled with the tables in effect as it arrives
+    config = hint_config_get(pInfo);
+
+    if (check_hint(pInfo, config.get(), hint, &t) < 0)
+        return;
+
+    ResidencyScope scope(static_cast<int>(hint));
+
+    switch (hint) {
+    case ExtPowerHint::VSYNC:
+        if (data)
+            pInfo->frame_pacer->setVsync(*(int *)data);
+        break;
+    case ExtPowerHint::FRAMERATE_DATA:
+        if (data)
+            pInfo->frame_pacer->ingest(static_cast<const int32_t *>(data), len);
+        else
+            ALOGW("FRAMERATE_DATA: no data, ignore.");
+        break;
+    case ExtPowerHint::INTERACTION:
+        apply_interaction_boost(pInfo, config.get(), data ? *(const int *)data : 0);
         break;
     case ExtPowerHint::APP_PROFILE:
-        if (data) {
+        if (data && len < static_cast<size_t>(AppProfileKnob::APP_PROFILE_COUNT)) {
+            ALOGE("APP_PROFILE: %zu of %d knobs, ignore.", len,
+                  static_cast<int>(AppProfileKnob::APP_PROFILE_COUNT));
+        } else if (data) {
             std::map<AppProfileKnob,int> app_profiles;
             for (int i=0; i<static_cast<int>(AppProfileKnob::APP_PROFILE_COUNT); i++)
                 app_profiles.emplace(static_cast<AppProfileKnob>(i), static_cast<const int*>(data)[i]);
             app_profile_set(pInfo, app_profiles);
+            pInfo->app_profile.assign(static_cast<const int*>(data),
+                    static_cast<const int*>(data) + static_cast<int>(AppProfileKnob::APP_PROFILE_COUNT));
+            pInfo->app_profile_time = t;
         } else {
             ALOGW("APP_PROFILE: no data, ignore.");
         }
         break;
+    case ExtPowerHint::VIDEO_ENCODE:
+        set_video_encode(pInfo, config.get(), data ? *(const int *)data : 0);
+        break;
     case ExtPowerHint::CAMERA:
-        ALOGW("Camera hint is not supported in PowerHAL");
+        if (data)
+            set_camera_floors(pInfo, config.get(), *(const int *)data);
+        else
+            ALOGW("CAMERA: no data, ignore.");
         break;
     case ExtPowerHint::POWER_MODE:
 #ifdef POWER_MODE_SET_INTERACTIVE
@@ -788,18 +1328,158 @@ void common_power_hint(struct powerhal_info *pInfo, ExtPowerHint hint, const voi
          set_power_mode_hint(pInfo, data ? NvCPLHintData::NVCPL_HINT_BAT_SAVE : NvCPLHintData::NVCPL_HINT_OPT_PERF);
 #endif
         break;
-#ifdef USE_NVPHS
     case ExtPowerHint::FRAMEWORKS_UI:
+        if (!data)
+            break;
         NvPHSSendThroughputHints(*((int*)data), PHS_FLAG_IMMEDIATE, NvUsecase_ui, NvHintType_TransientCpuLoad, INT_MAX, NVPHS_IMMEDIATE_MODE_MIN_HINT_TIMEOUT_MS, NvUsecase_NULL);
         break;
     case ExtPowerHint::CANCEL_PHS_HINT:
+        if (!data)
+            break;
         NvPHSCancelThroughputHints(*((int*)data),NvUsecase_ui);
         break;
-#endif
     default:
-        ALOGE("Unknown power hint: 0x%x", static_cast<int>(hint));
+        if (!hint_is_timed_boost(hint)) {
+            ALOGE("Unknown power hint: 0x%x", static_cast<int>(hint));
+            break;
+        }
+
+        for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++)
+            apply_timed_boost(pInfo, pInfo->cpu_clusters[i].backend, config->cpu_hints[i],
+                              hint, THERMAL_CPU, cluster_freq_top(&pInfo->cpu_clusters[i]));
+
+        apply_timed_boost(pInfo, pInfo->resources.gpu, config->gpu_freq_hints,
+                          hint, THERMAL_GPU, 0);
+        apply_timed_boost(pInfo, pInfo->resources.online_cpus, config->online_cpu_hints,
+                          hint, -1, 0);
+        apply_timed_boost(pInfo, pInfo->resources.emc, config->emc_freq_hints,
+                          hint, THERMAL_EMC, 0);
         break;
     }
 
     pInfo->hint_time[hint] = t;
 }
+
+static const char *app_profile_knob_names[] = {
+    "cpu_scaling_min_freq",
+    "cpu_max_normal_freq_percent",
+    "cpu_max_core",
+    "gpu_cbus_cap_level",
+    "gpu_scaling",
+    "prism_control_enable",
+    "cpu_min_core",
+    "fan_cap",
+    "pbc_power",
+};
+
+static void dump_handle(std::string& out, const char *name, int handle)
+{
+    char line[80];
+
+    if (handle < 0)
+        return;
+    snprintf(line, sizeof(line), "    %-24s %d\n", name, handle);
+    out += line;
+}
+
+void common_power_dump(struct powerhal_info *pInfo, std::string& out)
+{
+    uint64_t now_ms;
+    char line[160];
+
+    if (!pInfo)
+        return;
+
+    now_ms = ns2ms(powerhal_time());
+
+    out += "Held requests (backend handles):\n";
+    for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cluster = pInfo->cpu_clusters[i];
+
+        snprintf(line, sizeof(line), "  cpu%zu (%s):\n", i,
+                 cluster.backend ? cluster.backend->path() : "none");
+        out += line;
+        dump_handle(out, "app_min_freq", cluster.fd_app_min_freq);
+        dump_handle(out, "app_max_freq", cluster.fd_app_max_freq);
+        dump_handle(out, "camera_min_freq", cluster.fd_camera_min_freq);
+        dump_handle(out, "encode_min_freq", cluster.fd_encode_min_freq);
+    }
+    out += "  other:\n";
+    dump_handle(out, "app_max_online_cpus", pInfo->fds.app_max_online_cpus);
+    dump_handle(out, "app_min_online_cpus", pInfo->fds.app_min_online_cpus);
+    dump_handle(out, "app_max_gpu", pInfo->fds.app_max_gpu);
+    dump_handle(out, "app_min_gpu", pInfo->fds.app_min_gpu);
+    dump_handle(out, "camera_gpu", pInfo->fds.camera_gpu);
+    dump_handle(out, "camera_emc", pInfo->fds.camera_emc);
+    dump_handle(out, "encode_gpu", pInfo->fds.encode_gpu);
+    dump_handle(out, "encode_emc", pInfo->fds.encode_emc);
+    dump_handle(out, "encode_online_cpus", pInfo->fds.encode_online_cpus);
+
+    {
+        Mutex::Autolock _l(pInfo->interaction_lock);
+        nsecs_t now = powerhal_time();
+
+        out += "Interaction boosts:\n";
+        for (auto &boost : pInfo->interaction_boosts) {
+            if (boost.handle < 0)
+                continue;
+            snprintf(line, sizeof(line), "  %s handle %d, %lld ms left\n",
+                     boost.backend->path(), boost.handle,
+                     (long long)ns2ms(std::max(boost.end_time - now, (nsecs_t)0)));
+            out += line;
+        }
+    }
+
+    snprintf(line, sizeof(line), "Hint config: %s\n",
+             pInfo->config_path.empty() ? "defaults" : pInfo->config_path.c_str());
+    out += line;
+
+    pInfo->mTimeoutPoker->dump(out);
+
+    snprintf(line, sizeof(line), "Governor profile: %s\n",
+             pInfo->no_cpufreq_interactive ? "n/a" :
+             governor_mode_name(pInfo->governor->mode()));
+    out += line;
+    if (pInfo->governor)
+        pInfo->governor->dump(out);
+    if (pInfo->platform_floor)
+        pInfo->platform_floor->dump(out);
+    if (pInfo->thermal)
+        pInfo->thermal->dump(out);
+    if (pInfo->fan_curve)
+        pInfo->fan_curve->dump(out);
+    if (pInfo->power_cap)
+        pInfo->power_cap->dump(out);
+
+    if (pInfo->app_profile.empty()) {
+        out += "App profile: none\n";
+    } else {
+        snprintf(line, sizeof(line), "App profile (set %llu ms ago):\n",
+                 (unsigned long long)(now_ms - pInfo->app_profile_time));
+        out += line;
+        for (size_t i = 0; i < pInfo->app_profile.size() &&
+                           i < sizeof(app_profile_knob_names) / sizeof(app_profile_knob_names[0]); i++) {
+            snprintf(line, sizeof(line), "  %-28s %d\n",
+                     app_profile_knob_names[i], pInfo->app_profile[i]);
+            out += line;
+        }
+    }
+
+    pInfo->frame_pacer->dump(out);
+    pInfo->sessions->dump(out);
+
+    out += "Last hints:\n";
+    for (auto &it : pInfo->hint_time) {
+        const char *name = power_hint_name(it.first);
+
+        if (!it.second)
+            continue;
+        if (name)
+            snprintf(line, sizeof(line), "  %-20s %llu ms ago\n", name,
+                     (unsigned long long)(now_ms - it.second));
+        else
+            snprintf(line, sizeof(line), "  0x%-18x %llu ms ago\n", static_cast<int>(it.first),
+                     (unsigned long long)(now_ms - it.second));
+        out += line;
+    }
+}
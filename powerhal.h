@@ -22,10 +22,12 @@
 #include <hardware/hardware.h>
 #include <hardware/power.h>
 
+#include "powerhal_resource.h"
 #include "powerhal_utils.h"
 #include "timeoutpoker.h"
 #include <semaphore.h>
 
+#include <memory>
 #include <vector>
 
 #include <vendor/nvidia/hardware/power/1.0/IPower.h>
@@ -49,25 +51,156 @@ using ::vendor::nvidia::hardware::power::V1_0::NvCPLHintData;
 
 #define PM_QOS_BOOST_PRIORITY 35
 #define PM_QOS_APP_PROFILE_PRIORITY  40
+#define PM_QOS_PLATFORM_FLOOR_PRIORITY  45
+#define PM_QOS_POWER_CAP_PRIORITY  50
 
 #define HARDWARE_TYPE_PROP "ro.hardware"
 
 #define POWER_HINT_MAX ExtPowerHint::FRAMERATE_DATA
 
+class FanCurve;
+class FramePacer;
+class GovernorPlan;
+class HintSessionManager;
+class PlatformFloor;
+class PowerCap;
+class ThermalMonitor;
+
 struct input_dev_map {
     int dev_id;
     const char* dev_name;
 };
 
-typedef struct interactive_data {
-    const char *hispeed_freq;
-    const char *target_loads;
-    const char *above_hispeed_delay;
-    const char *timer_rate;
-    const char *boost_factor;
-    const char *min_sample_time;
-    const char *go_hispeed_load;
-} interactive_data_t;
+typedef struct governor_tunable {
+    std::string name;
+    std::string value;
+} governor_tunable_t;
+
+/* Governor tunables per power mode, see powerhal_governor.h */
+typedef struct governor_profiles {
+    /* scaling_governor the tunables belong to */
+    std::string governor;
+    /* Directory holding the tunables */
+    std::string path;
+    /* Tunables in write order by NvCPLHintData, NVCPL_HINT_COUNT being
+     * display off */
+    std::map<int, std::vector<governor_tunable_t>> modes;
+} governor_profiles_t;
+
+/* Platform floors by power supply and interactive state, see
+ * powerhal_floor.h */
+typedef struct floor_supply_id {
+    std::string prefix;
+    /* Range of the number following prefix, -1 for an exact match */
+    long min;
+    long max;
+} floor_supply_id_t;
+
+typedef struct floor_supply {
+    std::string name;
+    std::string prop;
+    std::vector<floor_supply_id_t> ids;
+} floor_supply_t;
+
+typedef struct floor_constraint {
+    int cluster;            // for CPU, -1 for every cluster
+    int min;
+    int max;
+} floor_constraint_t;
+
+typedef struct floor_knob {
+    std::string path;
+    std::string value;
+    /* Node that must exist before the knob is written, empty for none */
+    std::string wait;
+} floor_knob_t;
+
+typedef struct floor_state {
+    std::string supply;     // supply class, empty for any
+    int interactive;        // 1 or 0, -1 for either
+    int priority;
+    std::vector<floor_constraint_t> cpu;
+    std::vector<floor_constraint_t> gpu;
+    std::vector<floor_knob_t> knobs;
+} floor_state_t;
+
+typedef struct power_floor_config {
+    /* ro.hardware prefixes the floors apply to, empty for all */
+    std::vector<std::string> platforms;
+    std::vector<floor_supply_t> supplies;
+    /* The first state that matches is applied */
+    std::vector<floor_state_t> states;
+} power_floor_config_t;
+
+/* Boost capping by temperature, see powerhal_thermal.h */
+enum thermal_resource {
+    THERMAL_CPU,
+    THERMAL_GPU,
+    THERMAL_EMC,
+    THERMAL_RESOURCE_COUNT
+};
+
+typedef struct thermal_zone_policy {
+    /* Contents of thermal_zoneN/type */
+    std::string type;
+    /* Millidegrees C */
+    int trip;
+    int margin;
+    /* Percent of boost floors left at the trip */
+    int scale;
+    /* Boost floor caps within the margin by thermal_resource, kHz,
+     * PM_QOS_DEFAULT_VALUE for none */
+    int caps[THERMAL_RESOURCE_COUNT];
+} thermal_zone_policy_t;
+
+typedef struct thermal_policy {
+    /* Sampling period while every zone is cool, and while one is
+     * getting close to its margin */
+    int interval_ms;
+    int fast_interval_ms;
+    std::vector<thermal_zone_policy_t> zones;
+} thermal_policy_t;
+
+/* Fan speed by temperature, see powerhal_fan.h */
+typedef struct fan_point {
+    int temp;               // millidegrees C
+    int pwm;
+} fan_point_t;
+
+typedef struct fan_curve_config {
+    /* Thermal zone type, the hottest zone of the type is followed */
+    std::string zone;
+    int interval_ms;
+    /* Millidegrees the zone has to cool by before the fan slows down */
+    int hysteresis;
+    /* Largest pwm change per sample, 0 for no limit */
+    int slew;
+    /* By rising temperature */
+    std::vector<fan_point_t> points;
+} fan_curve_config_t;
+
+/* Board power budget enforcement, see powerhal_powercap.h */
+typedef struct power_rail {
+    /* Contents of hwmonN/name */
+    std::string hwmon;
+    /* inN_label of the channel, or its number if empty */
+    std::string label;
+    int channel;
+} power_rail_t;
+
+typedef struct power_cap_config {
+    int interval_ms;
+    /* Percent below the budget that is close enough */
+    int deadband;
+    /* Lowest percent of the top frequencies the caps go down to */
+    int min_scale;
+    /* Fewest cores left online */
+    int min_cores;
+    /* GPU top frequency in kHz, 0 to leave the GPU uncapped */
+    int gpu_max;
+    /* Summed as the board power */
+    std::vector<power_rail_t> rails;
+} power_cap_config_t;
 
 typedef struct power_hint_data {
     int min;
@@ -75,24 +208,59 @@ typedef struct power_hint_data {
     int time_ms;
 } power_hint_data_t;
 
+typedef std::map<ExtPowerHint,power_hint_data_t> hint_map_t;
+
+/* Hint tables in effect. A published config is never modified; a reload
+ * publishes a new one, and hints in flight finish on the one they
+ * started with. See hint_config_get(). */
+typedef struct hint_config {
+    std::vector<hint_map_t> cpu_hints;      // per cluster
+    hint_map_t gpu_freq_hints;
+    hint_map_t emc_freq_hints;
+    hint_map_t online_cpu_hints;
+    std::map<ExtPowerHint,uint64_t> hint_interval;
+} hint_config_t;
+
+typedef enum {
+    HINT_TABLE_CPU,
+    HINT_TABLE_GPU,
+    HINT_TABLE_EMC,
+    HINT_TABLE_ONLINE_CPUS,
+} hint_table_t;
+
 typedef struct cpu_cluster_data {
     const char *pmqos_constraint_path;
     const char *available_freqs_path;
     int *available_frequencies;
     int num_available_frequencies;
+    ResourceBackend *backend;
     int fd_app_min_freq;
     int fd_app_max_freq;
-    int fd_vsync_min_freq;
+    int fd_camera_min_freq;
+    int fd_encode_min_freq;
 
+    /* Staging, see powerhal_info::config */
     std::map<ExtPowerHint,power_hint_data_t> hints;
 } cpu_cluster_data_t;
 
+/* Boost held through a single backend handle that is extended, not
+ * re-requested, while hints keep arriving. */
+typedef struct held_boost {
+    ResourceBackend *backend;
+    hint_table_t table;
+    int cluster;            // for HINT_TABLE_CPU
+    int handle;
+    nsecs_t end_time;
+    int min;                // placed, after thermal scaling
+} held_boost_t;
+
 struct powerhal_info {
     TimeoutPoker* mTimeoutPoker;
 
     std::vector<cpu_cluster_data_t> cpu_clusters;
 
     bool ftrace_enable;
+    /* No governor profiles are written */
     bool no_cpufreq_interactive;
     bool no_sclk_boost;
 
@@ -101,14 +269,30 @@ struct powerhal_info {
 
     /* Time last hint was sent - in usec */
     std::map<ExtPowerHint,uint64_t> hint_time;
-    std::map<ExtPowerHint,uint64_t> hint_interval;
 
+    /* Hint tables in effect, only accessed through hint_config_get() and
+     * hint_config_publish() */
+    std::shared_ptr<const hint_config_t> config;
+    /* Path of the XML the config was read from, empty if defaults */
+    std::string config_path;
+
+    /* Staging for the hint tables. The parser and the defaults fill these
+     * and cpu_cluster_data::hints, and hint_config_take() moves them out
+     * into a config; the hint path never reads them. */
+    std::map<ExtPowerHint,uint64_t> hint_interval;
     std::map<ExtPowerHint,power_hint_data_t> gpu_freq_hints;
     std::map<ExtPowerHint,power_hint_data_t> emc_freq_hints;
     std::map<ExtPowerHint,power_hint_data_t> online_cpu_hints;
 
     int boot_boost_time_ms;
 
+    /* Backends for the non-cluster resources, NULL if not present */
+    struct {
+        ResourceBackend *gpu;
+        ResourceBackend *emc;
+        ResourceBackend *online_cpus;
+    } resources;
+
     /* AppProfile defaults */
     struct {
         int min_freq;
@@ -119,17 +303,69 @@ struct powerhal_info {
         int power_cap;
     } defaults;
 
+    /* Last APP_PROFILE knob values in AppProfileKnob order, empty until
+     * the first APP_PROFILE hint */
+    std::vector<int> app_profile;
+    uint64_t app_profile_time;
+
+    /* Staging for the governor profiles, filled by the parser or the
+     * defaults and turned into governor by common_power_init() */
+    governor_profiles_t governor_profiles;
+    GovernorPlan *governor;
+
+    /* Staging for the platform floors, filled by the parser or the
+     * defaults and turned into platform_floor by common_power_init() */
+    power_floor_config_t power_floor;
+    PlatformFloor *platform_floor;
+
+    /* Staging for the thermal policy, filled by the parser and turned
+     * into thermal by common_power_init() */
+    thermal_policy_t thermal_policy;
+    ThermalMonitor *thermal;
+
+    /* Staging for the fan curve, filled by the parser and turned into
+     * fan_curve by common_power_init() */
+    fan_curve_config_t fan_curve_config;
+    FanCurve *fan_curve;
+
+    /* Staging for the power cap, filled by the parser and turned into
+     * power_cap by common_power_init() */
+    power_cap_config_t power_cap_config;
+    PowerCap *power_cap;
+
+    /* Touch boost state, guarded by interaction_lock */
+    Mutex interaction_lock;
+    std::vector<held_boost_t> interaction_boosts;
+    int interaction_timer_generation;
+    nsecs_t interaction_timer_time;
+
+    /* Frame pacing and VSYNC floors, see powerhal_framepacer.h */
+    FramePacer *frame_pacer;
+
+    /* Performance hint sessions, see powerhal_session.h */
+    HintSessionManager *sessions;
+
     /* Features on platform */
     struct {
         bool fan;
     } features;
 
-    /* File descriptors used for hints and app profiles */
+    /* Camera and video encode floors, held on the camera_* and encode_*
+     * handles. Guarded by media_lock, along with those handles. */
+    Mutex media_lock;
+    int encode_workload;
+
+    /* Backend handles used for hints and app profiles */
     struct {
         int app_max_online_cpus;
         int app_min_online_cpus;
         int app_max_gpu;
         int app_min_gpu;
+        int camera_gpu;
+        int camera_emc;
+        int encode_gpu;
+        int encode_emc;
+        int encode_online_cpus;
     } fds;
 
     /* Switching CPU/EMC freq ratio based on display state */
@@ -154,9 +390,60 @@ void common_power_set_interactive(struct powerhal_info *pInfo, int on);
 
 /* PowerHint called to pass hints on power requirements, which
  * may result in adjustment of power/performance parameters of the
- * cpufreq governor and other controls.
+ * cpufreq governor and other controls. len is the number of ints at
+ * data; hints whose data is shorter than they need are dropped.
 */
-void common_power_hint(struct powerhal_info *pInfo, ExtPowerHint hint, const void *data);
+void common_power_hint(struct powerhal_info *pInfo, ExtPowerHint hint, const void *data,
+                       size_t len);
+
+/* Appends a report of the requests held and the profiles in effect. Runs
+ * on the hint thread; it waits only on the TimeoutPoker looper, and only
+ * for as long as it takes to list the timed requests. */
+void common_power_dump(struct powerhal_info *pInfo, std::string& out);
+
+/* The hint tables in effect. Hold on to the returned pointer for as long
+ * as the tables are used; a reload does not free them underneath. */
+std::shared_ptr<const hint_config_t> hint_config_get(const struct powerhal_info *pInfo);
+
+/* Moves the staging tables of staging out into a new config */
+hint_config_t *hint_config_take(struct powerhal_info *staging);
+
+/* Makes config the one in effect. Returns -1, and drops config, if it
+ * does not match the clusters of pInfo. */
+int hint_config_publish(struct powerhal_info *pInfo, hint_config_t *config);
+
+/* Whether every hint places its table entries as timed boosts */
+bool hint_is_timed_boost(ExtPowerHint hint);
+
+/* Entry for hint in hints, NULL if there is none */
+const power_hint_data_t *hint_find(const hint_map_t& hints, ExtPowerHint hint);
+
+/* Lowest available frequency of the cluster at or above freq */
+int cluster_freq_ceil(const cpu_cluster_data_t *cluster, int freq);
+
+/* Highest available frequency of the cluster, 0 if not known */
+int cluster_freq_top(const cpu_cluster_data_t *cluster);
+
+/* Highest available frequency of the cluster at or below freq, the
+ * lowest one if none is, freq if none are known */
+int cluster_freq_floor(const cpu_cluster_data_t *cluster, int freq);
+
+/* Frequency at a normalized position in the cluster's frequency table,
+ * 0 for the lowest entry so that no floor needs to be held. */
+int cluster_freq_at(const cpu_cluster_data_t *cluster, float position);
+
+void set_power_level_floor(struct powerhal_info *pInfo, int on);
+
+/* Boost floor min for a thermal_resource, lowered to the thermal headroom.
+ * top is the resource's top frequency standing in for INT_MAX, 0 if not
+ * known. Returns min as is without a thermal policy. */
+int thermal_boost_min(struct powerhal_info *pInfo, int resource, int min, int top);
+
+/* Places the held touch boosts again, after the thermal limits on their
+ * mins changed */
+void interaction_boost_refresh(struct powerhal_info *pInfo);
 
-void set_power_level_floor(int on);
+/* Places the held camera and video encode floors again, after the
+ * thermal limits on their mins changed */
+void media_floors_refresh(struct powerhal_info *pInfo);
 #endif  //COMMON_POWER_HAL_H
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks a powerhal XML config offline with the HAL's own parser:
+ *
+ *   powerhal_check [-t opp_table] config.xml
+ *
+ * Everything the parser rejects is reported with its line. On top of that
+ * the tool reports what the parser accepts but leaves a hint doing
+ * nothing or less than intended: ranges with min above max, timed boosts
+ * without a duration, floor states for unknown supplies or clusters and,
+ * given an OPP table, floors above the top OPP and caps below the lowest.
+ *
+ * It then prints the plan for every hint, and an estimate of how many
+ * constraints can be outstanding at once on each resource.
+ *
+ * The OPP table has one line per resource, in kHz like the XML:
+ *
+ *   cpu0 204000 307200 ... 1734000
+ *   gpu 76800 153600 ... 998400
+ *   emc 40800 68000 ... 1600000
+ *
+ * For CPU clusters it can be captured with
+ *
+ *   echo cpu0 $(cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_available_frequencies)
+ *
+ * Exits with 1 if any error was found.
+ */
+#define LOG_TAG "powerhal_check"
+
+#include <algorithm>
+#include <fstream>
+#include <limits.h>
+#include <set>
+#include <sstream>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "powerhal.h"
+#include "powerhal_governor.h"
+#include "powerhal_parser.h"
+
+/* Requests held outside the timed boosts, at most one each: app profile
+ * min and max, camera, video encode, touch boost, frame pacer, platform
+ * floor, power cap and the PHS floor and cap for CPU clusters and the
+ * GPU, fewer elsewhere. PHS holds nothing on the EMC. Hint sessions add
+ * one per session on every cluster. */
+#define HELD_CPU 10
+#define HELD_GPU 10
+#define HELD_EMC 4
+#define HELD_ONLINE_CPUS 5
+
+static int errors;
+static int warnings;
+static const char *config_file;
+
+static void report(bool error, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void report(bool error, const char *fmt, ...)
+{
+    va_list ap;
+
+    printf("%s: %s: ", config_file, error ? "error" : "warning");
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+
+    if (error)
+        errors++;
+    else
+        warnings++;
+}
+
+static void parser_report(const char *filename, int line, const char *msg)
+{
+    printf("%s:%d: error: %s\n", filename, line, msg);
+    errors++;
+}
+
+/* Frequencies by resource name, sorted */
+typedef std::map<std::string, std::vector<int>> opp_table_t;
+
+static int load_opp_table(const char *path, opp_table_t& opps)
+{
+    std::ifstream file(path);
+    std::string line;
+
+    if (!file.is_open()) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return -1;
+    }
+
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::string name;
+        int freq;
+
+        if (!(words >> name))
+            continue;
+        while (words >> freq)
+            opps[name].push_back(freq);
+        std::sort(opps[name].begin(), opps[name].end());
+    }
+    return 0;
+}
+
+static std::string hint_label(ExtPowerHint hint)
+{
+    const char *name = power_hint_name(hint);
+    char buf[16];
+
+    if (name)
+        return name;
+    snprintf(buf, sizeof(buf), "0x%x", static_cast<int>(hint));
+    return buf;
+}
+
+static std::string value_label(int value)
+{
+    if (value == PM_QOS_DEFAULT_VALUE)
+        return "-";
+    if (value == INT_MAX)
+        return "top";
+    return std::to_string(value);
+}
+
+/* Checks one range against the resource's OPPs, if there are any */
+static void check_range(const opp_table_t& opps, const std::string& what,
+                        const std::string& resource, int min, int max)
+{
+    auto it = opps.find(resource);
+
+    if (min != PM_QOS_DEFAULT_VALUE && max != PM_QOS_DEFAULT_VALUE && min > max)
+        report(true, "%s: %s min %d is above max %d", what.c_str(), resource.c_str(), min, max);
+
+    if (it == opps.end() || it->second.empty())
+        return;
+
+    // INT_MAX asks for the top OPP
+    if (min != PM_QOS_DEFAULT_VALUE && min != INT_MAX && min > it->second.back())
+        report(true, "%s: %s min %d is above the top OPP %d",
+               what.c_str(), resource.c_str(), min, it->second.back());
+    if (max != PM_QOS_DEFAULT_VALUE && max < it->second.front())
+        report(true, "%s: %s max %d is below the lowest OPP %d",
+               what.c_str(), resource.c_str(), max, it->second.front());
+}
+
+struct Resource {
+    std::string name;
+    const hint_map_t *hints;
+    int held;
+};
+
+static void check_hints(struct powerhal_info *pInfo, const std::vector<Resource>& resources,
+                        const opp_table_t& opps)
+{
+    std::set<ExtPowerHint> hints;
+
+    for (auto &resource : resources)
+        for (auto &it : *resource.hints)
+            hints.insert(it.first);
+
+    printf("Hint plan:\n");
+    for (ExtPowerHint hint : hints) {
+        auto interval = pInfo->hint_interval.find(hint);
+        bool timed = hint_is_timed_boost(hint);
+        std::string label = hint_label(hint);
+
+        printf("  %s (%s, interval %s)\n", label.c_str(), timed ? "timed" : "held",
+               interval != pInfo->hint_interval.end() && interval->second ?
+                       (std::to_string(interval->second) + " ms").c_str() : "none");
+
+        for (auto &resource : resources) {
+            const power_hint_data_t *data = hint_find(*resource.hints, hint);
+
+            if (!data)
+                continue;
+            printf("    %-12s min %-8s max %-8s %d ms\n", resource.name.c_str(),
+                   value_label(data->min).c_str(), value_label(data->max).c_str(),
+                   data->time_ms);
+
+            check_range(opps, "hint " + label, resource.name, data->min, data->max);
+            if (timed && data->time_ms <= 0)
+                report(true, "hint %s: %s has no duration, the boost is never placed",
+                       label.c_str(), resource.name.c_str());
+        }
+    }
+}
+
+/* Timed boosts stay outstanding for their duration, and a hint can come
+ * again once its interval has passed */
+static void estimate_constraints(struct powerhal_info *pInfo,
+                                 const std::vector<Resource>& resources)
+{
+    printf("Worst case outstanding constraints:\n");
+    for (auto &resource : resources) {
+        int timed = 0;
+        bool unbounded = false;
+
+        for (auto &it : *resource.hints) {
+            auto interval = pInfo->hint_interval.find(it.first);
+
+            if (!hint_is_timed_boost(it.first) || it.second.time_ms <= 0)
+                continue;
+            if (interval == pInfo->hint_interval.end() || !interval->second) {
+                unbounded = true;
+                continue;
+            }
+            timed += (it.second.time_ms + interval->second - 1) / interval->second;
+        }
+
+        if (unbounded)
+            printf("  %-12s unbounded, a timed hint has no interval\n", resource.name.c_str());
+        else
+            printf("  %-12s %d (%d timed, %d held)\n", resource.name.c_str(),
+                   timed + resource.held, timed, resource.held);
+    }
+}
+
+static void check_governor(struct powerhal_info *pInfo)
+{
+    const governor_profiles_t &profiles = pInfo->governor_profiles;
+
+    if (profiles.modes.empty())
+        return;
+
+    printf("Governor %s profiles in %s:\n", profiles.governor.c_str(), profiles.path.c_str());
+    for (int mode = 0; mode < GOVERNOR_MODE_COUNT; mode++) {
+        auto it = profiles.modes.find(mode);
+
+        if (it == profiles.modes.end() || it->second.empty()) {
+            report(false, "governor profile %s is missing, its tunables are left as they are",
+                   governor_mode_name(mode));
+            continue;
+        }
+        printf("  %s:", governor_mode_name(mode));
+        for (auto &tunable : it->second)
+            printf(" %s=%s", tunable.name.c_str(), tunable.value.c_str());
+        printf("\n");
+    }
+}
+
+static void check_floor(struct powerhal_info *pInfo, const opp_table_t& opps)
+{
+    const power_floor_config_t &floor = pInfo->power_floor;
+
+    for (size_t i = 0; i < floor.states.size(); i++) {
+        const floor_state_t &state = floor.states[i];
+        std::string what = "floor_state " + std::to_string(i);
+        bool known = state.supply.empty();
+
+        for (auto &supply : floor.supplies)
+            known |= supply.name == state.supply;
+        if (!known)
+            report(true, "%s: unknown supply %s, it never applies", what.c_str(),
+                   state.supply.c_str());
+
+        for (auto &c : state.cpu) {
+            if (c.cluster >= (int)pInfo->cpu_clusters.size()) {
+                report(true, "%s: cluster %d does not exist", what.c_str(), c.cluster);
+                continue;
+            }
+            for (size_t j = 0; j < pInfo->cpu_clusters.size(); j++) {
+                if (c.cluster < 0 || c.cluster == (int)j)
+                    check_range(opps, what, "cpu" + std::to_string(j), c.min, c.max);
+            }
+        }
+        for (auto &c : state.gpu)
+            check_range(opps, what, "gpu", c.min, c.max);
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-t opp_table] config.xml\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    struct powerhal_info *pInfo = new powerhal_info();
+    std::vector<Resource> resources;
+    opp_table_t opps;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        switch (opt) {
+        case 't':
+            if (load_opp_table(optarg, opps))
+                return 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    config_file = argv[optind];
+
+    parse_xml_set_report_hook(parser_report);
+    if (parse_xml_file(pInfo, config_file, false)) {
+        printf("%s: error: cannot be read\n", config_file);
+        return 1;
+    }
+
+    if (pInfo->cpu_clusters.empty())
+        report(true, "no cpu_cluster, cpu hints have nowhere to go");
+    for (auto &it : opps) {
+        int cluster;
+
+        if (sscanf(it.first.c_str(), "cpu%d", &cluster) == 1 &&
+            cluster >= (int)pInfo->cpu_clusters.size())
+            report(false, "OPP table has %s, the config has %zu clusters",
+                   it.first.c_str(), pInfo->cpu_clusters.size());
+    }
+
+    for (size_t i = 0; i < pInfo->cpu_clusters.size(); i++)
+        resources.push_back({"cpu" + std::to_string(i), &pInfo->cpu_clusters[i].hints, HELD_CPU});
+    resources.push_back({"gpu", &pInfo->gpu_freq_hints, HELD_GPU});
+    resources.push_back({"emc", &pInfo->emc_freq_hints, HELD_EMC});
+    resources.push_back({"online_cpus", &pInfo->online_cpu_hints, HELD_ONLINE_CPUS});
+
+    check_hints(pInfo, resources, opps);
+    estimate_constraints(pInfo, resources);
+    check_governor(pInfo);
+    check_floor(pInfo, opps);
+
+    printf("%d errors, %d warnings\n", errors, warnings);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::config_cache"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "powerhal_config_cache.h"
+#include "powerhal_utils.h"
+
+#define FINGERPRINT_PROP "ro.vendor.build.fingerprint"
+// Length written in place of a string for a NULL pointer
+#define NULL_STRING UINT32_MAX
+
+typedef std::map<ExtPowerHint,power_hint_data_t> hint_map_t;
+
+static uint32_t fnv1a(const uint8_t *data, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void make_key(config_cache_header_t *hdr, const char *xml_path,
+                     const struct stat *st)
+{
+    char fingerprint[PROPERTY_VALUE_MAX];
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = POWERHAL_CONFIG_CACHE_MAGIC;
+    hdr->version = POWERHAL_CONFIG_CACHE_VERSION;
+    hdr->src_mtime_sec = st->st_mtim.tv_sec;
+    hdr->src_mtime_nsec = st->st_mtim.tv_nsec;
+    hdr->src_size = st->st_size;
+    snprintf(hdr->src_path, sizeof(hdr->src_path), "%s", xml_path);
+
+    property_get(FINGERPRINT_PROP, fingerprint, "");
+    snprintf(hdr->fingerprint, sizeof(hdr->fingerprint), "%s", fingerprint);
+}
+
+namespace {
+
+class Writer {
+public:
+    void u32(uint32_t v) { mBuf.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void i32(int32_t v) { u32(static_cast<uint32_t>(v)); }
+    void u64(uint64_t v) { mBuf.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+    void str(const char *s) {
+        if (!s) {
+            u32(NULL_STRING);
+            return;
+        }
+        u32(strlen(s));
+        mBuf.append(s);
+    }
+
+    void hints(const hint_map_t& hints) {
+        u32(hints.size());
+        for (auto &it : hints) {
+            i32(static_cast<int32_t>(it.first));
+            i32(it.second.min);
+            i32(it.second.max);
+            i32(it.second.time_ms);
+        }
+    }
+
+    void floors(const std::vector<floor_constraint_t>& floors) {
+        u32(floors.size());
+        for (auto &floor : floors) {
+            i32(floor.cluster);
+            i32(floor.min);
+            i32(floor.max);
+        }
+    }
+
+    const std::string& data() const { return mBuf; }
+
+private:
+    std::string mBuf;
+};
+
+/* Reads back what Writer wrote. Any read past the end marks the reader
+ * failed and returns zeroes, so callers check ok() once at the end. */
+class Reader {
+public:
+    Reader(const uint8_t *data, size_t len) : mPos(data), mEnd(data + len), mOk(true) {}
+
+    bool failed() const { return !mOk; }
+    // Everything was read and nothing was left over
+    bool ok() const { return mOk && mPos == mEnd; }
+
+    uint32_t u32() {
+        uint32_t v = 0;
+        take(&v, sizeof(v));
+        return v;
+    }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    uint64_t u64() {
+        uint64_t v = 0;
+        take(&v, sizeof(v));
+        return v;
+    }
+
+    // Returns a malloc'ed copy, NULL for a NULL string or on error
+    char *str() {
+        uint32_t len = u32();
+        char *s;
+
+        if (len == NULL_STRING || !mOk)
+            return NULL;
+        if ((size_t)(mEnd - mPos) < len) {
+            mOk = false;
+            return NULL;
+        }
+        s = strndup(reinterpret_cast<const char*>(mPos), len);
+        mPos += len;
+        return s;
+    }
+
+    std::string string() {
+        char *s = str();
+        std::string out = s ? s : "";
+
+        free(s);
+        return out;
+    }
+
+    void hints(hint_map_t& hints) {
+        uint32_t count = u32();
+
+        for (uint32_t i = 0; i < count && mOk; i++) {
+            ExtPowerHint hint = static_cast<ExtPowerHint>(i32());
+            power_hint_data_t &data = hints[hint];
+
+            data.min = i32();
+            data.max = i32();
+            data.time_ms = i32();
+        }
+    }
+
+    void floors(std::vector<floor_constraint_t>& floors) {
+        uint32_t count = u32();
+
+        for (uint32_t i = 0; i < count && mOk; i++) {
+            floor_constraint_t floor;
+
+            floor.cluster = i32();
+            floor.min = i32();
+            floor.max = i32();
+            floors.push_back(floor);
+        }
+    }
+
+private:
+    void take(void *out, size_t len) {
+        if (!mOk || (size_t)(mEnd - mPos) < len) {
+            mOk = false;
+            return;
+        }
+        memcpy(out, mPos, len);
+        mPos += len;
+    }
+
+    const uint8_t *mPos;
+    const uint8_t *mEnd;
+    bool mOk;
+};
+
+}  // namespace
+
+void config_cache_store(const struct powerhal_info *pInfo, const char *xml_path,
+                        const struct stat *st)
+{
+    std::string tmp = std::string(POWERHAL_CONFIG_CACHE_PATH) + ".tmp";
+    config_cache_header_t hdr;
+    Writer w;
+    int fd;
+
+    if (strlen(xml_path) >= CONFIG_CACHE_MAX_PATH)
+        return;
+
+    w.u32(pInfo->no_cpufreq_interactive);
+    w.u32(pInfo->no_sclk_boost);
+    w.i32(pInfo->boot_boost_time_ms);
+
+    w.u32(pInfo->input_devs.size());
+    for (auto &dev : pInfo->input_devs)
+        w.str(dev.dev_name);
+
+    w.u32(pInfo->cpu_clusters.size());
+    for (auto &cluster : pInfo->cpu_clusters) {
+        w.str(cluster.pmqos_constraint_path);
+        w.str(cluster.available_freqs_path);
+        w.hints(cluster.hints);
+    }
+
+    w.u32(pInfo->hint_interval.size());
+    for (auto &it : pInfo->hint_interval) {
+        w.i32(static_cast<int32_t>(it.first));
+        w.u64(it.second);
+    }
+
+    w.hints(pInfo->gpu_freq_hints);
+    w.hints(pInfo->emc_freq_hints);
+    w.hints(pInfo->online_cpu_hints);
+
+    w.str(pInfo->governor_profiles.governor.c_str());
+    w.str(pInfo->governor_profiles.path.c_str());
+    w.u32(pInfo->governor_profiles.modes.size());
+    for (auto &profile : pInfo->governor_profiles.modes) {
+        w.i32(profile.first);
+        w.u32(profile.second.size());
+        for (auto &tunable : profile.second) {
+            w.str(tunable.name.c_str());
+            w.str(tunable.value.c_str());
+        }
+    }
+
+    w.u32(pInfo->power_floor.platforms.size());
+    for (auto &platform : pInfo->power_floor.platforms)
+        w.str(platform.c_str());
+    w.u32(pInfo->power_floor.supplies.size());
+    for (auto &supply : pInfo->power_floor.supplies) {
+        w.str(supply.name.c_str());
+        w.str(supply.prop.c_str());
+        w.u32(supply.ids.size());
+        for (auto &id : supply.ids) {
+            w.str(id.prefix.c_str());
+            w.i32(id.min);
+            w.i32(id.max);
+        }
+    }
+    w.u32(pInfo->power_floor.states.size());
+    for (auto &state : pInfo->power_floor.states) {
+        w.str(state.supply.c_str());
+        w.i32(state.interactive);
+        w.i32(state.priority);
+        w.floors(state.cpu);
+        w.floors(state.gpu);
+        w.u32(state.knobs.size());
+        for (auto &knob : state.knobs) {
+            w.str(knob.path.c_str());
+            w.str(knob.value.c_str());
+            w.str(knob.wait.c_str());
+        }
+    }
+
+    w.i32(pInfo->thermal_policy.interval_ms);
+    w.i32(pInfo->thermal_policy.fast_interval_ms);
+    w.u32(pInfo->thermal_policy.zones.size());
+    for (auto &zone : pInfo->thermal_policy.zones) {
+        w.str(zone.type.c_str());
+        w.i32(zone.trip);
+        w.i32(zone.margin);
+        w.i32(zone.scale);
+        for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++)
+            w.i32(zone.caps[i]);
+    }
+
+    w.str(pInfo->fan_curve_config.zone.c_str());
+    w.i32(pInfo->fan_curve_config.interval_ms);
+    w.i32(pInfo->fan_curve_config.hysteresis);
+    w.i32(pInfo->fan_curve_config.slew);
+    w.u32(pInfo->fan_curve_config.points.size());
+    for (auto &point : pInfo->fan_curve_config.points) {
+        w.i32(point.temp);
+        w.i32(point.pwm);
+    }
+
+    w.i32(pInfo->power_cap_config.interval_ms);
+    w.i32(pInfo->power_cap_config.deadband);
+    w.i32(pInfo->power_cap_config.min_scale);
+    w.i32(pInfo->power_cap_config.min_cores);
+    w.i32(pInfo->power_cap_config.gpu_max);
+    w.u32(pInfo->power_cap_config.rails.size());
+    for (auto &rail : pInfo->power_cap_config.rails) {
+        w.str(rail.hwmon.c_str());
+        w.str(rail.label.c_str());
+        w.i32(rail.channel);
+    }
+
+    make_key(&hdr, xml_path, st);
+    hdr.payload_size = w.data().size();
+    hdr.checksum = fnv1a(reinterpret_cast<const uint8_t*>(w.data().data()), w.data().size());
+
+    // Written aside and renamed, so a reader never maps a partial cache
+    fd = root_open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        ALOGW("Cannot create %s: %s", tmp.c_str(), strerror(errno));
+        return;
+    }
+
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        write(fd, w.data().data(), w.data().size()) != (ssize_t)w.data().size()) {
+        ALOGW("Cannot write %s: %s", tmp.c_str(), strerror(errno));
+        close(fd);
+        unlink(root_path(tmp.c_str()).c_str());
+        return;
+    }
+    close(fd);
+
+    if (rename(root_path(tmp.c_str()).c_str(), root_path(POWERHAL_CONFIG_CACHE_PATH).c_str())) {
+        ALOGW("Cannot rename %s: %s", tmp.c_str(), strerror(errno));
+        unlink(root_path(tmp.c_str()).c_str());
+        return;
+    }
+
+    ALOGI("Cached config from %s (%zu bytes)", xml_path, w.data().size());
+}
+
+static int decode(struct powerhal_info *pInfo, const uint8_t *payload, size_t len)
+{
+    Reader r(payload, len);
+    bool no_cpufreq_interactive, no_sclk_boost;
+    int boot_boost_time_ms;
+    std::vector<struct input_dev_map> input_devs;
+    std::vector<cpu_cluster_data_t> cpu_clusters;
+    std::map<ExtPowerHint,uint64_t> hint_interval;
+    hint_map_t gpu_freq_hints, emc_freq_hints, online_cpu_hints;
+    governor_profiles_t governor_profiles;
+    power_floor_config_t power_floor;
+    thermal_policy_t thermal_policy;
+    fan_curve_config_t fan_curve_config;
+    power_cap_config_t power_cap_config;
+    uint32_t count;
+
+    no_cpufreq_interactive = r.u32();
+    no_sclk_boost = r.u32();
+    boot_boost_time_ms = r.i32();
+
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        char *name = r.str();
+        if (name)
+            input_devs.push_back({-1, name});
+    }
+
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        cpu_clusters.push_back({});
+        cpu_clusters.back().pmqos_constraint_path = r.str();
+        cpu_clusters.back().available_freqs_path = r.str();
+        r.hints(cpu_clusters.back().hints);
+    }
+
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        ExtPowerHint hint = static_cast<ExtPowerHint>(r.i32());
+        hint_interval[hint] = r.u64();
+    }
+
+    r.hints(gpu_freq_hints);
+    r.hints(emc_freq_hints);
+    r.hints(online_cpu_hints);
+
+    governor_profiles.governor = r.string();
+    governor_profiles.path = r.string();
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        std::vector<governor_tunable_t> &tunables = governor_profiles.modes[r.i32()];
+        uint32_t tunable_count = r.u32();
+
+        for (uint32_t j = 0; j < tunable_count && !r.failed(); j++) {
+            governor_tunable_t tunable;
+
+            tunable.name = r.string();
+            tunable.value = r.string();
+            tunables.push_back(tunable);
+        }
+    }
+
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++)
+        power_floor.platforms.push_back(r.string());
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        floor_supply_t supply;
+        uint32_t id_count;
+
+        supply.name = r.string();
+        supply.prop = r.string();
+        id_count = r.u32();
+        for (uint32_t j = 0; j < id_count && !r.failed(); j++) {
+            floor_supply_id_t id;
+
+            id.prefix = r.string();
+            id.min = r.i32();
+            id.max = r.i32();
+            supply.ids.push_back(id);
+        }
+        power_floor.supplies.push_back(supply);
+    }
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        floor_state_t state;
+        uint32_t knob_count;
+
+        state.supply = r.string();
+        state.interactive = r.i32();
+        state.priority = r.i32();
+        r.floors(state.cpu);
+        r.floors(state.gpu);
+        knob_count = r.u32();
+        for (uint32_t j = 0; j < knob_count && !r.failed(); j++) {
+            floor_knob_t knob;
+
+            knob.path = r.string();
+            knob.value = r.string();
+            knob.wait = r.string();
+            state.knobs.push_back(knob);
+        }
+        power_floor.states.push_back(state);
+    }
+
+    thermal_policy.interval_ms = r.i32();
+    thermal_policy.fast_interval_ms = r.i32();
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        thermal_zone_policy_t zone;
+
+        zone.type = r.string();
+        zone.trip = r.i32();
+        zone.margin = r.i32();
+        zone.scale = r.i32();
+        for (int j = 0; j < THERMAL_RESOURCE_COUNT; j++)
+            zone.caps[j] = r.i32();
+        thermal_policy.zones.push_back(zone);
+    }
+
+    fan_curve_config.zone = r.string();
+    fan_curve_config.interval_ms = r.i32();
+    fan_curve_config.hysteresis = r.i32();
+    fan_curve_config.slew = r.i32();
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        fan_point_t point;
+
+        point.temp = r.i32();
+        point.pwm = r.i32();
+        fan_curve_config.points.push_back(point);
+    }
+
+    power_cap_config.interval_ms = r.i32();
+    power_cap_config.deadband = r.i32();
+    power_cap_config.min_scale = r.i32();
+    power_cap_config.min_cores = r.i32();
+    power_cap_config.gpu_max = r.i32();
+    count = r.u32();
+    for (uint32_t i = 0; i < count && !r.failed(); i++) {
+        power_rail_t rail;
+
+        rail.hwmon = r.string();
+        rail.label = r.string();
+        rail.channel = r.i32();
+        power_cap_config.rails.push_back(rail);
+    }
+
+    if (!r.ok()) {
+        // Nothing was handed to pInfo, so the strings read so far are ours
+        for (auto &dev : input_devs)
+            free(const_cast<char*>(dev.dev_name));
+        for (auto &cluster : cpu_clusters) {
+            free(const_cast<char*>(cluster.pmqos_constraint_path));
+            free(const_cast<char*>(cluster.available_freqs_path));
+        }
+        return -1;
+    }
+
+    pInfo->no_cpufreq_interactive = no_cpufreq_interactive;
+    pInfo->no_sclk_boost = no_sclk_boost;
+    pInfo->boot_boost_time_ms = boot_boost_time_ms;
+    pInfo->input_devs = input_devs;
+    pInfo->cpu_clusters = cpu_clusters;
+    pInfo->hint_interval = hint_interval;
+    pInfo->gpu_freq_hints = gpu_freq_hints;
+    pInfo->emc_freq_hints = emc_freq_hints;
+    pInfo->online_cpu_hints = online_cpu_hints;
+    pInfo->governor_profiles = governor_profiles;
+    pInfo->power_floor = power_floor;
+    pInfo->thermal_policy = thermal_policy;
+    pInfo->fan_curve_config = fan_curve_config;
+    pInfo->power_cap_config = power_cap_config;
+    return 0;
+}
+
+int config_cache_load(struct powerhal_info *pInfo, const char *xml_path,
+                      const struct stat *st)
+{
+    config_cache_header_t key;
+    const config_cache_header_t *hdr;
+    const uint8_t *payload;
+    struct stat cache_st;
+    void *map;
+    int ret = -1;
+    int fd;
+
+    fd = root_open(POWERHAL_CONFIG_CACHE_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &cache_st) || cache_st.st_size < (off_t)sizeof(config_cache_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    hdr = static_cast<const config_cache_header_t*>(map);
+    payload = reinterpret_cast<const uint8_t*>(hdr + 1);
+    make_key(&key, xml_path, st);
+
+    if (hdr->magic != key.magic || hdr->version != key.version) {
+        ALOGI("Config cache has another format, ignoring it");
+    } else if (hdr->src_mtime_sec != key.src_mtime_sec ||
+               hdr->src_mtime_nsec != key.src_mtime_nsec ||
+               hdr->src_size != key.src_size ||
+               strncmp(hdr->src_path, key.src_path, sizeof(key.src_path)) ||
+               strncmp(hdr->fingerprint, key.fingerprint, sizeof(key.fingerprint))) {
+        ALOGI("Config cache is stale, reparsing %s", xml_path);
+    } else if (sizeof(*hdr) + hdr->payload_size != (size_t)cache_st.st_size ||
+               fnv1a(payload, hdr->payload_size) != hdr->checksum) {
+        ALOGW("Config cache is corrupt, ignoring it");
+    } else if (decode(pInfo, payload, hdr->payload_size)) {
+        ALOGW("Config cache could not be decoded, ignoring it");
+    } else {
+        ALOGI("Using cached config for %s", xml_path);
+        ret = 0;
+    }
+
+    munmap(map, cache_st.st_size);
+    return ret;
+}
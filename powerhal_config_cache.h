@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_CONFIG_CACHE_H
+#define POWER_HAL_CONFIG_CACHE_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "powerhal.h"
+
+/*
+ * Binary cache of the configuration read from powerhal.<hw>.xml. Once an
+ * XML file has been parsed, everything parse_xml() filled into
+ * powerhal_info is written to POWERHAL_CONFIG_CACHE_PATH, and on later
+ * starts it is mapped and copied back instead of running expat.
+ *
+ * The cache is keyed by the XML path, mtime and size, and by the vendor
+ * build fingerprint: Android builds stamp every file with the same mtime,
+ * so an OTA that changes the XML or this HAL's defaults is only told
+ * apart by the fingerprint. The payload is checksummed, and a cache that
+ * fails any check is ignored and rewritten.
+ *
+ * Bump POWERHAL_CONFIG_CACHE_VERSION whenever the parser learns to fill
+ * another field.
+ */
+#define POWERHAL_CONFIG_CACHE_PATH      "/data/vendor/powerhal/config.cache"
+#define POWERHAL_CONFIG_CACHE_MAGIC     0x43434850  /* "PHCC" */
+#define POWERHAL_CONFIG_CACHE_VERSION   6
+
+#define CONFIG_CACHE_MAX_PATH           128
+#define CONFIG_CACHE_MAX_FINGERPRINT    96
+
+typedef struct config_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t payload_size;
+    uint32_t checksum;      // FNV-1a of the payload
+    int64_t src_mtime_sec;
+    int64_t src_mtime_nsec;
+    int64_t src_size;
+    char src_path[CONFIG_CACHE_MAX_PATH];
+    char fingerprint[CONFIG_CACHE_MAX_FINGERPRINT];
+} config_cache_header_t;
+
+/* Fills pInfo from the cache if it was made from xml_path as it is now.
+ * Returns 0 on success, -1 if the XML has to be parsed. */
+int config_cache_load(struct powerhal_info *pInfo, const char *xml_path,
+                      const struct stat *st);
+
+/* Saves what parse_xml() filled in, for the next start */
+void config_cache_store(const struct powerhal_info *pInfo, const char *xml_path,
+                        const struct stat *st);
+
+#endif  // POWER_HAL_CONFIG_CACHE_H
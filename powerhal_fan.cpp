@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::fan"
+
+#include <algorithm>
+#include <limits.h>
+#include <stdio.h>
+
+#include "powerhal_fan.h"
+
+FanCurve *FanCurve::create(struct powerhal_info *pInfo, const fan_curve_config_t& config)
+{
+    std::vector<thermal_zone_node_t> zones;
+    FanCurve *fan;
+
+    if (config.points.empty())
+        return NULL;
+
+    if (!pInfo->features.fan) {
+        ALOGW("No fan, ignoring the fan curve");
+        return NULL;
+    }
+
+    zones = thermal_zone_open(config.zone);
+    if (zones.empty()) {
+        ALOGE("No thermal zone %s, ignoring the fan curve", config.zone.c_str());
+        return NULL;
+    }
+
+    ALOGI("Fan curve: %zu points on %s", config.points.size(), config.zone.c_str());
+    fan = new FanCurve(pInfo, config, zones);
+    fan->sample();
+    return fan;
+}
+
+FanCurve::FanCurve(struct powerhal_info *pInfo, const fan_curve_config_t& config,
+                   const std::vector<thermal_zone_node_t>& zones) :
+    mInfo(pInfo),
+    mConfig(config),
+    mZones(zones),
+    mTemp(INT_MIN),
+    mTarget(-1),
+    mPwm(-1),
+    mCap(std::max(0, std::min(pInfo->defaults.fan_cap, FAN_PWM_MAX))),
+    mWritten(-1)
+{
+}
+
+int FanCurve::curveAt(int temp) const
+{
+    const std::vector<fan_point_t> &points = mConfig.points;
+
+    if (temp <= points.front().temp)
+        return points.front().pwm;
+
+    for (size_t i = 1; i < points.size(); i++) {
+        const fan_point_t &lo = points[i - 1];
+        const fan_point_t &hi = points[i];
+
+        if (temp > hi.temp)
+            continue;
+        return lo.pwm + (int)((int64_t)(hi.pwm - lo.pwm) * (temp - lo.temp) /
+                              (hi.temp - lo.temp));
+    }
+    return points.back().pwm;
+}
+
+/* Called with mLock held */
+void FanCurve::write()
+{
+    int pwm = std::min(mPwm, mCap);
+
+    if (pwm < 0 || pwm == mWritten)
+        return;
+
+    sysfs_write_int(FAN_PWM_CAP_NODE, pwm);
+    mWritten = pwm;
+}
+
+/* Runs on the looper */
+void FanCurve::sample()
+{
+    Mutex::Autolock _l(mLock);
+    int temp = INT_MIN;
+    int target;
+
+    for (auto &zone : mZones)
+        temp = std::max(temp, thermal_zone_read(zone.fd));
+
+    if (temp != INT_MIN) {
+        mTemp = temp;
+        target = curveAt(temp);
+
+        // Slowing down waits until the zone has cooled by the hysteresis
+        if (target < mTarget)
+            target = std::min(mTarget, curveAt(temp + mConfig.hysteresis));
+        mTarget = target;
+
+        if (mPwm < 0 || !mConfig.slew)
+            mPwm = mTarget;
+        else if (mTarget > mPwm)
+            mPwm = std::min(mTarget, mPwm + mConfig.slew);
+        else
+            mPwm = std::max(mTarget, mPwm - mConfig.slew);
+
+        write();
+    }
+
+    mInfo->mTimeoutPoker->postTaskDelayed(new SampleTask(this), ms2ns(mConfig.interval_ms));
+}
+
+void FanCurve::setCap(int cap)
+{
+    Mutex::Autolock _l(mLock);
+
+    mCap = std::max(0, std::min(cap, FAN_PWM_MAX));
+    write();
+}
+
+void FanCurve::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    char line[160];
+
+    snprintf(line, sizeof(line), "Fan curve: %s at %d, pwm %d (target %d, cap %d, written %d)\n",
+             mConfig.zone.c_str(), mTemp, mPwm, mTarget, mCap, mWritten);
+    out += line;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_FAN_H
+#define POWER_HAL_FAN_H
+
+#include <string>
+#include <vector>
+
+#include "powerhal.h"
+#include "powerhal_thermal.h"
+
+#define FAN_PWM_CAP_NODE "/sys/devices/platform/pwm-fan/pwm_cap"
+#define FAN_PWM_MAX 255
+#define FAN_INTERVAL_MS 2000
+
+/*
+ * Fan speed following a thermal zone along a curve, from the <fan_curve>
+ * section of the XML:
+ *
+ *   <fan_curve zone="thermal-fan-est" interval="2000" hysteresis="3000" slew="16">
+ *     <fan_point temp="45000" pwm="0"/>
+ *     <fan_point temp="60000" pwm="70"/>
+ *     <fan_point temp="80000" pwm="255"/>
+ *   </fan_curve>
+ *
+ * The hottest zone of the type is sampled from the looper every interval
+ * ms. The pwm is interpolated between the points and held at the first
+ * and last point's pwm outside them. It goes up as soon as the curve
+ * does, but only comes down once the zone has cooled by hysteresis
+ * millidegrees. Each sample moves it by at most slew. The result is
+ * written to pwm_cap, which bounds the kernel's fan governor, whenever
+ * it changes.
+ *
+ * The APP_PROFILE fan cap, or its default, is an upper bound on the
+ * curve rather than being written directly. Until the first APP_PROFILE
+ * the default cap applies.
+ */
+class FanCurve {
+public:
+    /* Returns NULL if the curve is empty or its zone does not exist */
+    static FanCurve *create(struct powerhal_info *pInfo, const fan_curve_config_t& config);
+
+    void setCap(int cap);
+    void dump(std::string& out);
+
+private:
+    class SampleTask : public TimeoutPoker::Task {
+    public:
+        SampleTask(FanCurve *fan) : fan(fan) {}
+        virtual void run() { fan->sample(); }
+    private:
+        FanCurve *fan;
+    };
+
+    FanCurve(struct powerhal_info *pInfo, const fan_curve_config_t& config,
+             const std::vector<thermal_zone_node_t>& zones);
+
+    int curveAt(int temp) const;
+    void sample();
+    void write();
+
+    struct powerhal_info *mInfo;
+    const fan_curve_config_t mConfig;
+    const std::vector<thermal_zone_node_t> mZones;
+
+    Mutex mLock;
+    int mTemp;
+    // Curve value the slew limit moves towards, and the pwm it has reached
+    int mTarget;
+    int mPwm;
+    int mCap;
+    // Last value written to pwm_cap, -1 for none
+    int mWritten;
+};
+
+#endif  // POWER_HAL_FAN_H
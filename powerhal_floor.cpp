@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::floor"
+
+#include <ctype.h>
+#include <linux/magic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/inotify.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#include "powerhal_floor.h"
+
+// Knobs waiting for a node that cannot be watched check for it this
+// often, and give up after FLOOR_WAIT_TRIES checks. The GPU takes a few
+// seconds to show up at boot.
+#define FLOOR_WAIT_POLL_MS 1000
+#define FLOOR_WAIT_TRIES 5
+
+static bool platform_matches(const power_floor_config_t& config)
+{
+    char platform[PROPERTY_VALUE_MAX];
+
+    if (config.platforms.empty())
+        return true;
+
+    property_get(HARDWARE_TYPE_PROP, platform, "");
+    for (auto &prefix : config.platforms) {
+        if (!strncmp(platform, prefix.c_str(), prefix.size()))
+            return true;
+    }
+    return false;
+}
+
+static bool supply_id_matches(const floor_supply_id_t& id, const char *value)
+{
+    const char *digits = value + id.prefix.size();
+    char *end;
+    long num;
+
+    if (strncmp(value, id.prefix.c_str(), id.prefix.size()))
+        return false;
+    if (id.min < 0)
+        return *digits == '\0';
+
+    if (!isdigit(*digits))
+        return false;
+    num = strtol(digits, &end, 10);
+    return *end == '\0' && num >= id.min && num <= id.max;
+}
+
+PlatformFloor *PlatformFloor::create(struct powerhal_info *pInfo,
+                                     const power_floor_config_t& config)
+{
+    if (config.states.empty())
+        return NULL;
+
+    if (!platform_matches(config)) {
+        ALOGI("Platform floors do not apply to this platform");
+        return NULL;
+    }
+
+    for (auto &state : config.states) {
+        bool known = state.supply.empty();
+
+        for (auto &supply : config.supplies)
+            known |= supply.name == state.supply;
+        if (!known)
+            ALOGE("Unknown power supply %s, its floor state never applies",
+                  state.supply.c_str());
+
+        for (auto &c : state.cpu) {
+            if (c.cluster >= (int)pInfo->cpu_clusters.size())
+                ALOGE("Invalid cluster id: %d, its floor is ignored", c.cluster);
+        }
+    }
+
+    ALOGI("Platform floors: %zu states", config.states.size());
+    return new PlatformFloor(pInfo, config);
+}
+
+PlatformFloor::PlatformFloor(struct powerhal_info *pInfo, const power_floor_config_t& config) :
+    mInfo(pInfo),
+    mConfig(config),
+    mState(NULL),
+    mCpuHandles(pInfo->cpu_clusters.size(), -1),
+    mGpuHandle(-1),
+    mWaitGeneration(0),
+    mWaitTries(0),
+    mWatchFd(-1),
+    mWatchWd(-1)
+{
+    for (auto &supply : mConfig.supplies)
+        mSupplyProps.emplace_back(new CachedProperty(supply.prop.c_str()));
+}
+
+bool PlatformFloor::supplyMatches(const std::string& name)
+{
+    for (size_t i = 0; i < mConfig.supplies.size(); i++) {
+        const floor_supply_t &supply = mConfig.supplies[i];
+        std::string value;
+
+        if (supply.name != name)
+            continue;
+
+        value = mSupplyProps[i]->get();
+        for (auto &id : supply.ids) {
+            if (supply_id_matches(id, value.c_str()))
+                return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+const floor_state_t *PlatformFloor::match(bool on)
+{
+    for (auto &state : mConfig.states) {
+        if (state.interactive >= 0 && state.interactive != on)
+            continue;
+        if (!state.supply.empty() && !supplyMatches(state.supply))
+            continue;
+        return &state;
+    }
+    return NULL;
+}
+
+void PlatformFloor::applyConstraints(const floor_state_t *state)
+{
+    for (size_t i = 0; i < mCpuHandles.size(); i++) {
+        ResourceBackend *backend = mInfo->cpu_clusters[i].backend;
+        const floor_constraint_t *floor = NULL;
+
+        if (state) {
+            for (auto &c : state->cpu) {
+                if (c.cluster < 0 || c.cluster == (int)i)
+                    floor = &c;
+            }
+        }
+
+        if (floor) {
+            int top = cluster_freq_top(&mInfo->cpu_clusters[i]);
+
+            resource_update(backend, &mCpuHandles[i], state->priority, floor->max,
+                            thermal_boost_min(mInfo, THERMAL_CPU, floor->min, top));
+        } else {
+            resource_release(backend, &mCpuHandles[i]);
+        }
+    }
+
+    if (state && !state->gpu.empty())
+        resource_update(mInfo->resources.gpu, &mGpuHandle, state->priority,
+                        state->gpu.back().max,
+                        thermal_boost_min(mInfo, THERMAL_GPU, state->gpu.back().min, 0));
+    else
+        resource_release(mInfo->resources.gpu, &mGpuHandle);
+}
+
+/* Called with mLock held. Returns true if the node will be reported by
+ * inotify when it is created. */
+bool PlatformFloor::watchNode(const std::string& path)
+{
+    std::string dir = path.substr(0, path.rfind('/'));
+    struct statfs fs;
+
+    if (mWatchWd >= 0 && dir == mWatchDir)
+        return true;
+    unwatchNode();
+
+    // Nodes the kernel adds to sysfs raise no inotify events
+    if (statfs(root_path(dir.c_str()).c_str(), &fs) || fs.f_type == SYSFS_MAGIC)
+        return false;
+
+    if (mWatchFd < 0) {
+        mWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (mWatchFd < 0) {
+            ALOGE("Cannot create inotify instance: %s", strerror(errno));
+            return false;
+        }
+        if (mInfo->mTimeoutPoker->watchFd(mWatchFd, onWatchEvent, this)) {
+            ALOGE("Cannot poll inotify events");
+            close(mWatchFd);
+            mWatchFd = -1;
+            return false;
+        }
+    }
+
+    mWatchWd = inotify_add_watch(mWatchFd, root_path(dir.c_str()).c_str(),
+                                 IN_CREATE | IN_MOVED_TO);
+    if (mWatchWd < 0) {
+        ALOGW("Cannot watch %s: %s", dir.c_str(), strerror(errno));
+        return false;
+    }
+    mWatchDir = dir;
+    return true;
+}
+
+/* Called with mLock held */
+void PlatformFloor::unwatchNode()
+{
+    if (mWatchWd < 0)
+        return;
+
+    inotify_rm_watch(mWatchFd, mWatchWd);
+    mWatchWd = -1;
+    mWatchDir.clear();
+}
+
+int PlatformFloor::onWatchEvent(__attribute__((unused)) int fd, int events, void *data)
+{
+    PlatformFloor *floor = static_cast<PlatformFloor*>(data);
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    Mutex::Autolock _l(floor->mLock);
+
+    if (events & (ALOOPER_EVENT_ERROR | ALOOPER_EVENT_HANGUP)) {
+        ALOGE("inotify fd failed, dropping %zu knobs", floor->mPending.size());
+        // The looper drops the fd, the next wait starts a new instance
+        close(floor->mWatchFd);
+        floor->mWatchFd = -1;
+        floor->mWatchWd = -1;
+        floor->mWatchDir.clear();
+        floor->mPending.clear();
+        return 0;
+    }
+
+    // Any entry created in the directory may be the node, so the events
+    // themselves do not matter
+    while (read(floor->mWatchFd, buf, sizeof(buf)) > 0)
+        ;
+
+    if (!floor->mPending.empty())
+        floor->writeKnobs();
+    return 1;
+}
+
+/* Called with mLock held */
+void PlatformFloor::writeKnobs()
+{
+    size_t written;
+
+    // Knobs go out in order, so the first one still waiting holds back
+    // the rest
+    for (written = 0; written < mPending.size(); written++) {
+        const floor_knob_t *knob = mPending[written];
+
+        // The node may be created between the check and the watch, so
+        // look for it again once watched
+        if (!knob->wait.empty() && root_access(knob->wait.c_str(), F_OK) &&
+            (!watchNode(knob->wait) || root_access(knob->wait.c_str(), F_OK)))
+            break;
+        sysfs_write(knob->path.c_str(), knob->value.c_str());
+    }
+    mPending.erase(mPending.begin(), mPending.begin() + written);
+
+    if (mPending.empty()) {
+        unwatchNode();
+        return;
+    }
+
+    // The node's creation brings us back
+    if (mWatchWd >= 0)
+        return;
+
+    if (++mWaitTries > FLOOR_WAIT_TRIES) {
+        ALOGE("%s is missing, skipping %zu knobs", mPending[0]->wait.c_str(), mPending.size());
+        mPending.clear();
+        return;
+    }
+
+    mInfo->mTimeoutPoker->postTaskDelayed(new WaitTask(this, mWaitGeneration),
+                                          ms2ns(FLOOR_WAIT_POLL_MS));
+}
+
+void PlatformFloor::checkWait(int generation)
+{
+    Mutex::Autolock _l(mLock);
+
+    // Superseded by a later interactive change
+    if (generation != mWaitGeneration)
+        return;
+
+    writeKnobs();
+}
+
+void PlatformFloor::setInteractive(bool on)
+{
+    Mutex::Autolock _l(mLock);
+    const floor_state_t *state = match(on);
+
+    if (state != mState)
+        ALOGI("Platform floor state %d", state ? (int)(state - &mConfig.states[0]) : -1);
+    mState = state;
+    applyConstraints(state);
+
+    // Knobs of the previous state still waiting are dropped
+    mPending.clear();
+    mWaitGeneration++;
+    mWaitTries = 0;
+    if (state) {
+        for (auto &knob : state->knobs)
+            mPending.push_back(&knob);
+    }
+    writeKnobs();
+}
+
+void PlatformFloor::refresh()
+{
+    Mutex::Autolock _l(mLock);
+
+    if (mState)
+        applyConstraints(mState);
+}
+
+void PlatformFloor::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    char line[160];
+
+    if (!mState) {
+        out += "Platform floor: none\n";
+        return;
+    }
+
+    snprintf(line, sizeof(line), "Platform floor: state %d (supply %s, interactive %d)\n",
+             (int)(mState - &mConfig.states[0]),
+             mState->supply.empty() ? "any" : mState->supply.c_str(), mState->interactive);
+    out += line;
+    for (size_t i = 0; i < mCpuHandles.size(); i++) {
+        if (mCpuHandles[i] < 0)
+            continue;
+        snprintf(line, sizeof(line), "  cpu%zu handle %d\n", i, mCpuHandles[i]);
+        out += line;
+    }
+    if (mGpuHandle >= 0) {
+        snprintf(line, sizeof(line), "  gpu handle %d\n", mGpuHandle);
+        out += line;
+    }
+    if (!mPending.empty()) {
+        snprintf(line, sizeof(line), "  %zu knobs waiting for %s (%s)\n",
+                 mPending.size(), mPending[0]->wait.c_str(),
+                 mWatchWd >= 0 ? "watched" : "polled");
+        out += line;
+    }
+}
+
+void set_power_level_floor(struct powerhal_info *pInfo, int on)
+{
+    if (pInfo && pInfo->platform_floor)
+        pInfo->platform_floor->setInteractive(on);
+}
+
+#if TARGET_TEGRA_VERSION == 210
+#define BRICK_STATE_PROP "persist.vendor.power.brick"
+#define CPU_CC_STATE_NODE "/sys/kernel/debug/cpuidle_t210/fast_cluster_states_enable"
+#define CPU_CC_IDLE "1"         // 0x1
+#define CPU_CC_ON "207"         // 0xcf
+#define CPU_CEILING_IDLE 1836000
+#define CPU_CEILING_ON 2014500
+#define CPU_FLOOR_ON 1132800
+#define CPU_FLOOR_IDLE 1734000
+#define CPU_FLOOR_WHITELIST 1100000
+#define ETHERNET_POWER_SAVER_NODE "/sys/kernel/rt8168_power/mode"
+#define GPU_FLOOR_ON 768000
+#define GPU_FLOOR_IDLE 844800
+#define GPU_FLOOR_WHITELIST 384000
+#define GPU_RAIL_GATE_NODE "/sys/devices/gpu.0/railgate_enable"
+#define GPU_STATE "/dev/nvhost-gpu"
+#define GPU_BLCG_NODE "/sys/devices/gpu.0/blcg_enable"
+#define GPU_ELCG_NODE "/sys/devices/gpu.0/elcg_enable"
+#define GPU_ELPG_NODE "/sys/devices/gpu.0/elpg_enable"
+#define GPU_SLCG_NODE "/sys/devices/gpu.0/slcg_enable"
+#define SOC_DISABLE_DVFS_NODE "/sys/module/tegra210_dvfs/parameters/disable_core"
+
+static void add_gpu_knobs(floor_state_t *state, bool on)
+{
+    if (on) {
+        state->knobs.push_back({GPU_ELCG_NODE, "1", GPU_STATE});
+        state->knobs.push_back({GPU_BLCG_NODE, "1", GPU_STATE});
+        state->knobs.push_back({GPU_SLCG_NODE, "1", GPU_STATE});
+        state->knobs.push_back({GPU_ELPG_NODE, "1", GPU_STATE});
+    } else {
+        state->knobs.push_back({GPU_RAIL_GATE_NODE, "0", GPU_STATE});
+        state->knobs.push_back({GPU_ELPG_NODE, "0", GPU_STATE});
+        state->knobs.push_back({GPU_SLCG_NODE, "0", GPU_STATE});
+        state->knobs.push_back({GPU_BLCG_NODE, "0", GPU_STATE});
+        state->knobs.push_back({GPU_ELCG_NODE, "0", GPU_STATE});
+    }
+}
+
+/* darcy and sif run the SoC harder on power supplies that are not
+ * known to deliver enough current */
+void power_floor_defaults(power_floor_config_t *config)
+{
+    floor_state_t state;
+
+    config->platforms = { "darcy", "sif" };
+    config->supplies.push_back({"whitelisted", BRICK_STATE_PROP,
+                                {{"PBTEST", -1, -1}, {"PB", 1706, 9999}}});
+
+    state = floor_state_t();
+    state.supply = "whitelisted";
+    state.interactive = -1;
+    state.priority = PM_QOS_PLATFORM_FLOOR_PRIORITY;
+    state.cpu.push_back({-1, CPU_FLOOR_WHITELIST, CPU_CEILING_ON});
+    state.gpu.push_back({-1, GPU_FLOOR_WHITELIST, PM_QOS_DEFAULT_VALUE});
+    state.knobs.push_back({ETHERNET_POWER_SAVER_NODE, "1", ""});
+    state.knobs.push_back({SOC_DISABLE_DVFS_NODE, "0", ""});
+    state.knobs.push_back({CPU_CC_STATE_NODE, CPU_CC_ON, ""});
+    add_gpu_knobs(&state, true);
+    config->states.push_back(state);
+
+    for (int on = 1; on >= 0; on--) {
+        state = floor_state_t();
+        state.interactive = on;
+        state.priority = PM_QOS_PLATFORM_FLOOR_PRIORITY;
+        state.cpu.push_back({-1, on ? CPU_FLOOR_ON : CPU_FLOOR_IDLE,
+                                 on ? CPU_CEILING_ON : CPU_CEILING_IDLE});
+        state.gpu.push_back({-1, on ? GPU_FLOOR_ON : GPU_FLOOR_IDLE, PM_QOS_DEFAULT_VALUE});
+        state.knobs.push_back({CPU_CC_STATE_NODE, on ? CPU_CC_ON : CPU_CC_IDLE, ""});
+        state.knobs.push_back({ETHERNET_POWER_SAVER_NODE, "0", ""});
+        state.knobs.push_back({SOC_DISABLE_DVFS_NODE, "1", ""});
+        add_gpu_knobs(&state, false);
+        config->states.push_back(state);
+    }
+}
+#else
+void power_floor_defaults(__attribute__((unused)) power_floor_config_t *config)
+{
+}
+#endif
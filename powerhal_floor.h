@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_FLOOR_H
+#define POWER_HAL_FLOOR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "powerhal.h"
+#include "powerhal_props.h"
+
+/*
+ * Platform floors, ceilings and knobs that depend on the power supply and
+ * the interactive state. They come from the <power_floor> section of the
+ * XML, or on T210 from the built-in darcy/sif table:
+ *
+ *   <power_floor>
+ *     <platform name="darcy"/>
+ *     <supply name="whitelisted" prop="persist.vendor.power.brick">
+ *       <supply_id prefix="PBTEST"/>
+ *       <supply_id prefix="PB" min="1706" max="9999"/>
+ *     </supply>
+ *     <floor_state supply="whitelisted">
+ *       <cpu_freq min="1100000" max="2014500"/>
+ *       <gpu_freq min="384000"/>
+ *       <knob path="/sys/kernel/rt8168_power/mode" value="1"/>
+ *       <knob path="/sys/devices/gpu.0/elpg_enable" value="1" wait="/dev/nvhost-gpu"/>
+ *     </floor_state>
+ *     <floor_state interactive="0">
+ *       ...
+ *     </floor_state>
+ *   </power_floor>
+ *
+ * Platforms are matched as prefixes of ro.hardware once at init; with
+ * none listed the floors apply everywhere. A supply_id without a range
+ * matches its prefix exactly, with one it matches the prefix followed by
+ * a number in [min, max].
+ *
+ * On every interactive change the first floor_state whose supply and
+ * interactive conditions hold is applied. Its cpu_freq (optionally per
+ * cluster) and gpu_freq ranges, in kHz, are held as requests at its
+ * priority, PM_QOS_PLATFORM_FLOOR_PRIORITY by default, so they combine
+ * with boosts instead of overwriting the nodes the backends drive, and
+ * their mins are subject to the thermal policy. Its
+ * knobs are written in order. A knob with a wait node that does not
+ * exist yet holds back itself and the knobs after it. The directory of
+ * the node is watched with inotify from the looper, and the knobs go out
+ * as soon as the node is created. Only the knobs of the current state
+ * are ever pending; an interactive change drops those of the previous
+ * one. If the directory cannot be watched the looper checks for the node
+ * every second for a few seconds instead.
+ */
+class PlatformFloor {
+public:
+    /* Returns NULL if the floors do not apply to this platform */
+    static PlatformFloor *create(struct powerhal_info *pInfo,
+                                 const power_floor_config_t& config);
+
+    void setInteractive(bool on);
+    /* Places the constraints of the current state again, after the
+     * thermal limits on their mins changed */
+    void refresh();
+    void dump(std::string& out);
+
+private:
+    class WaitTask : public TimeoutPoker::Task {
+    public:
+        WaitTask(PlatformFloor *floor, int generation) :
+            floor(floor), generation(generation) {}
+        virtual void run() { floor->checkWait(generation); }
+    private:
+        PlatformFloor *floor;
+        int generation;
+    };
+
+    PlatformFloor(struct powerhal_info *pInfo, const power_floor_config_t& config);
+
+    bool supplyMatches(const std::string& name);
+    const floor_state_t *match(bool on);
+    void applyConstraints(const floor_state_t *state);
+    void writeKnobs();
+    void checkWait(int generation);
+
+    static int onWatchEvent(int fd, int events, void *data);
+    bool watchNode(const std::string& path);
+    void unwatchNode();
+
+    struct powerhal_info *mInfo;
+    const power_floor_config_t mConfig;
+    Mutex mLock;
+
+    // Property of each of mConfig.supplies
+    std::vector<std::unique_ptr<CachedProperty>> mSupplyProps;
+
+    const floor_state_t *mState;
+    std::vector<int> mCpuHandles;
+    int mGpuHandle;
+
+    // Knobs of mState not written yet, waiting for their node
+    std::vector<const floor_knob_t*> mPending;
+    int mWaitGeneration;
+    int mWaitTries;
+
+    // inotify instance, created on the first wait, and the directory it
+    // watches for mPending[0]
+    int mWatchFd;
+    int mWatchWd;
+    std::string mWatchDir;
+};
+
+/* Built-in floors, empty where there are none */
+void power_floor_defaults(power_floor_config_t *config);
+
+#endif  // POWER_HAL_FLOOR_H
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::framepacer"
+
+#include <algorithm>
+
+#include "powerhal_framepacer.h"
+
+// Most frames a single FRAMERATE_DATA hint may carry
+#define PACER_MAX_BATCH 120
+// A frame presented later than this many frame budgets missed its deadline
+#define PACER_MISS_RATIO 1.5f
+// Gaps longer than this many budgets are pauses, not frames
+#define PACER_PAUSE_RATIO 4.0f
+// Weight of a new frame in the moving averages
+#define PACER_EWMA_WEIGHT (1.0f / 16)
+// Raise the floors above this miss rate
+#define PACER_MISS_HIGH 0.05f
+// Slack window to hold the floors in
+#define PACER_SLACK_LOW 0.10f
+#define PACER_SLACK_HIGH 0.30f
+// Position steps per batch
+#define PACER_STEP_UP 0.10f
+#define PACER_STEP_SMALL 0.02f
+#define PACER_STEP_DOWN 0.02f
+// Pacing ends when no frame data arrives for this long
+#define PACER_STALE_MS 1000
+
+FramePacer::FramePacer(struct powerhal_info *pInfo) :
+    mInfo(pInfo),
+    mVsync(false),
+    mActive(false),
+    mTargetFps(0),
+    mLastTimestamp(0),
+    mHaveTimestamp(false),
+    mLastData(0),
+    mStaleCheckPending(false),
+    mMissRate(0),
+    mSlack(0),
+    mHaveSlack(false),
+    mPosition(0),
+    mCpuHandles(pInfo->cpu_clusters.size(), -1),
+    mCpuFloors(pInfo->cpu_clusters.size(), 0),
+    mGpuHandle(-1),
+    mGpuFloor(0),
+    mEmcHandle(-1),
+    mEmcFloor(0)
+{
+}
+
+void FramePacer::setVsync(bool on)
+{
+    Mutex::Autolock _l(mLock);
+
+    mVsync = on;
+    applyFloors();
+}
+
+void FramePacer::ingest(const int32_t *data, size_t len)
+{
+    Mutex::Autolock _l(mLock);
+    int target_fps, count;
+
+    if (len < 1)
+        return;
+
+    target_fps = data[0];
+    if (target_fps <= 0) {
+        stop();
+        applyFloors();
+        return;
+    }
+
+    count = len >= 2 ? data[1] : -1;
+    if (count < 0 || count > PACER_MAX_BATCH) {
+        ALOGE("%s: invalid frame count %d", __func__, count);
+        return;
+    }
+    if (len < 2 + 2 * (size_t)count) {
+        ALOGE("%s: %d frames in %zu ints", __func__, count, len);
+        return;
+    }
+
+    if (!mActive || target_fps != mTargetFps) {
+        mActive = true;
+        mTargetFps = target_fps;
+        mHaveTimestamp = false;
+        mMissRate = 0;
+        mSlack = 0;
+        mHaveSlack = false;
+    }
+
+    float budget_us = 1000000.0f / target_fps;
+    const int32_t *frame = data + 2;
+
+    for (int i = 0; i < count; i++, frame += 2) {
+        uint32_t timestamp = static_cast<uint32_t>(frame[0]);
+        int proc_us = frame[1];
+
+        if (mHaveTimestamp) {
+            float ratio = (uint32_t)(timestamp - mLastTimestamp) / budget_us;
+
+            if (ratio < PACER_PAUSE_RATIO) {
+                float miss = ratio > PACER_MISS_RATIO ? 1.0f : 0.0f;
+                mMissRate += PACER_EWMA_WEIGHT * (miss - mMissRate);
+            }
+        }
+        mLastTimestamp = timestamp;
+        mHaveTimestamp = true;
+
+        if (proc_us > 0) {
+            float slack = 1.0f - proc_us / budget_us;
+            if (!mHaveSlack)
+                mSlack = slack;
+            mSlack += PACER_EWMA_WEIGHT * (slack - mSlack);
+            mHaveSlack = true;
+        }
+    }
+
+    // Without processing times only the miss rate can tell whether the
+    // floors are too high.
+    if (mMissRate > PACER_MISS_HIGH)
+        mPosition += PACER_STEP_UP * std::min(2.0f, mMissRate / PACER_MISS_HIGH);
+    else if (!mHaveSlack)
+        mPosition -= mMissRate < PACER_MISS_HIGH / 4 ? PACER_STEP_DOWN : 0;
+    else if (mSlack < PACER_SLACK_LOW)
+        mPosition += PACER_STEP_SMALL;
+    else if (mSlack > PACER_SLACK_HIGH)
+        mPosition -= PACER_STEP_DOWN;
+    mPosition = std::min(1.0f, std::max(0.0f, mPosition));
+
+    mLastData = powerhal_time();
+    if (!mStaleCheckPending) {
+        mStaleCheckPending = true;
+        mInfo->mTimeoutPoker->postTaskDelayed(new StaleCheckTask(this),
+                                              ms2ns(PACER_STALE_MS));
+    }
+
+    applyFloors();
+
+    ALOGV("%s: fps=%d miss=%.3f slack=%.3f position=%.2f", __func__,
+          mTargetFps, mMissRate, mSlack, mPosition);
+}
+
+/* Must be called with mLock held */
+void FramePacer::stop()
+{
+    mActive = false;
+    mTargetFps = 0;
+    mPosition = 0;
+}
+
+void FramePacer::checkStale()
+{
+    Mutex::Autolock _l(mLock);
+    nsecs_t now = powerhal_time();
+
+    mStaleCheckPending = false;
+    if (!mActive)
+        return;
+
+    if (now - mLastData >= ms2ns(PACER_STALE_MS)) {
+        stop();
+        applyFloors();
+        return;
+    }
+
+    mStaleCheckPending = true;
+    mInfo->mTimeoutPoker->postTaskDelayed(new StaleCheckTask(this),
+            ms2ns(PACER_STALE_MS) - (now - mLastData));
+}
+
+/* Holds floor on handle, or drops the request for a zero floor. Nothing
+ * is written if the floor did not change. */
+static void set_floor(ResourceBackend *backend, int *handle, int *current, int floor)
+{
+    if (floor == *current)
+        return;
+    *current = floor;
+
+    if (floor > 0)
+        resource_update(backend, handle, PM_QOS_BOOST_PRIORITY,
+                        PM_QOS_DEFAULT_VALUE, floor);
+    else
+        resource_release(backend, handle);
+}
+
+/* Must be called with mLock held. While pacing, floors follow mPosition
+ * over the whole frequency table for CPUs and up to the VSYNC entry for
+ * GPU and EMC. Otherwise the static VSYNC CPU floor applies if enabled. */
+void FramePacer::applyFloors()
+{
+    std::shared_ptr<const hint_config_t> config = hint_config_get(mInfo);
+    const power_hint_data_t *vsync;
+    int gpu = 0, emc = 0;
+
+    for (size_t i = 0; i < mInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cluster = mInfo->cpu_clusters[i];
+        int floor = 0;
+
+        if (mActive)
+            floor = cluster_freq_at(&cluster, mPosition);
+        else if (mVsync && (vsync = hint_find(config->cpu_hints[i], ExtPowerHint::VSYNC)))
+            floor = vsync->min;
+
+        set_floor(cluster.backend, &mCpuHandles[i], &mCpuFloors[i],
+                  thermal_boost_min(mInfo, THERMAL_CPU, floor, cluster_freq_top(&cluster)));
+    }
+
+    if (mActive) {
+        if ((vsync = hint_find(config->gpu_freq_hints, ExtPowerHint::VSYNC)))
+            gpu = mPosition * vsync->min;
+        if ((vsync = hint_find(config->emc_freq_hints, ExtPowerHint::VSYNC)))
+            emc = mPosition * vsync->min;
+    }
+
+    set_floor(mInfo->resources.gpu, &mGpuHandle, &mGpuFloor,
+              thermal_boost_min(mInfo, THERMAL_GPU, gpu, 0));
+    set_floor(mInfo->resources.emc, &mEmcHandle, &mEmcFloor,
+              thermal_boost_min(mInfo, THERMAL_EMC, emc, 0));
+}
+
+void FramePacer::refresh()
+{
+    Mutex::Autolock _l(mLock);
+
+    applyFloors();
+}
+
+void FramePacer::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    char line[160];
+
+    snprintf(line, sizeof(line),
+             "Frame pacer: vsync=%d active=%d target=%dfps miss_rate=%.3f slack=%.3f position=%.2f\n",
+             mVsync, mActive, mTargetFps, mMissRate, mSlack, mPosition);
+    out += line;
+    for (size_t i = 0; i < mCpuHandles.size(); i++) {
+        snprintf(line, sizeof(line), "  cpu%zu floor %d (handle %d)\n",
+                 i, mCpuFloors[i], mCpuHandles[i]);
+        out += line;
+    }
+    snprintf(line, sizeof(line), "  gpu floor %d (handle %d)\n", mGpuFloor, mGpuHandle);
+    out += line;
+    snprintf(line, sizeof(line), "  emc floor %d (handle %d)\n", mEmcFloor, mEmcHandle);
+    out += line;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_FRAMEPACER_H
+#define POWER_HAL_FRAMEPACER_H
+
+#include <vector>
+
+#include "powerhal.h"
+
+/*
+ * Closed-loop frame pacing. FRAMERATE_DATA carries the target frame rate
+ * and a batch of frames:
+ *
+ *   {target_fps, count, timestamp_us, proc_us, timestamp_us, proc_us, ...}
+ *
+ * timestamp_us is the frame's presentation time truncated to 32 bits;
+ * only differences between timestamps are used, so wrapping is fine.
+ * proc_us is the time spent producing the frame, or 0 if unknown. A
+ * target_fps of 0 ends pacing. Data shorter than its count says is
+ * dropped.
+ *
+ * From these the pacer tracks the deadline miss rate and the average
+ * slack, and moves the CPU, GPU and EMC floors up or down to keep misses
+ * rare without idling at a needlessly high clock. While no frame data
+ * arrives, an enabled VSYNC hint falls back to the static VSYNC floor.
+ * Like boosts, the floors are lowered by the thermal policy.
+ */
+class FramePacer {
+public:
+    FramePacer(struct powerhal_info *pInfo);
+
+    void setVsync(bool on);
+    /* len is the number of ints at data */
+    void ingest(const int32_t *data, size_t len);
+    /* Places the floors again, after the thermal limits on them changed */
+    void refresh();
+    void dump(std::string& out);
+
+private:
+    class StaleCheckTask : public TimeoutPoker::Task {
+    public:
+        StaleCheckTask(FramePacer *pacer) : pacer(pacer) {}
+        virtual void run() { pacer->checkStale(); }
+    private:
+        FramePacer *pacer;
+    };
+
+    void stop();
+    void checkStale();
+    void applyFloors();
+
+    struct powerhal_info *mInfo;
+    Mutex mLock;
+
+    bool mVsync;
+    bool mActive;
+    int mTargetFps;
+    uint32_t mLastTimestamp;
+    bool mHaveTimestamp;
+    nsecs_t mLastData;
+    bool mStaleCheckPending;
+
+    // Exponential averages over recent frames
+    float mMissRate;
+    float mSlack;
+    bool mHaveSlack;
+    // Normalized floor position, 0 is no floor and 1 the top of each
+    // resource's pacing range.
+    float mPosition;
+
+    std::vector<int> mCpuHandles;
+    std::vector<int> mCpuFloors;
+    int mGpuHandle;
+    int mGpuFloor;
+    int mEmcHandle;
+    int mEmcFloor;
+};
+
+#endif  // POWER_HAL_FRAMEPACER_H
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::governor"
+
+#include <map>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "powerhal_governor.h"
+
+// Index of a tunable whose node could not be opened
+#define NO_NODE SIZE_MAX
+
+static const char *governor_mode_names[GOVERNOR_MODE_COUNT] = {
+    "max_perf",
+    "opt_perf",
+    "bat_save",
+    "usr_cust",
+    "display_off",
+};
+
+const char *governor_mode_name(int mode)
+{
+    if (mode < 0 || mode >= GOVERNOR_MODE_COUNT)
+        return "none";
+    return governor_mode_names[mode];
+}
+
+int governor_mode_id(const char *name)
+{
+    for (int mode = 0; mode < GOVERNOR_MODE_COUNT; mode++) {
+        if (!strcmp(governor_mode_names[mode], name))
+            return mode;
+    }
+    return -1;
+}
+
+GovernorPlan *GovernorPlan::build(const governor_profiles_t& profiles)
+{
+    GovernorPlan *plan = new GovernorPlan(profiles.governor);
+    // Node index by tunable name
+    std::map<std::string, size_t> nodes;
+    size_t writes = 0;
+
+    for (auto &profile : profiles.modes) {
+        if (profile.first < 0 || profile.first >= GOVERNOR_MODE_COUNT)
+            continue;
+
+        for (auto &tunable : profile.second) {
+            auto it = nodes.find(tunable.name);
+
+            if (it == nodes.end()) {
+                Node node = { profiles.path + "/" + tunable.name, -1 };
+
+                node.fd = root_open(node.path.c_str(), O_WRONLY | O_CLOEXEC);
+                if (node.fd < 0) {
+                    ALOGE("Cannot open %s: %s, dropping it from all profiles",
+                          node.path.c_str(), strerror(errno));
+                    it = nodes.emplace(tunable.name, NO_NODE).first;
+                } else {
+                    it = nodes.emplace(tunable.name, plan->mNodes.size()).first;
+                    plan->mNodes.push_back(node);
+                }
+            }
+
+            if (it->second == NO_NODE)
+                continue;
+            plan->mPlans[profile.first].push_back({it->second, tunable.value});
+            writes++;
+        }
+    }
+
+    if (!writes) {
+        ALOGE("No %s tunables can be written", profiles.governor.c_str());
+        delete plan;
+        return NULL;
+    }
+
+    for (int mode = 0; mode < GOVERNOR_MODE_COUNT; mode++) {
+        if (plan->mPlans[mode].empty())
+            ALOGW("No %s profile for %s, its tunables are left as they are",
+                  profiles.governor.c_str(), governor_mode_name(mode));
+    }
+
+    ALOGI("%s profiles: %zu tunables, %zu writes", profiles.governor.c_str(),
+          plan->mNodes.size(), writes);
+    return plan;
+}
+
+GovernorPlan::~GovernorPlan()
+{
+    for (auto &node : mNodes) {
+        if (node.fd >= 0)
+            close(node.fd);
+    }
+}
+
+int GovernorPlan::writeNode(Node& node, const std::string& value)
+{
+    if (node.fd >= 0 &&
+        pwrite(node.fd, value.data(), value.size(), 0) == (ssize_t)value.size())
+        return 0;
+
+    // Restarting the governor recreates its nodes, so try a fresh fd
+    if (node.fd >= 0)
+        close(node.fd);
+    node.fd = root_open(node.path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (node.fd >= 0 &&
+        pwrite(node.fd, value.data(), value.size(), 0) == (ssize_t)value.size())
+        return 0;
+
+    ALOGE("Error writing %s to %s: %s", value.c_str(), node.path.c_str(), strerror(errno));
+    return -1;
+}
+
+/* Called with mLock held */
+void GovernorPlan::applyLocked(int mode)
+{
+    if (mode < 0 || mode >= GOVERNOR_MODE_COUNT)
+        return;
+
+    for (auto &w : mPlans[mode])
+        writeNode(mNodes[w.node], w.value);
+    mMode = mode;
+}
+
+void GovernorPlan::apply(int mode)
+{
+    Mutex::Autolock _l(mLock);
+
+    applyLocked(mode);
+}
+
+void GovernorPlan::update(int mode)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (mMode < 0 || mMode == static_cast<int>(NvCPLHintData::NVCPL_HINT_COUNT) ||
+        mode == mMode)
+        return;
+
+    ALOGI("Power mode changed to %s", governor_mode_name(mode));
+    applyLocked(mode);
+}
+
+int GovernorPlan::mode()
+{
+    Mutex::Autolock _l(mLock);
+
+    return mMode;
+}
+
+void GovernorPlan::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    char line[160];
+
+    snprintf(line, sizeof(line), "Governor %s tunables:\n", mGovernor.c_str());
+    out += line;
+    for (int mode = 0; mode < GOVERNOR_MODE_COUNT; mode++) {
+        snprintf(line, sizeof(line), "  %s:", governor_mode_name(mode));
+        out += line;
+        for (auto &w : mPlans[mode]) {
+            const std::string &path = mNodes[w.node].path;
+
+            out += " " + path.substr(path.rfind('/') + 1) + "=" + w.value;
+        }
+        out += "\n";
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_GOVERNOR_H
+#define POWER_HAL_GOVERNOR_H
+
+#include <string>
+#include <vector>
+
+#include "powerhal.h"
+
+/*
+ * cpufreq governor tunables per power mode. The profiles come from the
+ * <governor_profiles> section of the XML, or the built-in interactive
+ * tables on T124 and T210:
+ *
+ *   <governor_profiles governor="interactive"
+ *                      path="/sys/devices/system/cpu/cpufreq/interactive">
+ *     <profile mode="max_perf">
+ *       <tunable name="hispeed_freq" value="1122000"/>
+ *       ...
+ *     </profile>
+ *     ...
+ *   </governor_profiles>
+ *
+ * Modes are max_perf, opt_perf, bat_save, usr_cust and display_off.
+ * Tunables are written in the order given.
+ *
+ * At init the profiles are turned into a GovernorPlan if the running
+ * scaling governor is the one named. Every tunable node is opened once,
+ * and nodes that cannot be opened are dropped from all profiles, so a
+ * mode switch is a fixed list of writes to open fds.
+ */
+
+#define GOVERNOR_MODE_COUNT (static_cast<int>(NvCPLHintData::NVCPL_HINT_COUNT) + 1)
+
+/* XML name of an NvCPLHintData, "none" if out of range */
+const char *governor_mode_name(int mode);
+/* NvCPLHintData for an XML mode name, -1 if unknown */
+int governor_mode_id(const char *name);
+
+class GovernorPlan {
+public:
+    /* Returns NULL if none of the tunables can be written */
+    static GovernorPlan *build(const governor_profiles_t& profiles);
+    ~GovernorPlan();
+
+    /* Writes the tunables of mode, an NvCPLHintData */
+    void apply(int mode);
+    /* Same, but only while a display-on mode is applied, so a power mode
+     * change with the display off waits for the next screen on */
+    void update(int mode);
+    /* Last mode applied, -1 for none */
+    int mode();
+    void dump(std::string& out);
+
+private:
+    struct Node {
+        std::string path;
+        int fd;
+    };
+
+    struct Write {
+        size_t node;
+        std::string value;
+    };
+
+    GovernorPlan(const std::string& governor) : mGovernor(governor), mMode(-1) {}
+    int writeNode(Node& node, const std::string& value);
+    void applyLocked(int mode);
+
+    const std::string mGovernor;
+    Mutex mLock;
+    std::vector<Node> mNodes;
+    std::vector<Write> mPlans[GOVERNOR_MODE_COUNT];
+    int mMode;
+};
+
+#endif  // POWER_HAL_GOVERNOR_H
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::idle"
+
+#include <algorithm>
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "powerhal_idle.h"
+#include "powerhal_utils.h"
+
+#define CPU_SYSFS_PATH "/sys/devices/system/cpu"
+
+/* Lists the entries of dir named prefix<N>, in numeric order */
+static std::vector<int> list_numbered(const std::string& dir, const char *prefix)
+{
+    std::vector<int> ids;
+    size_t len = strlen(prefix);
+    DIR *d = opendir(root_path(dir.c_str()).c_str());
+    struct dirent *de;
+
+    if (!d)
+        return ids;
+
+    while ((de = readdir(d)) != NULL) {
+        char *end;
+        long id;
+
+        if (strncmp(de->d_name, prefix, len))
+            continue;
+        id = strtol(de->d_name + len, &end, 10);
+        if (end != de->d_name + len && *end == '\0')
+            ids.push_back(id);
+    }
+    closedir(d);
+
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+static int read_u64(int fd, uint64_t *value)
+{
+    char buf[32];
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    *value = strtoull(buf, NULL, 10);
+    return 0;
+}
+
+IdleStats::IdleStats()
+{
+    for (int cpu : list_numbered(CPU_SYSFS_PATH, "cpu")) {
+        if (!probe(cpu))
+            mPending.push_back(cpu);
+    }
+
+    ALOGI("Tracking %zu idle states over %zu cpuidle nodes, %zu CPUs pending",
+          mStates.size(), mNodes.size(), mPending.size());
+}
+
+IdleStats::~IdleStats()
+{
+    for (auto &node : mNodes) {
+        close(node.time_fd);
+        close(node.usage_fd);
+    }
+}
+
+size_t IdleStats::probe(int cpu)
+{
+    std::string cpu_name = "cpu" + std::to_string(cpu);
+    std::string idle_dir = CPU_SYSFS_PATH "/" + cpu_name + "/cpuidle";
+    size_t found = 0;
+
+    for (int state : list_numbered(idle_dir, "state")) {
+        std::string dir = idle_dir + "/state" + std::to_string(state);
+        char name[32] = "";
+        Node node;
+
+        sysfs_read((dir + "/name").c_str(), name, sizeof(name));
+        name[strcspn(name, "\n")] = '\0';
+        if (!name[0])
+            continue;
+
+        node.state = name;
+        node.cpu = cpu_name;
+        node.time_fd = root_open((dir + "/time").c_str(), O_RDONLY | O_CLOEXEC);
+        node.usage_fd = root_open((dir + "/usage").c_str(), O_RDONLY | O_CLOEXEC);
+        if (node.time_fd < 0 || node.usage_fd < 0) {
+            ALOGE("Cannot open cpuidle stats in %s", dir.c_str());
+            close(node.time_fd);
+            close(node.usage_fd);
+            continue;
+        }
+
+        if (std::find(mStates.begin(), mStates.end(), node.state) == mStates.end())
+            mStates.push_back(node.state);
+        mNodes.push_back(node);
+        found++;
+    }
+
+    return found;
+}
+
+void IdleStats::read(std::vector<idle_state_t>& states)
+{
+    Mutex::Autolock _l(mLock);
+
+    // CPUs that were offline at startup show their states once online
+    mPending.erase(std::remove_if(mPending.begin(), mPending.end(),
+            [this](int cpu) { return probe(cpu) > 0; }), mPending.end());
+
+    states.clear();
+    for (auto &name : mStates)
+        states.push_back({ name, UINT64_MAX, UINT64_MAX, {} });
+
+    for (auto &node : mNodes) {
+        uint64_t time_us, usage;
+
+        if (read_u64(node.time_fd, &time_us) || read_u64(node.usage_fd, &usage))
+            continue;
+
+        auto state = std::find_if(states.begin(), states.end(),
+                [&](const idle_state_t& s) { return s.name == node.state; });
+        state->voters.push_back({ node.cpu, time_us / 1000, usage });
+        state->residency_ms = std::min(state->residency_ms, time_us / 1000);
+        state->transitions = std::min(state->transitions, usage);
+    }
+
+    // Drop states none of whose nodes could be read
+    states.erase(std::remove_if(states.begin(), states.end(),
+            [](const idle_state_t& s) { return s.voters.empty(); }), states.end());
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_IDLE_H
+#define POWER_HAL_IDLE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "timeoutpoker.h"
+
+typedef struct idle_voter {
+    std::string name;
+    uint64_t time_ms;
+    uint64_t usage;
+} idle_voter_t;
+
+typedef struct idle_state {
+    std::string name;
+    uint64_t residency_ms;
+    uint64_t transitions;
+    std::vector<idle_voter_t> voters;
+} idle_state_t;
+
+/*
+ * Idle state residency for getPlatformLowPowerStats. Every cpuidle state
+ * of every CPU is found once, and its time and usage nodes are kept open
+ * and re-read with pread(), so polling costs no directory walk or open.
+ * On Tegra the cluster states (CC6, CC7) are cpuidle states too.
+ *
+ * States are reported by name, with one voter per CPU. A state's
+ * residency and transitions are the lowest of its voters', which bounds
+ * from above how long all CPUs spent in it at once. A CPU that has no
+ * states yet, e.g. one offline at startup, is probed again on each read
+ * until it reports some.
+ */
+class IdleStats {
+public:
+    IdleStats();
+    ~IdleStats();
+
+    // Fills states with every state that could be read, possibly none
+    void read(std::vector<idle_state_t>& states);
+
+private:
+    struct Node {
+        std::string state;
+        std::string cpu;
+        int time_fd;
+        int usage_fd;
+    };
+
+    // Returns the number of nodes added for cpu
+    size_t probe(int cpu);
+
+    Mutex mLock;
+    std::vector<Node> mNodes;
+    // CPUs with no cpuidle states so far
+    std::vector<int> mPending;
+    // State names in the order they were found
+    std::vector<std::string> mStates;
+};
+
+#endif  // POWER_HAL_IDLE_H
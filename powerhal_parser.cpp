@@ -15,17 +15,24 @@
  */
 #define LOG_TAG "powerHAL::parser"
 
+#include <algorithm>
+#include <climits>
 #include <cstring>
-#include <fstream>
-#include <map>
-#include <stack>
+#include <stdarg.h>
+#include <initializer_list>
 #include <string>
-#include <vector>
 #include <array>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <expat.h>
 
+#include "powerhal_config_cache.h"
+#include "powerhal_fan.h"
+#include "powerhal_governor.h"
 #include "powerhal_parser.h"
+#include "powerhal_powercap.h"
+#include "powerhal_thermal.h"
 #include "powerhal_utils.h"
 #include "powerhal.h"
 
@@ -33,7 +40,15 @@ using ::vendor::nvidia::hardware::power::V1_0::ExtPowerHint;
 
 #define XML_FILE_PREFIX "powerhal."
 #define XML_FILE_SUFFIX ".xml"
-#define MAX_LINE_SIZE 256
+
+// Element names are dispatched through a perfect hash: the top
+// XML_HASH_BITS of FNV-1a started from XML_HASH_SEED. The low bits
+// would only depend on the low bits of the seed. The static_assert below
+// proves it collision-free over xml_element_names; an element added
+// later that collides needs another seed.
+#define XML_HASH_BITS 6
+#define XML_HASH_SIZE (1 << XML_HASH_BITS)
+#define XML_HASH_SEED 1786u
 
 static std::array<std::string, 4>  defaultXmlPath = {
 {
@@ -44,6 +59,11 @@ static std::array<std::string, 4>  defaultXmlPath = {
 }
 };
 
+static parse_xml_report_hook_t report_hook;
+
+/* Logs a problem with the XML being parsed, with its line */
+static void xml_error(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
 static int parse_int(const char *str, int *num)
 {
     char *endstr;
@@ -63,14 +83,14 @@ static int get_bool(const char *type, const char *value)
 {
     int val = -1;
     if (parse_int(value, &val) || val < 0) {
-        ALOGE("%s is not a valid number", value);
+        xml_error("%s is not a valid number", value);
         return -1;
     }
 
     if (!strcmp(type, "enable"))
         return !!val;
 
-    ALOGE("Unknown attribute: %s", type);
+    xml_error("Unknown attribute: %s", type);
     return -1;
 }
 
@@ -79,7 +99,7 @@ static void set_hint_value(power_hint_data_t *hint, const char *type,
 {
     int val = -1;
     if (parse_int(value, &val) || val < 0) {
-        ALOGE("%s is not a valid number", value);
+        xml_error("%s is not a valid number", value);
         return;
     }
     if (!strcmp(type, "min")) {
@@ -89,7 +109,7 @@ static void set_hint_value(power_hint_data_t *hint, const char *type,
     } else if (!strcmp(type, "duration")) {
         hint->time_ms = val;
     } else {
-        ALOGE("Unknown attribute: %s", type);
+        xml_error("Unknown attribute: %s", type);
     }
 }
 
@@ -102,7 +122,72 @@ static void reset_hint(power_hint_data_t *hint)
 
 namespace {
 
-const std::map<std::string, ExtPowerHint> power_hint_ids = {
+constexpr unsigned xml_hash(const char *s)
+{
+    uint32_t h = XML_HASH_SEED;
+
+    for (; *s; s++) {
+        h ^= static_cast<uint8_t>(*s);
+        h *= 16777619u;
+    }
+    return h >> (32 - XML_HASH_BITS);
+}
+
+constexpr const char *xml_element_names[] = {
+    "powerhal",
+    "input_devices",
+    "input",
+    "cpu_cluster",
+    "pmqos_constraint",
+    "available_freqs",
+    "hints",
+    "hint",
+    "interval",
+    "cpu",
+    "gpu",
+    "emc",
+    "online_cpus",
+    "boot_boost",
+    "cpufreq_interactive",
+    "sclk_boost",
+    "governor_profiles",
+    "profile",
+    "tunable",
+    "power_floor",
+    "platform",
+    "supply",
+    "supply_id",
+    "floor_state",
+    "cpu_freq",
+    "gpu_freq",
+    "knob",
+    "thermal_policy",
+    "thermal_zone",
+    "fan_curve",
+    "fan_point",
+    "power_cap",
+    "power_rail",
+};
+
+constexpr bool xml_hash_is_perfect()
+{
+    uint64_t seen = 0;
+
+    for (const char *name : xml_element_names) {
+        uint64_t bit = 1ull << xml_hash(name);
+        if (seen & bit)
+            return false;
+        seen |= bit;
+    }
+    return true;
+}
+
+static_assert(xml_hash_is_perfect(), "XML element names collide, change XML_HASH_SEED");
+
+const struct {
+    const char *name;
+    ExtPowerHint id;
+} power_hint_ids[] = {
         {"VSYNC",             ExtPowerHint::VSYNC},
         {"INTERACTION",       ExtPowerHint::INTERACTION},
         {"VIDEO_ENCODE",      ExtPowerHint::VIDEO_ENCODE},
@@ -122,65 +207,77 @@ const std::map<std::string, ExtPowerHint> power_hint_ids = {
         {"AUDIO_LOW_LATENCY", ExtPowerHint::AUDIO_LOW_LATENCY}
 };
 
+class XmlElement;
+
+// Every element by the hash of its name, filled in by the constructors
+XmlElement *xml_elements[XML_HASH_SIZE];
+
 class XmlElement {
     public:
         virtual ~XmlElement() {};
         virtual void parse(__attribute__((unused)) struct powerhal_info *pInfo, __attribute__((unused)) const char **attrs) {}
         virtual void finish(__attribute__((unused)) struct powerhal_info *pInfo) {}
 
-        const std::string& name() const { return m_name; }
+        const char *name() const { return m_name; }
         XmlElement *parent() const { return m_parent; }
 
-        XmlElement *find_child(std::string name) const {
-            auto it = m_children.find(name);
-            if (it == m_children.end()) {
-                ALOGW("%s: unknown child element %s", m_name.c_str(), name.c_str());
+        XmlElement *find_child(const char *name) const {
+            unsigned id = xml_hash(name);
+            XmlElement *child = xml_elements[id];
+
+            if (!(m_children & (1ull << id)) || !child || strcmp(child->name(), name)) {
+                ALOGW("%s: unknown child element %s", m_name, name);
                 return NULL;
             }
-            return it->second;
+            return child;
         }
 
     protected:
         XmlElement(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children,
-                        std::string name) :
-                m_parent(parent), m_children(children), m_name(name) {}
+                        std::initializer_list<const char*> children,
+                        const char *name) :
+                m_parent(parent), m_children(0), m_name(name) {
+            for (const char *child : children)
+                m_children |= 1ull << xml_hash(child);
+            xml_elements[xml_hash(name)] = this;
+        }
 
         XmlElement *const m_parent;
-        const std::map<std::string, XmlElement*> m_children;
-        const std::string m_name;
+        // Bit per child element, by hash
+        uint64_t m_children;
+        const char *const m_name;
 };
 
 class XmlElementTop : public XmlElement {
     public:
         XmlElementTop(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "powerhal") {}
 };
 
 class XmlElementInputDevices : public XmlElement {
     public:
         XmlElementInputDevices(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "input_devices") {}
 };
 
 class XmlElementInput : public XmlElement {
     public:
         XmlElementInput(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "input") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             while (*attrs) {
                 if (strcmp(attrs[0], "name")) {
-                    ALOGE("Unknown input attribute: %s", attrs[0]);
+                    xml_error("Unknown input attribute: %s", attrs[0]);
                     attrs += 2;
                     continue;
                 }
                 const char *s = strdup(attrs[1]);
                 if (!s) {
-                    ALOGE("Couldn't copy %s: ", s);
+                    xml_error("Couldn't copy %s: ", s);
                 } else {
                     pInfo->input_devs.push_back({-1, s});
                 }
@@ -192,7 +289,7 @@ class XmlElementInput : public XmlElement {
 class XmlElementCpuCluster : public XmlElement {
     public:
         XmlElementCpuCluster(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "cpu_cluster") {}
 
         virtual void parse(struct powerhal_info *pInfo, __attribute__((unused)) const char **attrs) {
@@ -203,7 +300,7 @@ class XmlElementCpuCluster : public XmlElement {
 class XmlElementCpuPmqosConstraint : public XmlElement {
     public:
         XmlElementCpuPmqosConstraint(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "pmqos_constraint") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
@@ -212,9 +309,9 @@ class XmlElementCpuPmqosConstraint : public XmlElement {
                     pInfo->cpu_clusters.back().pmqos_constraint_path =
                             strdup(attrs[1]);
                     if (!pInfo->cpu_clusters.back().pmqos_constraint_path)
-                        ALOGE("Couldn't assign %s", attrs[1]);
+                        xml_error("Couldn't assign %s", attrs[1]);
                 } else {
-                    ALOGE("Unknown pmqos_constraint attribute: %s", attrs[0]);
+                    xml_error("Unknown pmqos_constraint attribute: %s", attrs[0]);
                 }
                 attrs += 2;
             }
@@ -224,7 +321,7 @@ class XmlElementCpuPmqosConstraint : public XmlElement {
 class XmlElementCpuAvailableFreqs : public XmlElement {
     public:
         XmlElementCpuAvailableFreqs(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "available_freqs") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
@@ -233,9 +330,9 @@ class XmlElementCpuAvailableFreqs : public XmlElement {
                     pInfo->cpu_clusters.back().available_freqs_path =
                             strdup(attrs[1]);
                     if (!pInfo->cpu_clusters.back().available_freqs_path)
-                        ALOGE("Couldn't assign %s", attrs[1]);
+                        xml_error("Couldn't assign %s", attrs[1]);
                 } else {
-                    ALOGE("Unknown available_freqs attribute: %s", attrs[0]);
+                    xml_error("Unknown available_freqs attribute: %s", attrs[0]);
                 }
                 attrs += 2;
             }
@@ -245,29 +342,30 @@ class XmlElementCpuAvailableFreqs : public XmlElement {
 class XmlElementHints : public XmlElement {
     public:
         XmlElementHints(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "hints") {}
 };
 
 class XmlElementHint : public XmlElement {
     public:
         XmlElementHint(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "hint") {}
 
         virtual void parse(__attribute__((unused)) struct powerhal_info *pInfo, const char **attrs) {
             m_hintId = static_cast<ExtPowerHint>(-1);
             for (; *attrs; attrs += 2) {
                 if (strcmp(attrs[0], "name")) {
-                    ALOGE("Unknown hint attribute: %s", attrs[0]);
+                    xml_error("Unknown hint attribute: %s", attrs[0]);
                     continue;
                 }
-                auto it = power_hint_ids.find(attrs[1]);
-                if (it == power_hint_ids.end()) {
-                    ALOGW("couldn't find hint %s", attrs[1]);
+                auto it = std::find_if(std::begin(power_hint_ids), std::end(power_hint_ids),
+                        [&](const decltype(power_hint_ids[0])& h) { return !strcmp(h.name, attrs[1]); });
+                if (it == std::end(power_hint_ids)) {
+                    xml_error("Unknown hint name: %s", attrs[1]);
                     continue;
                 }
-                m_hintId = it->second;
+                m_hintId = it->id;
             }
         }
 
@@ -286,24 +384,24 @@ class XmlElementHint : public XmlElement {
 class XmlElementHintInterval : public XmlElement {
     public:
         XmlElementHintInterval(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "interval") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             auto parent_hint = static_cast<XmlElementHint*>(m_parent);
             ExtPowerHint hint_id = parent_hint->hintId();
             if (hint_id < static_cast<ExtPowerHint>(0) || hint_id >= POWER_HINT_MAX) {
-                ALOGE("Invalid hint id: %d", hint_id);
+                xml_error("Invalid hint id: %d", hint_id);
                 return;
             }
             for (; *attrs; attrs += 2) {
                 if (strcmp(attrs[0], "time")) {
-                    ALOGE("Unknown interval attribute: %s", attrs[0]);
+                    xml_error("Unknown interval attribute: %s", attrs[0]);
                     continue;
                 }
                 int interval = -1;
                 if (parse_int(attrs[1], &interval) || interval < 0) {
-                    ALOGE("%s is not a valid interval", attrs[1]);
+                    xml_error("%s is not a valid interval", attrs[1]);
                     continue;
                 }
                 pInfo->hint_interval[hint_id] = interval;
@@ -314,25 +412,29 @@ class XmlElementHintInterval : public XmlElement {
 class XmlElementHintCpu : public XmlElement {
     public:
         XmlElementHintCpu(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "cpu") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             auto parent_hint = static_cast<XmlElementHint*>(m_parent);
             ExtPowerHint hint_id = parent_hint->hintId();
             if (hint_id < static_cast<ExtPowerHint>(0) || hint_id >= POWER_HINT_MAX) {
-                ALOGE("Invalid hint id: %d", hint_id);
+                xml_error("Invalid hint id: %d", hint_id);
+                return;
+            }
+            if (!attrs[0]) {
+                xml_error("cpu element has no attributes");
                 return;
             }
             int cluster = -1;
             if (!strcmp(attrs[0], "cluster")) {
                 if (parse_int(attrs[1], &cluster) || cluster < 0) {
-                    ALOGE("%s is not a valid number", attrs[1]);
+                    xml_error("%s is not a valid number", attrs[1]);
                 }
                 attrs += 2;
             }
             if (cluster >= 0 && (size_t)cluster >= pInfo->cpu_clusters.size()) {
-                ALOGE("Invalid cluster id: %d", cluster);
+                xml_error("Invalid cluster id: %d", cluster);
                 return;
             }
             if (cluster < 0) {
@@ -344,7 +446,7 @@ class XmlElementHintCpu : public XmlElement {
             }
             for (; *attrs; attrs += 2) {
                 if (!strcmp(attrs[0], "cluster")) {
-                    ALOGE("cluster attribute should come before others");
+                    xml_error("cluster attribute should come before others");
                     continue;
                 }
                 if (cluster < 0) {
@@ -363,14 +465,14 @@ class XmlElementHintCpu : public XmlElement {
 class XmlElementHintGpu : public XmlElement {
     public:
         XmlElementHintGpu(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "gpu") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             auto parent_hint = static_cast<XmlElementHint*>(m_parent);
             ExtPowerHint hint_id = parent_hint->hintId();
             if (hint_id < static_cast<ExtPowerHint>(0) || hint_id >= POWER_HINT_MAX) {
-                ALOGE("Invalid hint id: %d", hint_id);
+                xml_error("Invalid hint id: %d", hint_id);
                 return;
             }
             reset_hint(&pInfo->gpu_freq_hints[hint_id]);
@@ -383,14 +485,14 @@ class XmlElementHintGpu : public XmlElement {
 class XmlElementHintEmc : public XmlElement {
     public:
         XmlElementHintEmc(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "emc") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             auto parent_hint = static_cast<XmlElementHint*>(m_parent);
             ExtPowerHint hint_id = parent_hint->hintId();
             if (hint_id < static_cast<ExtPowerHint>(0) || hint_id >= POWER_HINT_MAX) {
-                ALOGE("Invalid hint id: %d", hint_id);
+                xml_error("Invalid hint id: %d", hint_id);
                 return;
             }
             reset_hint(&pInfo->emc_freq_hints[hint_id]);
@@ -403,14 +505,14 @@ class XmlElementHintEmc : public XmlElement {
 class XmlElementHintOnlineCpus : public XmlElement {
     public:
         XmlElementHintOnlineCpus(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "online_cpus") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             auto parent_hint = static_cast<XmlElementHint*>(m_parent);
             ExtPowerHint hint_id = parent_hint->hintId();
             if (hint_id < static_cast<ExtPowerHint>(0) || hint_id >= POWER_HINT_MAX) {
-                ALOGE("Invalid hint id: %d", hint_id);
+                xml_error("Invalid hint id: %d", hint_id);
                 return;
             }
             reset_hint(&pInfo->online_cpu_hints[hint_id]);
@@ -423,18 +525,18 @@ class XmlElementHintOnlineCpus : public XmlElement {
 class XmlElementBootBoost : public XmlElement {
     public:
         XmlElementBootBoost(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "boot_boost") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
             for (; *attrs; attrs += 2) {
                 if (strcmp(attrs[0], "time")) {
-                    ALOGE("Unknown boot_boost attribute: %s", attrs[0]);
+                    xml_error("Unknown boot_boost attribute: %s", attrs[0]);
                     continue;
                 }
                 int time = -1;
                 if (parse_int(attrs[1], &time) || time < 0) {
-                    ALOGE("%s is not a valid time", attrs[1]);
+                    xml_error("%s is not a valid time", attrs[1]);
                     continue;
                 }
                 pInfo->boot_boost_time_ms = time;
@@ -445,7 +547,7 @@ class XmlElementBootBoost : public XmlElement {
 class XmlElementCpufreqInteractive : public XmlElement {
     public:
         XmlElementCpufreqInteractive(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "cpufreq_interactive") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
@@ -461,7 +563,7 @@ class XmlElementCpufreqInteractive : public XmlElement {
 class XmlElementSclkBoost : public XmlElement {
     public:
         XmlElementSclkBoost(XmlElement *parent,
-                        std::map<std::string, XmlElement*> children) :
+                        std::initializer_list<const char*> children) :
                 XmlElement(parent, children, "sclk_boost") {}
 
         virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
@@ -473,6 +575,538 @@ class XmlElementSclkBoost : public XmlElement {
             }
         }
 };
+class XmlElementGovernorProfiles : public XmlElement {
+    public:
+        XmlElementGovernorProfiles(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "governor_profiles") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            pInfo->governor_profiles = governor_profiles_t();
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "governor"))
+                    pInfo->governor_profiles.governor = attrs[1];
+                else if (!strcmp(attrs[0], "path"))
+                    pInfo->governor_profiles.path = attrs[1];
+                else
+                    xml_error("Unknown governor_profiles attribute: %s", attrs[0]);
+            }
+        }
+
+        virtual void finish(struct powerhal_info *pInfo) {
+            if (pInfo->governor_profiles.governor.empty() ||
+                pInfo->governor_profiles.path.empty()) {
+                xml_error("governor_profiles needs a governor and a path, ignoring it");
+                pInfo->governor_profiles = governor_profiles_t();
+            }
+        }
+};
+
+class XmlElementGovernorProfile : public XmlElement {
+    public:
+        XmlElementGovernorProfile(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "profile") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            m_mode = -1;
+            for (; *attrs; attrs += 2) {
+                if (strcmp(attrs[0], "mode")) {
+                    xml_error("Unknown profile attribute: %s", attrs[0]);
+                    continue;
+                }
+                m_mode = governor_mode_id(attrs[1]);
+                if (m_mode < 0)
+                    xml_error("Unknown power mode: %s", attrs[1]);
+            }
+            // A mode given twice takes the later profile
+            if (m_mode >= 0)
+                pInfo->governor_profiles.modes[m_mode].clear();
+        }
+
+        virtual void finish(__attribute__((unused)) struct powerhal_info *pInfo) {
+            m_mode = -1;
+        }
+
+        int mode() const {
+            return m_mode;
+        }
+
+    private:
+        int m_mode;
+};
+
+class XmlElementGovernorTunable : public XmlElement {
+    public:
+        XmlElementGovernorTunable(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "tunable") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            int mode = static_cast<XmlElementGovernorProfile*>(m_parent)->mode();
+            governor_tunable_t tunable;
+
+            if (mode < 0)
+                return;
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "name"))
+                    tunable.name = attrs[1];
+                else if (!strcmp(attrs[0], "value"))
+                    tunable.value = attrs[1];
+                else
+                    xml_error("Unknown tunable attribute: %s", attrs[0]);
+            }
+            // Names are joined to the governor path, keep them inside it
+            if (tunable.name.empty() || tunable.name.find('/') != std::string::npos ||
+                tunable.name[0] == '.') {
+                xml_error("Invalid tunable name: %s", tunable.name.c_str());
+                return;
+            }
+            if (tunable.value.empty()) {
+                xml_error("Tunable %s has no value", tunable.name.c_str());
+                return;
+            }
+            pInfo->governor_profiles.modes[mode].push_back(tunable);
+        }
+};
+
+class XmlElementPowerFloor : public XmlElement {
+    public:
+        XmlElementPowerFloor(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "power_floor") {}
+
+        virtual void parse(struct powerhal_info *pInfo, __attribute__((unused)) const char **attrs) {
+            pInfo->power_floor = power_floor_config_t();
+        }
+};
+
+class XmlElementFloorPlatform : public XmlElement {
+    public:
+        XmlElementFloorPlatform(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "platform") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            for (; *attrs; attrs += 2) {
+                if (strcmp(attrs[0], "name")) {
+                    xml_error("Unknown platform attribute: %s", attrs[0]);
+                    continue;
+                }
+                pInfo->power_floor.platforms.push_back(attrs[1]);
+            }
+        }
+};
+
+class XmlElementFloorSupply : public XmlElement {
+    public:
+        XmlElementFloorSupply(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "supply") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            floor_supply_t supply;
+
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "name"))
+                    supply.name = attrs[1];
+                else if (!strcmp(attrs[0], "prop"))
+                    supply.prop = attrs[1];
+                else
+                    xml_error("Unknown supply attribute: %s", attrs[0]);
+            }
+            pInfo->power_floor.supplies.push_back(supply);
+        }
+
+        virtual void finish(struct powerhal_info *pInfo) {
+            floor_supply_t &supply = pInfo->power_floor.supplies.back();
+
+            if (supply.name.empty() || supply.prop.empty() || supply.ids.empty()) {
+                xml_error("supply needs a name, a prop and ids, ignoring it");
+                pInfo->power_floor.supplies.pop_back();
+            }
+        }
+};
+
+class XmlElementFloorSupplyId : public XmlElement {
+    public:
+        XmlElementFloorSupplyId(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "supply_id") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            floor_supply_id_t id = { "", -1, -1 };
+            int num;
+
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "prefix")) {
+                    id.prefix = attrs[1];
+                } else if (!strcmp(attrs[0], "min") || !strcmp(attrs[0], "max")) {
+                    long *bound = strcmp(attrs[0], "min") ? &id.max : &id.min;
+
+                    if (parse_int(attrs[1], &num) || num < 0) {
+                        xml_error("%s is not a valid number", attrs[1]);
+                        return;
+                    }
+                    *bound = num;
+                } else {
+                    xml_error("Unknown supply_id attribute: %s", attrs[0]);
+                }
+            }
+            if (id.prefix.empty() || (id.min < 0) != (id.max < 0) || id.min > id.max) {
+                xml_error("supply_id needs a prefix and both or neither of min and max");
+                return;
+            }
+            pInfo->power_floor.supplies.back().ids.push_back(id);
+        }
+};
+
+class XmlElementFloorState : public XmlElement {
+    public:
+        XmlElementFloorState(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "floor_state") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            floor_state_t state;
+
+            state.interactive = -1;
+            state.priority = PM_QOS_PLATFORM_FLOOR_PRIORITY;
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "supply")) {
+                    state.supply = attrs[1];
+                } else if (!strcmp(attrs[0], "interactive")) {
+                    if (parse_int(attrs[1], &state.interactive) || state.interactive > 1)
+                        xml_error("%s is not a valid interactive state", attrs[1]);
+                } else if (!strcmp(attrs[0], "priority")) {
+                    if (parse_int(attrs[1], &state.priority) || state.priority < 0)
+                        xml_error("%s is not a valid priority", attrs[1]);
+                } else {
+                    xml_error("Unknown floor_state attribute: %s", attrs[0]);
+                }
+            }
+            pInfo->power_floor.states.push_back(state);
+        }
+};
+
+/* cpu_freq and gpu_freq */
+class XmlElementFloorFreq : public XmlElement {
+    public:
+        XmlElementFloorFreq(XmlElement *parent,
+                        std::initializer_list<const char*> children,
+                        const char *name, bool cpu) :
+                XmlElement(parent, children, name), m_cpu(cpu) {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            floor_state_t &state = pInfo->power_floor.states.back();
+            floor_constraint_t floor = { -1, PM_QOS_DEFAULT_VALUE, PM_QOS_DEFAULT_VALUE };
+            int *value;
+
+            for (; *attrs; attrs += 2) {
+                if (m_cpu && !strcmp(attrs[0], "cluster"))
+                    value = &floor.cluster;
+                else if (!strcmp(attrs[0], "min"))
+                    value = &floor.min;
+                else if (!strcmp(attrs[0], "max"))
+                    value = &floor.max;
+                else {
+                    xml_error("Unknown %s attribute: %s", m_name, attrs[0]);
+                    continue;
+                }
+                if (parse_int(attrs[1], value)) {
+                    xml_error("%s is not a valid number", attrs[1]);
+                    return;
+                }
+            }
+            (m_cpu ? state.cpu : state.gpu).push_back(floor);
+        }
+
+    private:
+        const bool m_cpu;
+};
+
+class XmlElementFloorKnob : public XmlElement {
+    public:
+        XmlElementFloorKnob(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "knob") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            floor_knob_t knob;
+
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "path"))
+                    knob.path = attrs[1];
+                else if (!strcmp(attrs[0], "value"))
+                    knob.value = attrs[1];
+                else if (!strcmp(attrs[0], "wait"))
+                    knob.wait = attrs[1];
+                else
+                    xml_error("Unknown knob attribute: %s", attrs[0]);
+            }
+            if (knob.path.empty() || knob.value.empty()) {
+                xml_error("knob needs a path and a value");
+                return;
+            }
+            pInfo->power_floor.states.back().knobs.push_back(knob);
+        }
+};
+
+class XmlElementThermalPolicy : public XmlElement {
+    public:
+        XmlElementThermalPolicy(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "thermal_policy") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            thermal_policy_t &policy = pInfo->thermal_policy;
+
+            policy = thermal_policy_t();
+            policy.interval_ms = THERMAL_INTERVAL_MS;
+            policy.fast_interval_ms = THERMAL_FAST_INTERVAL_MS;
+            for (; *attrs; attrs += 2) {
+                int *value;
+
+                if (!strcmp(attrs[0], "interval"))
+                    value = &policy.interval_ms;
+                else if (!strcmp(attrs[0], "fast_interval"))
+                    value = &policy.fast_interval_ms;
+                else {
+                    xml_error("Unknown thermal_policy attribute: %s", attrs[0]);
+                    continue;
+                }
+                if (parse_int(attrs[1], value) || *value <= 0)
+                    xml_error("%s is not a valid interval", attrs[1]);
+            }
+            if (policy.interval_ms <= 0)
+                policy.interval_ms = THERMAL_INTERVAL_MS;
+            if (policy.fast_interval_ms <= 0)
+                policy.fast_interval_ms = THERMAL_FAST_INTERVAL_MS;
+        }
+};
+
+class XmlElementThermalZone : public XmlElement {
+    public:
+        XmlElementThermalZone(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "thermal_zone") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            static const char *cap_names[THERMAL_RESOURCE_COUNT] = {
+                "cpu_cap", "gpu_cap", "emc_cap"
+            };
+            thermal_zone_policy_t zone;
+
+            zone.trip = -1;
+            zone.margin = -1;
+            zone.scale = 100;
+            for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++)
+                zone.caps[i] = PM_QOS_DEFAULT_VALUE;
+
+            for (; *attrs; attrs += 2) {
+                int *value = NULL;
+
+                if (!strcmp(attrs[0], "type")) {
+                    zone.type = attrs[1];
+                    continue;
+                }
+                if (!strcmp(attrs[0], "trip"))
+                    value = &zone.trip;
+                else if (!strcmp(attrs[0], "margin"))
+                    value = &zone.margin;
+                else if (!strcmp(attrs[0], "scale"))
+                    value = &zone.scale;
+                for (int i = 0; i < THERMAL_RESOURCE_COUNT && !value; i++) {
+                    if (!strcmp(attrs[0], cap_names[i]))
+                        value = &zone.caps[i];
+                }
+                if (!value) {
+                    xml_error("Unknown thermal_zone attribute: %s", attrs[0]);
+                    continue;
+                }
+                if (parse_int(attrs[1], value)) {
+                    xml_error("%s is not a valid number", attrs[1]);
+                    return;
+                }
+            }
+            if (zone.type.empty() || zone.trip < 0 || zone.margin <= 0 ||
+                zone.scale < 0 || zone.scale > 100) {
+                xml_error("thermal_zone needs a type, a trip, a margin above 0 "
+                          "and a scale of 0 to 100");
+                return;
+            }
+            pInfo->thermal_policy.zones.push_back(zone);
+        }
+};
+
+class XmlElementFanCurve : public XmlElement {
+    public:
+        XmlElementFanCurve(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "fan_curve") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            fan_curve_config_t &config = pInfo->fan_curve_config;
+
+            config = fan_curve_config_t();
+            config.interval_ms = FAN_INTERVAL_MS;
+            config.hysteresis = 0;
+            config.slew = 0;
+            for (; *attrs; attrs += 2) {
+                int *value;
+
+                if (!strcmp(attrs[0], "zone")) {
+                    config.zone = attrs[1];
+                    continue;
+                }
+                if (!strcmp(attrs[0], "interval"))
+                    value = &config.interval_ms;
+                else if (!strcmp(attrs[0], "hysteresis"))
+                    value = &config.hysteresis;
+                else if (!strcmp(attrs[0], "slew"))
+                    value = &config.slew;
+                else {
+                    xml_error("Unknown fan_curve attribute: %s", attrs[0]);
+                    continue;
+                }
+                if (parse_int(attrs[1], value) || *value < 0)
+                    xml_error("%s is not a valid %s", attrs[1], attrs[0]);
+            }
+            if (config.interval_ms <= 0)
+                config.interval_ms = FAN_INTERVAL_MS;
+            if (config.hysteresis < 0)
+                config.hysteresis = 0;
+            if (config.slew < 0)
+                config.slew = 0;
+            if (config.zone.empty())
+                xml_error("fan_curve needs a zone");
+        }
+
+        virtual void finish(struct powerhal_info *pInfo) {
+            // Without a zone there is nothing to follow
+            if (pInfo->fan_curve_config.zone.empty())
+                pInfo->fan_curve_config = fan_curve_config_t();
+        }
+};
+
+class XmlElementFanPoint : public XmlElement {
+    public:
+        XmlElementFanPoint(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "fan_point") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            std::vector<fan_point_t> &points = pInfo->fan_curve_config.points;
+            fan_point_t point = { INT_MIN, -1 };
+
+            for (; *attrs; attrs += 2) {
+                int *value;
+
+                if (!strcmp(attrs[0], "temp"))
+                    value = &point.temp;
+                else if (!strcmp(attrs[0], "pwm"))
+                    value = &point.pwm;
+                else {
+                    xml_error("Unknown fan_point attribute: %s", attrs[0]);
+                    continue;
+                }
+                if (parse_int(attrs[1], value)) {
+                    xml_error("%s is not a valid number", attrs[1]);
+                    return;
+                }
+            }
+            if (point.temp == INT_MIN || point.pwm < 0 || point.pwm > FAN_PWM_MAX) {
+                xml_error("fan_point needs a temp and a pwm of 0 to %d", FAN_PWM_MAX);
+                return;
+            }
+            if (!points.empty() && point.temp <= points.back().temp) {
+                xml_error("fan_point temps must increase, %d follows %d",
+                          point.temp, points.back().temp);
+                return;
+            }
+            points.push_back(point);
+        }
+};
+
+class XmlElementPowerCap : public XmlElement {
+    public:
+        XmlElementPowerCap(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "power_cap") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            power_cap_config_t &config = pInfo->power_cap_config;
+
+            config = power_cap_config_t();
+            config.interval_ms = POWER_CAP_INTERVAL_MS;
+            config.deadband = POWER_CAP_DEADBAND;
+            config.min_scale = POWER_CAP_MIN_SCALE;
+            config.min_cores = POWER_CAP_MIN_CORES;
+            config.gpu_max = 0;
+            for (; *attrs; attrs += 2) {
+                int *value;
+
+                if (!strcmp(attrs[0], "interval"))
+                    value = &config.interval_ms;
+                else if (!strcmp(attrs[0], "deadband"))
+                    value = &config.deadband;
+                else if (!strcmp(attrs[0], "min_scale"))
+                    value = &config.min_scale;
+                else if (!strcmp(attrs[0], "min_cores"))
+                    value = &config.min_cores;
+                else if (!strcmp(attrs[0], "gpu_max"))
+                    value = &config.gpu_max;
+                else {
+                    xml_error("Unknown power_cap attribute: %s", attrs[0]);
+                    continue;
+                }
+                if (parse_int(attrs[1], value) || *value < 0)
+                    xml_error("%s is not a valid %s", attrs[1], attrs[0]);
+            }
+            if (config.interval_ms <= 0)
+                config.interval_ms = POWER_CAP_INTERVAL_MS;
+            if (config.deadband < 0 || config.deadband >= 100)
+                config.deadband = POWER_CAP_DEADBAND;
+            if (config.min_scale <= 0 || config.min_scale > 100)
+                config.min_scale = POWER_CAP_MIN_SCALE;
+            if (config.min_cores <= 0)
+                config.min_cores = POWER_CAP_MIN_CORES;
+            if (config.gpu_max < 0)
+                config.gpu_max = 0;
+        }
+};
+
+class XmlElementPowerRail : public XmlElement {
+    public:
+        XmlElementPowerRail(XmlElement *parent,
+                        std::initializer_list<const char*> children) :
+                XmlElement(parent, children, "power_rail") {}
+
+        virtual void parse(struct powerhal_info *pInfo, const char **attrs) {
+            power_rail_t rail;
+
+            rail.channel = -1;
+            for (; *attrs; attrs += 2) {
+                if (!strcmp(attrs[0], "hwmon"))
+                    rail.hwmon = attrs[1];
+                else if (!strcmp(attrs[0], "label"))
+                    rail.label = attrs[1];
+                else if (!strcmp(attrs[0], "channel")) {
+                    if (parse_int(attrs[1], &rail.channel) || rail.channel < 0) {
+                        xml_error("%s is not a valid channel", attrs[1]);
+                        return;
+                    }
+                } else
+                    xml_error("Unknown power_rail attribute: %s", attrs[0]);
+            }
+            if (rail.hwmon.empty() || rail.label.empty() == (rail.channel < 0)) {
+                xml_error("power_rail needs a hwmon and either a label or a channel");
+                return;
+            }
+            pInfo->power_cap_config.rails.push_back(rail);
+        }
+};
+
 // These externs are necessary so that we can have circular parent/children
 // pointers.
 extern XmlElementBootBoost xml_boot_boost;
@@ -480,6 +1114,18 @@ extern XmlElementCpuAvailableFreqs xml_cpu_available_freqs;
 extern XmlElementCpuCluster xml_cpu_cluster;
 extern XmlElementCpuPmqosConstraint xml_cpu_pmqos_constraint;
 extern XmlElementCpufreqInteractive xml_cpufreq_interactive;
+extern XmlElementFanCurve xml_fan_curve;
+extern XmlElementFanPoint xml_fan_point;
+extern XmlElementFloorFreq xml_floor_cpu_freq;
+extern XmlElementFloorFreq xml_floor_gpu_freq;
+extern XmlElementFloorKnob xml_floor_knob;
+extern XmlElementFloorPlatform xml_floor_platform;
+extern XmlElementFloorState xml_floor_state;
+extern XmlElementFloorSupply xml_floor_supply;
+extern XmlElementFloorSupplyId xml_floor_supply_id;
+extern XmlElementGovernorProfile xml_governor_profile;
+extern XmlElementGovernorProfiles xml_governor_profiles;
+extern XmlElementGovernorTunable xml_governor_tunable;
 extern XmlElementHint xml_hint;
 extern XmlElementHintCpu xml_hint_cpu;
 extern XmlElementHintEmc xml_hint_emc;
@@ -489,116 +1135,154 @@ extern XmlElementHintOnlineCpus xml_hint_online_cpus;
 extern XmlElementHints xml_hints;
 extern XmlElementInput xml_input;
 extern XmlElementInputDevices xml_input_devices;
+extern XmlElementPowerCap xml_power_cap;
+extern XmlElementPowerFloor xml_power_floor;
+extern XmlElementPowerRail xml_power_rail;
 extern XmlElementSclkBoost xml_sclk_boost;
+extern XmlElementThermalPolicy xml_thermal_policy;
+extern XmlElementThermalZone xml_thermal_zone;
 extern XmlElementTop xml_top;
 
-// These must be defined in bottom-to-top order, so that .name() will work
-// correctly.
 XmlElementHintInterval xml_hint_inverval(&xml_hint, {});
 XmlElementHintCpu xml_hint_cpu(&xml_hint, {});
 XmlElementHintGpu xml_hint_gpu(&xml_hint, {});
 XmlElementHintEmc xml_hint_emc(&xml_hint, {});
 XmlElementHintOnlineCpus xml_hint_online_cpus(&xml_hint, {});
-XmlElementHint xml_hint(&xml_hints, {
-                {xml_hint_inverval.name(), &xml_hint_inverval},
-                {xml_hint_cpu.name(), &xml_hint_cpu},
-                {xml_hint_gpu.name(), &xml_hint_gpu},
-                {xml_hint_emc.name(), &xml_hint_emc},
-                {xml_hint_online_cpus.name(), &xml_hint_online_cpus}
-                });
-XmlElementHints xml_hints(&xml_top, {
-                {xml_hint.name(), &xml_hint}
-                });
+XmlElementHint xml_hint(&xml_hints, {"interval", "cpu", "gpu", "emc", "online_cpus"});
+XmlElementHints xml_hints(&xml_top, {"hint"});
 XmlElementCpuAvailableFreqs xml_cpu_available_freqs(&xml_cpu_cluster, {});
 XmlElementCpuPmqosConstraint xml_cpu_pmqos_constraint(&xml_cpu_cluster, {});
-XmlElementCpuCluster xml_cpu_cluster(&xml_top, {
-                {xml_cpu_available_freqs.name(), &xml_cpu_available_freqs},
-                {xml_cpu_pmqos_constraint.name(), &xml_cpu_pmqos_constraint}
-                });
+XmlElementCpuCluster xml_cpu_cluster(&xml_top, {"available_freqs", "pmqos_constraint"});
 XmlElementInput xml_input(&xml_input_devices, {});
-XmlElementInputDevices xml_input_devices(&xml_top, {
-                {xml_input.name(), &xml_input}
-                });
+XmlElementInputDevices xml_input_devices(&xml_top, {"input"});
 XmlElementBootBoost xml_boot_boost(&xml_top, {});
 XmlElementCpufreqInteractive xml_cpufreq_interactive(&xml_top, {});
 XmlElementSclkBoost xml_sclk_boost(&xml_top, {});
-XmlElementTop xml_top(NULL, {
-                {xml_boot_boost.name(), &xml_boot_boost},
-                {xml_cpu_cluster.name(), &xml_cpu_cluster},
-                {xml_cpufreq_interactive.name(), &xml_cpufreq_interactive},
-                {xml_hints.name(), &xml_hints},
-                {xml_input_devices.name(), &xml_input_devices},
-                {xml_sclk_boost.name(), &xml_sclk_boost}
-                });
+XmlElementGovernorTunable xml_governor_tunable(&xml_governor_profile, {});
+XmlElementGovernorProfile xml_governor_profile(&xml_governor_profiles, {"tunable"});
+XmlElementGovernorProfiles xml_governor_profiles(&xml_top, {"profile"});
+XmlElementFloorFreq xml_floor_cpu_freq(&xml_floor_state, {}, "cpu_freq", true);
+XmlElementFloorFreq xml_floor_gpu_freq(&xml_floor_state, {}, "gpu_freq", false);
+XmlElementFloorKnob xml_floor_knob(&xml_floor_state, {});
+XmlElementFloorState xml_floor_state(&xml_power_floor, {"cpu_freq", "gpu_freq", "knob"});
+XmlElementFloorSupplyId xml_floor_supply_id(&xml_floor_supply, {});
+XmlElementFloorSupply xml_floor_supply(&xml_power_floor, {"supply_id"});
+XmlElementFloorPlatform xml_floor_platform(&xml_power_floor, {});
+XmlElementPowerFloor xml_power_floor(&xml_top, {"floor_state", "platform", "supply"});
+XmlElementThermalZone xml_thermal_zone(&xml_thermal_policy, {});
+XmlElementThermalPolicy xml_thermal_policy(&xml_top, {"thermal_zone"});
+XmlElementFanPoint xml_fan_point(&xml_fan_curve, {});
+XmlElementFanCurve xml_fan_curve(&xml_top, {"fan_point"});
+XmlElementPowerRail xml_power_rail(&xml_power_cap, {});
+XmlElementPowerCap xml_power_cap(&xml_top, {"power_rail"});
+XmlElementTop xml_top(NULL, {"boot_boost", "cpu_cluster", "cpufreq_interactive",
+                             "fan_curve", "governor_profiles", "hints",
+                             "input_devices", "power_cap", "power_floor",
+                             "sclk_boost", "thermal_policy"});
 }
 
 struct Data {
     XML_Parser parser;
+    // Innermost element being parsed, NULL outside the root
     XmlElement *element;
-    std::stack<std::string> elements;
+    // Nesting depth inside an element that is not understood
+    int unknown_depth;
     struct powerhal_info *pInfo;
+    const char *filename;
 
     bool abort;
 };
 
-static void elementStart(void* data_, const char* _name, const char **attrs)
+// Parse in progress on this thread, for the lines in xml_error()
+static thread_local struct Data *current_parse;
+
+static void xml_error(const char *fmt, ...)
+{
+    struct Data *data = current_parse;
+    const char *filename = data ? data->filename : "?";
+    int line = data ? XML_GetCurrentLineNumber(data->parser) : 0;
+    char msg[256];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+
+    ALOGE("%s:%d: %s", filename, line, msg);
+    if (report_hook)
+        report_hook(filename, line, msg);
+}
+
+void parse_xml_set_report_hook(parse_xml_report_hook_t hook)
+{
+    report_hook = hook;
+}
+
+static void elementStart(void* data_, const char* name, const char **attrs)
 {
     auto data = static_cast<Data*>(data_);
-    std::string name = std::string(_name);
-    XmlElement *child = NULL;
+    XmlElement *child;
 
-    if (data->elements.empty()) {
-        if (name != "powerhal") {
-            ALOGE("Root element should be <powerhal>!");
+    if (!data->element) {
+        if (strcmp(name, xml_top.name())) {
+            xml_error("Root element should be <powerhal>!");
             data->abort = true;
             XML_SetElementHandler(data->parser, NULL, NULL);
             return;
         }
-        data->elements.push(std::move(name));
+        data->element = &xml_top;
         return;
     }
 
-    std::string &parent = data->elements.top();
+    // Everything below an unknown element is skipped
+    if (data->unknown_depth) {
+        data->unknown_depth++;
+        return;
+    }
 
-    if (parent == data->element->name()) {
-        child = data->element->find_child(name);
-        if (child) {
-            child->parse(data->pInfo, attrs);
-        } else {
-            ALOGE("Unknown element: %s", name.c_str());
-        }
+    child = data->element->find_child(name);
+    if (!child) {
+        xml_error("Unknown element: %s", name);
+        data->unknown_depth = 1;
+        return;
     }
 
-    if (child)
-        data->element = child;
-    data->elements.push(std::move(name));
+    child->parse(data->pInfo, attrs);
+    data->element = child;
 }
 
 static void elementEnd(void* data_, __attribute__((unused)) const char* name)
 {
     auto data = static_cast<Data*>(data_);
 
-    if (data->elements.top() == data->element->name()) {
-        data->element->finish(data->pInfo);
-        data->element = data->element->parent();
+    if (data->unknown_depth) {
+        data->unknown_depth--;
+        return;
+    }
+
+    data->element->finish(data->pInfo);
+    data->element = data->element->parent();
+}
+
+const char *power_hint_name(ExtPowerHint hint)
+{
+    for (auto &it : power_hint_ids) {
+        if (it.id == hint)
+            return it.name;
     }
-    data->elements.pop();
+
+    return NULL;
 }
 
 int parse_xml(struct powerhal_info *pInfo, const char *hw_name)
 {
-    char buf[MAX_LINE_SIZE];
-    int ret = 0;
-    struct Data data;
-    XML_Parser parser;
-
     std::string filename;
     int i;
 
     for (i = 0; i < static_cast<int>(defaultXmlPath.size()); i++) {
         filename = defaultXmlPath[i] + std::string(XML_FILE_PREFIX)
                 + std::string(hw_name) + std::string(XML_FILE_SUFFIX);
-        if (0 == access(filename.c_str(), R_OK))
+        if (0 == root_access(filename.c_str(), R_OK))
             break;
     }
 
@@ -607,38 +1291,82 @@ int parse_xml(struct powerhal_info *pInfo, const char *hw_name)
         return -1;
     }
 
-    ALOGI("Reading xml file %s", filename.c_str());
-    std::ifstream file(filename, std::ifstream::in);
+    if (parse_xml_file(pInfo, filename.c_str(), true))
+        return -1;
+
+    pInfo->config_path = filename;
+    return 0;
+}
+
+int parse_xml_file(struct powerhal_info *pInfo, const char *filename, bool use_cache)
+{
+    int ret = 0;
+    struct Data data;
+    XML_Parser parser;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = root_open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("Couldn't open xml file %s", filename);
+        return -1;
+    }
+
+    if (fstat(fd, &st)) {
+        ALOGE("Couldn't stat xml file %s", filename);
+        close(fd);
+        return -1;
+    }
+
+    if (use_cache && !config_cache_load(pInfo, filename, &st)) {
+        close(fd);
+        return 0;
+    }
 
-    if (!file.is_open()) {
-        ALOGE("Couldn't open xml file %s", filename.c_str());
+    ALOGI("Reading xml file %s", filename);
+    if (st.st_size <= 0 || st.st_size > INT_MAX) {
+        ALOGE("Bad size for xml file %s", filename);
+        close(fd);
+        return -1;
+    }
+
+    // The whole document goes to expat in one call, straight from the page cache
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ALOGE("Couldn't map xml file %s", filename);
         return -1;
     }
 
     parser = XML_ParserCreate(nullptr);
     if (!parser) {
         ALOGE("Couldn't create XML parser");
+        munmap(map, st.st_size);
         return -1;
     }
 
     data.pInfo = pInfo;
     data.abort = false;
     data.parser = parser;
-    data.element = &xml_top;
+    data.element = NULL;
+    data.unknown_depth = 0;
+    data.filename = filename;
+    current_parse = &data;
     XML_SetUserData(parser, &data);
     XML_SetElementHandler(parser, elementStart, elementEnd);
-    do {
-        file.read(buf, sizeof(buf));
-        if (XML_Parse(parser, buf, file.gcount(), !file) != XML_STATUS_OK) {
-            ALOGE("Error parsing XML: %s", XML_ErrorString(XML_GetErrorCode(parser)));
-            ret = -1;
-            break;
-        }
-        if (data.abort)
-            break;
-    } while (file);
+    if (XML_Parse(parser, static_cast<const char*>(map), st.st_size, 1) != XML_STATUS_OK &&
+        !data.abort) {
+        xml_error("Error parsing XML: %s", XML_ErrorString(XML_GetErrorCode(parser)));
+        ret = -1;
+    }
+    current_parse = NULL;
 
     XML_ParserFree(parser);
+    munmap(map, st.st_size);
+
+    if (use_cache && !ret && !data.abort)
+        config_cache_store(pInfo, filename, &st);
 
     return ret;
 }
@@ -18,6 +18,18 @@
 
 #include "powerhal.h"
 
+/* Reads powerhal.<hw_name>.xml from the first config directory that has
+ * it into the staging tables of pInfo, and records its path */
 int parse_xml(struct powerhal_info *pInfo, const char *hw_name);
+/* Reads the XML at filename into the staging tables of pInfo. The config
+ * cache only applies on top of the service's own pre-parse state, so
+ * reads into anything else must pass use_cache false. */
+int parse_xml_file(struct powerhal_info *pInfo, const char *filename, bool use_cache);
+/* Called for every problem found in an XML file, after it is logged,
+ * e.g. so that powerhal_check can report them */
+typedef void (*parse_xml_report_hook_t)(const char *filename, int line, const char *msg);
+void parse_xml_set_report_hook(parse_xml_report_hook_t hook);
+/* XML name of a hint, or NULL if it has none */
+const char *power_hint_name(ExtPowerHint hint);
 
 #endif
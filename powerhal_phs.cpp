@@ -0,0 +1,474 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::phs"
+
+#include <algorithm>
+#include <map>
+#include <stdarg.h>
+#include <tuple>
+
+#include "phs.h"
+#include "powerhal_framepacer.h"
+#include "powerhal_phs.h"
+
+// Most (usecase, type, value, timeout) tuples taken from one call
+#define PHS_MAX_HINTS_PER_CALL 16
+// Clients holding no hints are forgotten after this long without a call
+#define PHS_CLIENT_STALE_MS (2 * NVPHS_MAX_HINT_TIMEOUT_MS)
+
+namespace {
+
+class PhsEngine {
+public:
+    PhsEngine(struct powerhal_info *pInfo);
+
+    int send(uint32_t client_tag, uint32_t flags, va_list ap);
+    void cancel(uint32_t client_tag, NvUsecase usecase);
+    int setThrottle(uint32_t client_tag, uint32_t interval_ms);
+    NvUsecase mute(NvUsecase mask, bool on);
+    int muteType(NvHintType type, bool on);
+    void refresh();
+    uint32_t cycles() const { return mCycles; }
+
+private:
+    // (client, usecase, type)
+    typedef std::tuple<uint32_t, int, int> HintKey;
+
+    struct Hint {
+        uint32_t value;
+        nsecs_t expiry;
+    };
+
+    struct Client {
+        nsecs_t throttle;
+        nsecs_t last_send;
+        // Last call of any kind, for pruning
+        nsecs_t last_seen;
+        uint32_t target_fps;
+        uint32_t proc_us;
+    };
+
+    class ExpiryTask : public TimeoutPoker::Task {
+    public:
+        ExpiryTask(PhsEngine *engine, int generation) :
+            engine(engine), generation(generation) {}
+        virtual void run() { engine->expire(generation); }
+    private:
+        PhsEngine *engine;
+        int generation;
+    };
+
+    void frameHint(Client &client, NvHintType type, uint32_t value);
+    void expire(int generation);
+    void update(nsecs_t now);
+    void pruneClients(nsecs_t now);
+    void setCpu(int floor_khz, float floor_position, int cap_khz);
+    void setGpu(int floor_khz, int cap_khz);
+
+    struct powerhal_info *mInfo;
+    Mutex mLock;
+    std::map<HintKey, Hint> mHints;
+    std::map<uint32_t, Client> mClients;
+    uint32_t mMutedUsecases;
+    uint64_t mMutedTypes;
+    int mTimerGeneration;
+    nsecs_t mTimerTime;
+    uint32_t mCycles;
+
+    // Floors and ceilings last folded from the hints
+    int mCpuFloor;
+    float mCpuPosition;
+    int mCpuCap;
+    int mGpuFloor;
+    int mGpuCap;
+
+    std::vector<int> mCpuFloorHandles;
+    std::vector<int> mCpuCapHandles;
+    int mGpuFloorHandle;
+    int mGpuCapHandle;
+};
+
+PhsEngine *sEngine;
+
+PhsEngine::PhsEngine(struct powerhal_info *pInfo) :
+    mInfo(pInfo),
+    mMutedUsecases(0),
+    mMutedTypes(0),
+    mTimerGeneration(0),
+    mTimerTime(0),
+    mCycles(0),
+    mCpuFloor(0),
+    mCpuPosition(0),
+    mCpuCap(INT_MAX),
+    mGpuFloor(0),
+    mGpuCap(INT_MAX),
+    mCpuFloorHandles(pInfo->cpu_clusters.size(), -1),
+    mCpuCapHandles(pInfo->cpu_clusters.size(), -1),
+    mGpuFloorHandle(-1),
+    mGpuCapHandle(-1)
+{
+}
+
+static bool is_frame_hint(int type)
+{
+    return type == NvHintType_FramerateTarget ||
+           type == NvHintType_EglFrameTimestamp ||
+           type == NvHintType_EglAvgFrameProctime;
+}
+
+int PhsEngine::send(uint32_t client_tag, uint32_t flags, va_list ap)
+{
+    Mutex::Autolock _l(mLock);
+    nsecs_t now = powerhal_time();
+    Client &client = mClients[client_tag];
+    uint32_t min_timeout = (flags & PHS_FLAG_IMMEDIATE) ?
+            NVPHS_IMMEDIATE_MODE_MIN_HINT_TIMEOUT_MS : NVPHS_MIN_HINT_TIMEOUT_MS;
+
+    client.last_seen = now;
+    if (client.throttle && client.last_send &&
+        now - client.last_send < client.throttle)
+        return 0;
+    client.last_send = now;
+
+    for (int i = 0; i < PHS_MAX_HINTS_PER_CALL; i++) {
+        int usecase = va_arg(ap, int);
+        if (usecase == NvUsecase_NULL)
+            break;
+
+        int type = va_arg(ap, int);
+        uint32_t value = va_arg(ap, uint32_t);
+        uint32_t timeout_ms = va_arg(ap, uint32_t);
+
+        if (type < NvHintType_FIRST || type > NvHintType_LAST) {
+            ALOGE("%s: invalid hint type %d", __func__, type);
+            continue;
+        }
+        if ((mMutedUsecases & usecase) || (mMutedTypes & (1ULL << type)))
+            continue;
+
+        if (is_frame_hint(type)) {
+            frameHint(client, static_cast<NvHintType>(type), value);
+            continue;
+        }
+
+        timeout_ms = std::min<uint32_t>(NVPHS_MAX_HINT_TIMEOUT_MS,
+                                        std::max(min_timeout, timeout_ms));
+        mHints[HintKey(client_tag, usecase, type)] = { value, now + ms2ns(timeout_ms) };
+    }
+
+    update(now);
+    return 0;
+}
+
+/* Must be called with mLock held */
+void PhsEngine::frameHint(Client &client, NvHintType type, uint32_t value)
+{
+    if (type == NvHintType_FramerateTarget) {
+        client.target_fps = value;
+        if (!value) {
+            int32_t data[2] = { 0, 0 };
+            mInfo->frame_pacer->ingest(data, 2);
+        }
+    } else if (type == NvHintType_EglAvgFrameProctime) {
+        client.proc_us = value;
+    } else if (client.target_fps) {
+        int32_t data[4] = { static_cast<int32_t>(client.target_fps), 1,
+                            static_cast<int32_t>(value),
+                            static_cast<int32_t>(client.proc_us) };
+        mInfo->frame_pacer->ingest(data, 4);
+    }
+}
+
+void PhsEngine::cancel(uint32_t client_tag, NvUsecase usecase)
+{
+    Mutex::Autolock _l(mLock);
+
+    for (auto it = mHints.begin(); it != mHints.end();) {
+        if (std::get<0>(it->first) == client_tag &&
+            (usecase == NvUsecase_ANY || (std::get<1>(it->first) & usecase)))
+            it = mHints.erase(it);
+        else
+            ++it;
+    }
+
+    // Cancelling everything is how a client signs off
+    if (usecase == NvUsecase_ANY)
+        mClients.erase(client_tag);
+
+    update(powerhal_time());
+}
+
+int PhsEngine::setThrottle(uint32_t client_tag, uint32_t interval_ms)
+{
+    Mutex::Autolock _l(mLock);
+    Client &client = mClients[client_tag];
+
+    client.throttle = ms2ns(interval_ms);
+    client.last_seen = powerhal_time();
+    return 0;
+}
+
+NvUsecase PhsEngine::mute(NvUsecase mask, bool on)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (on)
+        mMutedUsecases |= mask;
+    else
+        mMutedUsecases &= ~mask;
+    update(powerhal_time());
+
+    return static_cast<NvUsecase>(mMutedUsecases);
+}
+
+int PhsEngine::muteType(NvHintType type, bool on)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (type < NvHintType_FIRST || type > NvHintType_LAST)
+        return -1;
+
+    if (on)
+        mMutedTypes |= 1ULL << type;
+    else
+        mMutedTypes &= ~(1ULL << type);
+    update(powerhal_time());
+
+    return 0;
+}
+
+void PhsEngine::expire(int generation)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (generation != mTimerGeneration)
+        return;
+
+    mTimerTime = 0;
+    update(powerhal_time());
+}
+
+/* Must be called with mLock held. Drops expired hints, folds the rest
+ * into one floor and ceiling per resource and arms the next expiry. */
+void PhsEngine::update(nsecs_t now)
+{
+    int cpu_floor = 0, gpu_floor = 0;
+    int cpu_cap = INT_MAX, gpu_cap = INT_MAX;
+    float cpu_position = 0;
+    nsecs_t next = 0;
+
+    for (auto it = mHints.begin(); it != mHints.end();) {
+        if (it->second.expiry <= now) {
+            it = mHints.erase(it);
+            continue;
+        }
+
+        int usecase = std::get<1>(it->first);
+        int type = std::get<2>(it->first);
+        int value = static_cast<int>(std::min<uint32_t>(it->second.value, INT_MAX));
+
+        if (!next || it->second.expiry < next)
+            next = it->second.expiry;
+        ++it;
+
+        if ((mMutedUsecases & usecase) || (mMutedTypes & (1ULL << type)))
+            continue;
+
+        switch (type) {
+        case NvHintType_MinCPU:
+        case NvHintType_CpuFloorVmin:
+        case NvHintType_CpuFloorCamera:
+            cpu_floor = std::max(cpu_floor, value);
+            break;
+        case NvHintType_MaxCPU:
+            cpu_cap = std::min(cpu_cap, value);
+            break;
+        case NvHintType_MinGPU:
+        case NvHintType_GpuFloorVmin:
+        case NvHintType_GpuFloorCamera:
+            gpu_floor = std::max(gpu_floor, value);
+            break;
+        case NvHintType_MaxGPU:
+            gpu_cap = std::min(gpu_cap, value);
+            break;
+        case NvHintType_TransientCpuLoad:
+            cpu_position = std::max(cpu_position, (float)value / INT_MAX);
+            break;
+        default:
+            break;
+        }
+    }
+
+    mCpuFloor = cpu_floor;
+    mCpuPosition = cpu_position;
+    mCpuCap = cpu_cap;
+    mGpuFloor = gpu_floor;
+    mGpuCap = gpu_cap;
+    setCpu(cpu_floor, cpu_position, cpu_cap);
+    setGpu(gpu_floor, gpu_cap);
+    pruneClients(now);
+    mCycles++;
+
+    if (next && (!mTimerTime || next < mTimerTime)) {
+        mTimerTime = next;
+        mInfo->mTimeoutPoker->postTaskDelayed(new ExpiryTask(this, ++mTimerGeneration),
+                                              next - now);
+    }
+}
+
+/* Must be called with mLock held. Drops clients that hold no hints and
+ * have not called in PHS_CLIENT_STALE_MS, so that clients which die
+ * without cancelling do not pile up. */
+void PhsEngine::pruneClients(nsecs_t now)
+{
+    for (auto it = mClients.begin(); it != mClients.end();) {
+        auto hint = mHints.lower_bound(HintKey(it->first, INT_MIN, INT_MIN));
+        bool holds = hint != mHints.end() && std::get<0>(hint->first) == it->first;
+
+        if (!holds && now - it->second.last_seen >= ms2ns(PHS_CLIENT_STALE_MS))
+            it = mClients.erase(it);
+        else
+            ++it;
+    }
+}
+
+static void hold_or_release(ResourceBackend *backend, int *handle, int max, int min)
+{
+    if (max == PM_QOS_DEFAULT_VALUE && min == PM_QOS_DEFAULT_VALUE)
+        resource_release(backend, handle);
+    else
+        resource_update(backend, handle, PM_QOS_BOOST_PRIORITY, max, min);
+}
+
+/* Places the floors and ceilings again, after the thermal limits on the
+ * floors changed */
+void PhsEngine::refresh()
+{
+    Mutex::Autolock _l(mLock);
+
+    setCpu(mCpuFloor, mCpuPosition, mCpuCap);
+    setGpu(mGpuFloor, mGpuCap);
+}
+
+/* Floors are lowered by the thermal policy, so a TransientCpuLoad of
+ * INT_MAX only pins the top frequency while there is thermal headroom */
+void PhsEngine::setCpu(int floor_khz, float floor_position, int cap_khz)
+{
+    for (size_t i = 0; i < mInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cluster = mInfo->cpu_clusters[i];
+        int floor = std::max(floor_khz, cluster_freq_at(&cluster, floor_position));
+
+        floor = thermal_boost_min(mInfo, THERMAL_CPU, floor, cluster_freq_top(&cluster));
+        hold_or_release(cluster.backend, &mCpuFloorHandles[i], PM_QOS_DEFAULT_VALUE,
+                        floor > 0 ? floor : PM_QOS_DEFAULT_VALUE);
+        hold_or_release(cluster.backend, &mCpuCapHandles[i],
+                        cap_khz < INT_MAX ? cap_khz : PM_QOS_DEFAULT_VALUE,
+                        PM_QOS_DEFAULT_VALUE);
+    }
+}
+
+void PhsEngine::setGpu(int floor_khz, int cap_khz)
+{
+    floor_khz = thermal_boost_min(mInfo, THERMAL_GPU, floor_khz, 0);
+    hold_or_release(mInfo->resources.gpu, &mGpuFloorHandle, PM_QOS_DEFAULT_VALUE,
+                    floor_khz > 0 ? floor_khz : PM_QOS_DEFAULT_VALUE);
+    hold_or_release(mInfo->resources.gpu, &mGpuCapHandle,
+                    cap_khz < INT_MAX ? cap_khz : PM_QOS_DEFAULT_VALUE,
+                    PM_QOS_DEFAULT_VALUE);
+}
+
+}  // namespace
+
+void powerhal_phs_init(struct powerhal_info *pInfo)
+{
+    if (!sEngine)
+        sEngine = new PhsEngine(pInfo);
+}
+
+void powerhal_phs_refresh(void)
+{
+    if (sEngine)
+        sEngine->refresh();
+}
+
+/*
+ * phs.h client API
+ */
+int NvPHSSendThroughputHints(uint32_t client_tag, uint32_t flags, ...)
+{
+    va_list ap;
+    int ret;
+
+    if (!sEngine)
+        return -1;
+
+    va_start(ap, flags);
+    ret = sEngine->send(client_tag, flags, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+void NvPHSCancelThroughputHints(uint32_t client_tag, NvUsecase usecase)
+{
+    if (sEngine)
+        sEngine->cancel(client_tag, usecase);
+}
+
+int NvPHSSetThrottle(uint32_t client_tag, uint32_t interval_ms)
+{
+    return sEngine ? sEngine->setThrottle(client_tag, interval_ms) : -1;
+}
+
+int NvPHSIsChannelOpen(void)
+{
+    return sEngine != NULL;
+}
+
+NvUsecase NvPHSMuteUsecases(NvUsecase usecases_mask)
+{
+    return sEngine ? sEngine->mute(usecases_mask, true) : NvUsecase_NULL;
+}
+
+NvUsecase NvPHSUnmuteUsecases(NvUsecase usecases_mask)
+{
+    return sEngine ? sEngine->mute(usecases_mask, false) : NvUsecase_NULL;
+}
+
+int NvPHSMuteHintType(NvHintType type)
+{
+    return sEngine ? sEngine->muteType(type, true) : -1;
+}
+
+int NvPHSUnmuteHintType(NvHintType type)
+{
+    return sEngine ? sEngine->muteType(type, false) : -1;
+}
+
+int NvPHSReadSystemParameter(NvSystemParam param, uint32_t *rv)
+{
+    if (!sEngine || !rv || param != NvSystemParam_PHS_CYCLE)
+        return -1;
+
+    *rv = sEngine->cycles();
+    return 0;
+}
+
+int NvPHSReadProcessParameter(__attribute__((unused)) NvProcessParam param,
+                              __attribute__((unused)) uint32_t *rv)
+{
+    return -1;
+}
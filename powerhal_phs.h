@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_PHS_H
+#define POWER_HAL_PHS_H
+
+#include "powerhal.h"
+
+/*
+ * Built-in implementation of the phs.h client API for builds without
+ * libnvphs (USE_LOCAL_PHS). Hints are aggregated per client and usecase
+ * and applied through the HAL's own resource backends:
+ *
+ *   MinCPU, CpuFloorVmin, CpuFloorCamera   cluster floors (kHz)
+ *   MaxCPU                                 cluster ceilings (kHz)
+ *   MinGPU, GpuFloorVmin, GpuFloorCamera   GPU floor (kHz)
+ *   MaxGPU                                 GPU ceiling (kHz)
+ *   TransientCpuLoad                       cluster floors, value scaled
+ *                                          from 0..INT_MAX onto the
+ *                                          frequency table
+ *   FramerateTarget, EglFrameTimestamp,    fed to the frame pacer
+ *   EglAvgFrameProctime
+ *
+ * Other hint types are accepted and ignored. A client's throttle and
+ * frame state are dropped when it cancels NvUsecase_ANY, or once it holds
+ * no hints and has not called for twice the longest hint timeout.
+ *
+ * Floors are lowered by the thermal policy like the HAL's own boosts.
+ */
+void powerhal_phs_init(struct powerhal_info *pInfo);
+/* Places the floors again, after the thermal limits on them changed */
+void powerhal_phs_refresh(void);
+
+#endif  // POWER_HAL_PHS_H
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::powercap"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "powerhal_powercap.h"
+
+#define HWMON_PATH "/sys/class/hwmon/hwmon%d/%s"
+#define HWMON_MAX_CHANNEL 16
+
+static int read_node(int fd)
+{
+    char buf[24];
+    ssize_t len;
+
+    if (fd < 0)
+        return -1;
+    len = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    return atoi(buf);
+}
+
+static int open_channel_node(int hwmon, const char *kind, int channel)
+{
+    char name[32], path[80];
+
+    snprintf(name, sizeof(name), "%s%d_input", kind, channel);
+    snprintf(path, sizeof(path), HWMON_PATH, hwmon, name);
+    return root_open(path, O_RDONLY | O_CLOEXEC);
+}
+
+/* Finds the channel of the first hwmon device named config.hwmon */
+bool PowerCap::openRail(const power_rail_t& config, Rail *rail)
+{
+    char path[80];
+
+    for (int id = 0; ; id++) {
+        char name[64] = { 0 };
+
+        snprintf(path, sizeof(path), HWMON_PATH, id, "name");
+        if (root_access(path, F_OK))
+            return false;
+
+        sysfs_read(path, name, sizeof(name));
+        name[strcspn(name, "\n")] = '\0';
+        if (config.hwmon != name)
+            continue;
+
+        rail->channel = config.channel;
+        for (int i = 0; i <= HWMON_MAX_CHANNEL && !config.label.empty(); i++) {
+            char file[32], label[64] = { 0 };
+
+            snprintf(file, sizeof(file), "in%d_label", i);
+            snprintf(path, sizeof(path), HWMON_PATH, id, file);
+            if (root_access(path, F_OK))
+                continue;
+            sysfs_read(path, label, sizeof(label));
+            label[strcspn(label, "\n")] = '\0';
+            if (config.label == label) {
+                rail->channel = i;
+                break;
+            }
+        }
+        if (rail->channel < 0)
+            return false;
+
+        rail->config = &config;
+        rail->hwmon = id;
+        rail->power = -1;
+        rail->powerFd = open_channel_node(id, "power", rail->channel);
+        rail->voltFd = -1;
+        rail->currFd = -1;
+        if (rail->powerFd >= 0)
+            return true;
+
+        rail->voltFd = open_channel_node(id, "in", rail->channel);
+        rail->currFd = open_channel_node(id, "curr", rail->channel);
+        if (rail->voltFd >= 0 && rail->currFd >= 0)
+            return true;
+
+        if (rail->voltFd >= 0)
+            close(rail->voltFd);
+        if (rail->currFd >= 0)
+            close(rail->currFd);
+        return false;
+    }
+}
+
+/* Power of the rail in mW, -1 if it cannot be read */
+int PowerCap::readRail(const Rail& rail)
+{
+    int volt, curr;
+
+    // powerN_input is in uW, inN_input in mV and currN_input in mA
+    if (rail.powerFd >= 0) {
+        int power = read_node(rail.powerFd);
+        return power < 0 ? -1 : power / 1000;
+    }
+
+    volt = read_node(rail.voltFd);
+    curr = read_node(rail.currFd);
+    if (volt < 0 || curr < 0)
+        return -1;
+    return (int)((int64_t)volt * curr / 1000);
+}
+
+PowerCap *PowerCap::create(struct powerhal_info *pInfo, const power_cap_config_t& config)
+{
+    PowerCap *cap;
+
+    if (config.rails.empty())
+        return NULL;
+
+    cap = new PowerCap(pInfo, config);
+    for (auto &config_rail : cap->mConfig.rails) {
+        Rail rail;
+
+        if (!openRail(config_rail, &rail)) {
+            ALOGE("No power rail %s on %s, the power budget is not enforced",
+                  config_rail.label.empty() ? std::to_string(config_rail.channel).c_str() :
+                  config_rail.label.c_str(), config_rail.hwmon.c_str());
+            for (auto &open : cap->mRails) {
+                for (int fd : { open.powerFd, open.voltFd, open.currFd }) {
+                    if (fd >= 0)
+                        close(fd);
+                }
+            }
+            delete cap;
+            return NULL;
+        }
+        cap->mRails.push_back(rail);
+    }
+
+    ALOGI("Power cap: %zu rails, %d cores", cap->mRails.size(), cap->mMaxCores);
+    return cap;
+}
+
+PowerCap::PowerCap(struct powerhal_info *pInfo, const power_cap_config_t& config) :
+    mInfo(pInfo),
+    mConfig(config),
+    mMaxCores(std::max(1, (int)sysconf(_SC_NPROCESSORS_CONF))),
+    mBudget(0),
+    mGeneration(0),
+    mPower(-1),
+    mScale(100),
+    mCpuHandles(pInfo->cpu_clusters.size(), -1),
+    mGpuHandle(-1),
+    mCoreHandle(-1)
+{
+    mCores = mMaxCores;
+}
+
+/* Called with mLock held. Moves the scale and cores one step towards the
+ * budget, returns true if either changed. */
+bool PowerCap::control()
+{
+    int headroom = (int)((int64_t)(mBudget - mPower) * 100 / mBudget);
+    int scale = mScale;
+    int cores = mCores;
+
+    if (mPower > mBudget) {
+        if (mScale > mConfig.min_scale)
+            mScale = std::max(mConfig.min_scale, mScale - std::max(1, -headroom / 2));
+        else if (mCores > mConfig.min_cores)
+            mCores--;
+    } else if (headroom > mConfig.deadband) {
+        if (mCores < mMaxCores)
+            mCores++;
+        else if (mScale < 100)
+            mScale = std::min(100, mScale + std::max(1, headroom / 2));
+    }
+    return scale != mScale || cores != mCores;
+}
+
+/* Called with mLock held */
+void PowerCap::apply()
+{
+    for (size_t i = 0; i < mCpuHandles.size(); i++) {
+        const cpu_cluster_data_t *cluster = &mInfo->cpu_clusters[i];
+        int top = cluster_freq_top(cluster);
+
+        if (mScale < 100 && top > 0)
+            resource_update(cluster->backend, &mCpuHandles[i], PM_QOS_POWER_CAP_PRIORITY,
+                            cluster_freq_floor(cluster, (int)((int64_t)top * mScale / 100)),
+                            PM_QOS_DEFAULT_VALUE);
+        else
+            resource_release(cluster->backend, &mCpuHandles[i]);
+    }
+
+    if (mScale < 100 && mConfig.gpu_max > 0)
+        resource_update(mInfo->resources.gpu, &mGpuHandle, PM_QOS_POWER_CAP_PRIORITY,
+                        (int)((int64_t)mConfig.gpu_max * mScale / 100), PM_QOS_DEFAULT_VALUE);
+    else
+        resource_release(mInfo->resources.gpu, &mGpuHandle);
+
+    if (mCores < mMaxCores)
+        resource_update(mInfo->resources.online_cpus, &mCoreHandle, PM_QOS_POWER_CAP_PRIORITY,
+                        mCores, PM_QOS_DEFAULT_VALUE);
+    else
+        resource_release(mInfo->resources.online_cpus, &mCoreHandle);
+}
+
+/* Runs on the looper */
+void PowerCap::sample(int generation)
+{
+    Mutex::Autolock _l(mLock);
+    int power = 0;
+
+    if (generation != mGeneration)
+        return;
+
+    for (auto &rail : mRails) {
+        rail.power = readRail(rail);
+        if (rail.power < 0 || power < 0)
+            power = -1;
+        else
+            power += rail.power;
+    }
+
+    // A sample missing a rail would read as headroom
+    if (power >= 0) {
+        mPower = mPower < 0 ? power : (mPower + power) / 2;
+        if (control()) {
+            ALOGV("Power %d mW of %d mW: scale %d%%, %d cores", mPower, mBudget,
+                  mScale, mCores);
+            apply();
+            // Older samples were taken under the previous caps
+            mPower = -1;
+        }
+    }
+
+    mInfo->mTimeoutPoker->postTaskDelayed(new SampleTask(this, generation),
+                                          ms2ns(mConfig.interval_ms));
+}
+
+void PowerCap::setBudget(int budget)
+{
+    Mutex::Autolock _l(mLock);
+
+    budget = std::max(budget, 0);
+    if (budget == mBudget)
+        return;
+
+    ALOGI("Power budget %d mW", budget);
+    if (!budget) {
+        // Drops the pending sample
+        mGeneration++;
+        mPower = -1;
+        mScale = 100;
+        mCores = mMaxCores;
+        apply();
+    } else if (!mBudget) {
+        mInfo->mTimeoutPoker->postTaskDelayed(new SampleTask(this, mGeneration), 0);
+    }
+    mBudget = budget;
+}
+
+void PowerCap::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    char line[160];
+
+    if (!mBudget) {
+        out += "Power cap: no budget\n";
+        return;
+    }
+    snprintf(line, sizeof(line), "Power cap: budget %d mW, average %d mW, scale %d%%, "
+             "%d of %d cores\n", mBudget, mPower, mScale, mCores, mMaxCores);
+    out += line;
+    for (auto &rail : mRails) {
+        snprintf(line, sizeof(line), "  hwmon%d %s channel %d: %d mW\n", rail.hwmon,
+                 rail.config->hwmon.c_str(), rail.channel, rail.power);
+        out += line;
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_POWERCAP_H
+#define POWER_HAL_POWERCAP_H
+
+#include <string>
+#include <vector>
+
+#include "powerhal.h"
+
+#define POWER_CAP_INTERVAL_MS 500
+#define POWER_CAP_DEADBAND 5
+#define POWER_CAP_MIN_SCALE 30
+#define POWER_CAP_MIN_CORES 1
+
+/*
+ * Board power held to the APP_PROFILE_PBC_POWER budget, in mW, by
+ * measuring the power rails and capping the CPU, GPU and online cores.
+ * The rails come from the <power_cap> section of the XML:
+ *
+ *   <power_cap interval="500" deadband="5" min_scale="30" min_cores="2"
+ *              gpu_max="921600">
+ *     <power_rail hwmon="ina3221" label="VDD_IN"/>
+ *     <power_rail hwmon="ina3221x" channel="2"/>
+ *   </power_cap>
+ *
+ * A rail is the channel of the hwmon device with that name, found by its
+ * inN_label or given by number. Its powerN_input is read if the driver
+ * has one, inN_input times currN_input otherwise. The rails are summed
+ * as the board power, so they should not overlap. The budget is always
+ * published in persist.sys.NV_PBC_PWR_LIMIT, as before, and enforced
+ * here only if every rail exists.
+ *
+ * While a budget is set the rails are sampled from the looper every
+ * interval ms. Each sample is averaged with the previous average, which
+ * is compared with the budget; the average starts over whenever the caps
+ * move. Over the budget, the caps come down by half the overshoot in
+ * percent, at least 1%, until they reach min_scale% of the top
+ * frequencies; after that a core goes offline per sample, down to
+ * min_cores. More than deadband% under it, cores come back first and
+ * then the caps go up the same way. Within the deadband nothing moves,
+ * so the loop settles just under the budget.
+ *
+ * Cluster caps are the highest available frequency at or below the
+ * cluster's top times the scale, and the GPU cap is gpu_max times the
+ * scale. They are held at PM_QOS_POWER_CAP_PRIORITY, above boosts, app
+ * profiles and platform floors, and only while below the top. A budget
+ * of 0 or less lifts every cap and stops sampling.
+ */
+class PowerCap {
+public:
+    /* Returns NULL if there are no rails or one of them does not exist */
+    static PowerCap *create(struct powerhal_info *pInfo, const power_cap_config_t& config);
+
+    void setBudget(int budget);
+    void dump(std::string& out);
+
+private:
+    class SampleTask : public TimeoutPoker::Task {
+    public:
+        SampleTask(PowerCap *cap, int generation) : cap(cap), generation(generation) {}
+        virtual void run() { cap->sample(generation); }
+    private:
+        PowerCap *cap;
+        int generation;
+    };
+
+    struct Rail {
+        const power_rail_t *config;
+        int hwmon;
+        int channel;
+        // powerN_input, or inN_input and currN_input without it
+        int powerFd;
+        int voltFd;
+        int currFd;
+        // Last reading in mW, -1 if it failed
+        int power;
+    };
+
+    PowerCap(struct powerhal_info *pInfo, const power_cap_config_t& config);
+
+    static bool openRail(const power_rail_t& config, Rail *rail);
+    static int readRail(const Rail& rail);
+
+    void sample(int generation);
+    bool control();
+    void apply();
+
+    struct powerhal_info *mInfo;
+    const power_cap_config_t mConfig;
+    std::vector<Rail> mRails;
+    int mMaxCores;
+
+    // Guarded by mLock
+    Mutex mLock;
+    int mBudget;
+    // Samples of an older generation stop the loop
+    int mGeneration;
+    // Average board power in mW, -1 until the first sample under the
+    // current caps
+    int mPower;
+    int mScale;
+    int mCores;
+    std::vector<int> mCpuHandles;
+    int mGpuHandle;
+    int mCoreHandle;
+};
+
+#endif  // POWER_HAL_POWERCAP_H
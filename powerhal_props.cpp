@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::props"
+
+#include <vector>
+
+#include <utils/threads.h>
+
+#include "powerhal_props.h"
+#include "powerhal_utils.h"
+
+using android::Thread;
+using android::sp;
+
+CachedProperty::CachedProperty(const char *name) :
+    mName(name),
+    mInfo(NULL),
+    mSerial(0),
+    mAreaSerial(0),
+    mValid(false)
+{
+}
+
+void CachedProperty::onRead(void *cookie, __attribute__((unused)) const char *name,
+                            const char *value, uint32_t serial)
+{
+    CachedProperty *prop = static_cast<CachedProperty*>(cookie);
+
+    prop->mValue = value;
+    prop->mSerial = serial;
+}
+
+bool CachedProperty::refresh()
+{
+    Mutex::Autolock _l(mLock);
+    std::string old = mValue;
+    bool valid = mValid;
+
+    if (!mInfo) {
+        uint32_t area = __system_property_area_serial();
+
+        // The area serial moves whenever a property is added, so until
+        // it does the lookup would fail again
+        if (mValid && area == mAreaSerial)
+            return false;
+        mAreaSerial = area;
+        mValid = true;
+
+        mInfo = __system_property_find(mName.c_str());
+        if (!mInfo) {
+            char value[PROPERTY_VALUE_MAX];
+
+            property_get(mName.c_str(), value, "");
+            mValue = value;
+            return !valid || mValue != old;
+        }
+    } else if (__system_property_serial(mInfo) == mSerial) {
+        return false;
+    }
+
+    __system_property_read_callback(mInfo, onRead, this);
+    return !valid || mValue != old;
+}
+
+std::string CachedProperty::get()
+{
+    refresh();
+
+    Mutex::Autolock _l(mLock);
+    return mValue;
+}
+
+bool CachedProperty::getBool(bool default_value)
+{
+    std::string value = get();
+
+    if (value == "1" || !strcasecmp(value.c_str(), "on") ||
+        !strcasecmp(value.c_str(), "true"))
+        return true;
+    if (value == "0" || !strcasecmp(value.c_str(), "off") ||
+        !strcasecmp(value.c_str(), "false"))
+        return false;
+    return default_value;
+}
+
+namespace {
+
+struct watch {
+    CachedProperty *prop;
+    void (*callback)(void *data);
+    void *data;
+    // Value last reported, other readers may have refreshed since
+    std::string value;
+};
+
+/* Sleeps on the global serial, which moves on every property change,
+ * and checks the watched properties when it does */
+class PropertyWatcher : public Thread {
+public:
+    PropertyWatcher() : mSerial(__system_property_area_serial()) {}
+
+    void add(const watch& w)
+    {
+        Mutex::Autolock _l(mLock);
+
+        mWatches.push_back(w);
+    }
+
+private:
+    virtual bool threadLoop()
+    {
+        if (!__system_property_wait(NULL, mSerial, &mSerial, NULL)) {
+            ALOGE("Cannot wait for property changes, watches stopped");
+            return false;
+        }
+
+        Mutex::Autolock _l(mLock);
+        for (auto &w : mWatches) {
+            std::string value = w.prop->get();
+
+            if (value == w.value)
+                continue;
+            w.value = value;
+            w.callback(w.data);
+        }
+        return true;
+    }
+
+    Mutex mLock;
+    std::vector<watch> mWatches;
+    uint32_t mSerial;
+};
+
+}  // namespace
+
+void property_watch(CachedProperty *prop, void (*callback)(void *data), void *data)
+{
+    static Mutex lock;
+    static sp<PropertyWatcher> watcher;
+    Mutex::Autolock _l(lock);
+
+    // Changes before the watch are not reported
+    watch w = {prop, callback, data, prop->get()};
+
+    if (watcher != NULL) {
+        watcher->add(w);
+        return;
+    }
+
+    watcher = new PropertyWatcher();
+    watcher->add(w);
+    watcher->run("powerHAL::props", android::PRIORITY_BACKGROUND);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_PROPS_H
+#define POWER_HAL_PROPS_H
+
+#include <stdint.h>
+#include <string>
+
+#include <sys/system_properties.h>
+#include <utils/Mutex.h>
+
+using android::Mutex;
+
+/*
+ * System properties read on every hint or screen transition. The
+ * property is looked up once and its value copied only when its serial
+ * changes, so a read that finds nothing new costs one atomic load. A
+ * property that does not exist yet is looked up again only once the
+ * property area has grown.
+ *
+ * property_watch() calls back when a property changes, from a thread
+ * that sleeps on the global property serial.
+ */
+class CachedProperty {
+public:
+    explicit CachedProperty(const char *name);
+
+    /* Rereads the value if it changed. Returns true if it differs from
+     * the one seen by the previous call. */
+    bool refresh();
+
+    /* Current value, "" if the property is not set */
+    std::string get();
+    bool getBool(bool default_value);
+
+    const std::string& name() const { return mName; }
+
+private:
+    static void onRead(void *cookie, const char *name, const char *value, uint32_t serial);
+
+    const std::string mName;
+    Mutex mLock;
+    const prop_info *mInfo;
+    uint32_t mSerial;
+    uint32_t mAreaSerial;
+    bool mValid;
+    std::string mValue;
+};
+
+/* Calls callback(data) after the value of prop changes, on the watcher
+ * thread. Callbacks run one at a time and must not add watches. */
+void property_watch(CachedProperty *prop, void (*callback)(void *data), void *data);
+
+#endif  // POWER_HAL_PROPS_H
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::reload"
+
+#include <stdlib.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "powerhal_parser.h"
+#include "powerhal_reload.h"
+
+// Editors and adb push write in several steps; wait for them to finish
+#define RELOAD_SETTLE_MS 200
+
+namespace {
+
+/* Events and reloads are handled on the looper thread */
+class ConfigWatcher {
+public:
+    ConfigWatcher(struct powerhal_info *pInfo, const std::string& path) :
+        mInfo(pInfo),
+        mPath(path),
+        mDir(path.substr(0, path.rfind('/'))),
+        mName(path.substr(path.rfind('/') + 1)),
+        mFd(-1),
+        mGeneration(0) {}
+
+    int start();
+
+private:
+    class ReloadTask : public TimeoutPoker::Task {
+    public:
+        ReloadTask(ConfigWatcher *watcher, int generation) :
+            watcher(watcher), generation(generation) {}
+        virtual void run() { watcher->reload(generation); }
+    private:
+        ConfigWatcher *watcher;
+        int generation;
+    };
+
+    static int onEvent(int fd, int events, void *data);
+    void drain();
+    void reload(int generation);
+
+    struct powerhal_info *mInfo;
+    const std::string mPath;
+    const std::string mDir;
+    const std::string mName;
+    int mFd;
+    int mGeneration;
+};
+
+int ConfigWatcher::start()
+{
+    mFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mFd < 0) {
+        ALOGE("Cannot create inotify instance: %s", strerror(errno));
+        return -1;
+    }
+
+    // Watch the directory, so files replaced by rename are seen too
+    if (inotify_add_watch(mFd, root_path(mDir.c_str()).c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        ALOGE("Cannot watch %s: %s", mDir.c_str(), strerror(errno));
+        close(mFd);
+        mFd = -1;
+        return -1;
+    }
+
+    if (mInfo->mTimeoutPoker->watchFd(mFd, onEvent, this)) {
+        ALOGE("Cannot poll inotify events");
+        close(mFd);
+        mFd = -1;
+        return -1;
+    }
+
+    ALOGI("Watching %s for changes", mPath.c_str());
+    return 0;
+}
+
+int ConfigWatcher::onEvent(__attribute__((unused)) int fd, int events, void *data)
+{
+    ConfigWatcher *watcher = static_cast<ConfigWatcher*>(data);
+
+    if (events & (ALOOPER_EVENT_ERROR | ALOOPER_EVENT_HANGUP)) {
+        ALOGE("inotify fd failed, hot reload stopped");
+        return 0;
+    }
+
+    watcher->drain();
+    return 1;
+}
+
+void ConfigWatcher::drain()
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t len;
+
+    while ((len = read(mFd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = reinterpret_cast<const struct inotify_event*>(p);
+
+            if (ev->len && mName == ev->name)
+                changed = true;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+
+    // Every change restarts the wait, only the last one reloads
+    if (changed)
+        mInfo->mTimeoutPoker->postTaskDelayed(new ReloadTask(this, ++mGeneration),
+                                              ms2ns(RELOAD_SETTLE_MS));
+}
+
+static void free_staging(struct powerhal_info *staging)
+{
+    for (auto &dev : staging->input_devs)
+        free(const_cast<char*>(dev.dev_name));
+    for (auto &cluster : staging->cpu_clusters) {
+        free(const_cast<char*>(cluster.pmqos_constraint_path));
+        free(const_cast<char*>(cluster.available_freqs_path));
+    }
+    delete staging;
+}
+
+void ConfigWatcher::reload(int generation)
+{
+    struct powerhal_info *staging;
+
+    // Superseded by a later change
+    if (generation != mGeneration)
+        return;
+
+    staging = new powerhal_info();
+    if (parse_xml_file(staging, mPath.c_str(), false)) {
+        ALOGE("Keeping the current hint config, %s did not parse", mPath.c_str());
+    } else if (hint_config_publish(mInfo, hint_config_take(staging))) {
+        ALOGE("Keeping the current hint config, clusters cannot change without a restart");
+    } else {
+        ALOGI("Reloaded hint config from %s", mPath.c_str());
+    }
+    free_staging(staging);
+}
+
+}  // namespace
+
+void config_reload_init(struct powerhal_info *pInfo)
+{
+    ConfigWatcher *watcher;
+
+    // Nothing to watch when running on built-in defaults
+    if (pInfo->config_path.empty())
+        return;
+
+    watcher = new ConfigWatcher(pInfo, pInfo->config_path);
+    if (watcher->start())
+        delete watcher;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_RELOAD_H
+#define POWER_HAL_RELOAD_H
+
+#include "powerhal.h"
+
+/*
+ * Hot reload of the hint tables. The directory of the XML the config was
+ * read from is watched with inotify from the TimeoutPoker looper. Once
+ * writes to the file have settled for RELOAD_SETTLE_MS, it is parsed
+ * into a scratch powerhal_info on the looper thread and the resulting
+ * tables are published with hint_config_publish(). Hints in flight
+ * finish on the tables they started with.
+ *
+ * Only the hint tables and intervals are reloaded. Clusters, node paths,
+ * input devices and the boot boost are fixed at start, and a file with
+ * another number of clusters is rejected. Requests already held keep the
+ * range they were placed with until they are next renewed.
+ */
+void config_reload_init(struct powerhal_info *pInfo);
+
+#endif  // POWER_HAL_RELOAD_H
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays a hint trace recorded by the HAL through the hint handling code
+ * and prints the resulting timeline of effective constraints:
+ *
+ *   powerhal_replay [-g max_gap_ms] [-w drain_ms] trace_file
+ *
+ * Resource backends are replaced by recorders, so no constraint reaches
+ * the kernel. Other sysfs writes, e.g. governor tunables, go below the
+ * filesystem root; point POWERHAL_ROOT at a fake tree to keep them off
+ * the device. The HAL runs on a virtual clock set to the trace time, so
+ * rate limits, boost timeouts and looper tasks see the recorded spacing
+ * of the hints, and a trace gives the same timeline on every run without
+ * waiting out its gaps. Idle gaps longer than max_gap_ms are shortened
+ * to it. After the last hint the clock runs on for drain_ms so that
+ * pending timeouts show up.
+ *
+ * Output lines are "<trace time in s> <source> <details>", e.g.
+ *
+ *         12.345  hint         0x2 [1]
+ *         12.346  cpu0         min=1020000 max=-
+ */
+#define LOG_TAG "powerhal_replay"
+
+#include <algorithm>
+#include <fstream>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "powerhal.h"
+#include "powerhal_session.h"
+#include "powerhal_trace.h"
+
+#define DEFAULT_MAX_GAP_MS 5000
+#define DEFAULT_DRAIN_MS 5000
+
+static Mutex timeline_lock;
+// Trace time of the first record
+static nsecs_t replay_start;
+// Trace time cut out of long idle gaps so far
+static nsecs_t replay_skipped;
+static int cpu_clusters;
+
+static void timeline_print(const char *source, const char *fmt, ...)
+        __attribute__((format(printf, 2, 3)));
+
+static void timeline_print(const char *source, const char *fmt, ...)
+{
+    Mutex::Autolock _l(timeline_lock);
+    nsecs_t t = powerhal_time() - replay_start + replay_skipped;
+    va_list ap;
+
+    printf("%10.3f  %-11s  ", t / 1e9, source);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+    fflush(stdout);
+}
+
+/* Prints the effective range of a resource whenever it changes */
+class TimelineBackend : public AggregatedBackend {
+public:
+    TimelineBackend(TimeoutPoker* poker, const std::string& name) :
+        AggregatedBackend(poker, 0, INT_MAX), mName(name) {}
+
+    virtual const char* type() const { return "timeline"; }
+    virtual const char* path() const { return mName.c_str(); }
+
+protected:
+    virtual void apply(int min, int max)
+    {
+        char lo[16] = "-", hi[16] = "-";
+
+        if (min != mHwMin)
+            snprintf(lo, sizeof(lo), "%d", min);
+        if (max != mHwMax)
+            snprintf(hi, sizeof(hi), "%d", max);
+        timeline_print(mName.c_str(), "min=%s max=%s", lo, hi);
+    }
+
+private:
+    const std::string mName;
+};
+
+static ResourceBackend* timeline_probe(TimeoutPoker* poker, const char* resource,
+                                       __attribute__((unused)) const char* path)
+{
+    std::string name(resource);
+
+    if (name == "cpu")
+        name += std::to_string(cpu_clusters++);
+
+    return new TimelineBackend(poker, name);
+}
+
+static int load_trace(const char *path, std::vector<trace_record_t>& records)
+{
+    std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+    trace_header_t header;
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        fprintf(stderr, "%s: cannot read trace header\n", path);
+        return -1;
+    }
+
+    if (header.magic != POWERHAL_TRACE_MAGIC ||
+        header.version != POWERHAL_TRACE_VERSION ||
+        header.record_size != sizeof(trace_record_t) || !header.capacity) {
+        fprintf(stderr, "%s: not a version %d hint trace\n", path, POWERHAL_TRACE_VERSION);
+        return -1;
+    }
+
+    std::vector<trace_record_t> ring(header.capacity);
+    file.read(reinterpret_cast<char*>(ring.data()), ring.size() * sizeof(trace_record_t));
+
+    // Oldest record first
+    uint64_t n = std::min<uint64_t>(header.count, header.capacity);
+    uint64_t first = header.count - n;
+    for (uint64_t i = first; i < header.count; i++)
+        records.push_back(ring[i % header.capacity]);
+
+    return 0;
+}
+
+static void replay(struct powerhal_info *pInfo, const trace_record_t& r)
+{
+    std::vector<int32_t> data(r.data, r.data + std::min<int>(r.len, POWERHAL_TRACE_MAX_DATA));
+    ExtPowerHint hint = static_cast<ExtPowerHint>(r.hint);
+    std::string values;
+
+    for (size_t i = 0; i < data.size(); i++)
+        values += (i ? " " : "") + std::to_string(data[i]);
+
+    if (r.len > POWERHAL_TRACE_MAX_DATA) {
+        // Keep the frame batches that fit so the data stays well formed
+        if (hint == ExtPowerHint::FRAMERATE_DATA)
+            data[1] = std::min(data[1], (POWERHAL_TRACE_MAX_DATA - 2) / 2);
+        fprintf(stderr, "hint 0x%x: data truncated from %d ints\n", r.hint, r.len);
+    }
+
+    // A record shorter than its frame count would be read past its end
+    if (hint == ExtPowerHint::FRAMERATE_DATA && !data.empty() && data[0] > 0 &&
+        (data.size() < 2 || data[1] < 0 || data.size() < 2 + 2 * (size_t)data[1])) {
+        fprintf(stderr, "hint 0x%x: skipping, frame count does not match %zu ints\n",
+                r.hint, data.size());
+        return;
+    }
+
+    switch (r.event) {
+    case TRACE_POWER_HINT:
+        timeline_print("hint", "0x%x [%s]", r.hint, values.c_str());
+        common_power_hint(pInfo, hint, data.data(), data.size());
+        break;
+    case TRACE_POWER_HINT_EXT:
+        timeline_print("hint_ext", "0x%x [%s]", r.hint, values.c_str());
+        if (is_session_hint(hint))
+            common_power_session_hint(pInfo, hint, data.data(), data.size());
+        else
+            common_power_hint(pInfo, hint, data.empty() ? NULL : data.data(), data.size());
+        break;
+    case TRACE_SET_INTERACTIVE:
+        timeline_print("interactive", "%d", data.empty() ? 0 : data[0]);
+        common_power_set_interactive(pInfo, data.empty() ? 0 : data[0]);
+        break;
+    default:
+        fprintf(stderr, "skipping unknown event %d\n", r.event);
+        break;
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-g max_gap_ms] [-w drain_ms] trace_file\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<trace_record_t> records;
+    nsecs_t max_gap = ms2ns(DEFAULT_MAX_GAP_MS);
+    nsecs_t drain = ms2ns(DEFAULT_DRAIN_MS);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:w:")) != -1) {
+        switch (opt) {
+        case 'g':
+            max_gap = ms2ns(atoi(optarg));
+            break;
+        case 'w':
+            drain = ms2ns(atoi(optarg));
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (load_trace(argv[optind], records))
+        return 1;
+    if (records.empty()) {
+        fprintf(stderr, "%s: trace is empty\n", argv[optind]);
+        return 0;
+    }
+
+    resource_set_probe_hook(timeline_probe);
+    replay_start = records[0].time_ns;
+    powerhal_set_virtual_time(replay_start);
+
+    struct powerhal_info *pInfo = new powerhal_info();
+    common_power_open(pInfo);
+    common_power_init(pInfo);
+
+    nsecs_t prev = records[0].time_ns;
+
+    for (auto &r : records) {
+        nsecs_t gap = r.time_ns - prev;
+
+        if (gap > max_gap) {
+            Mutex::Autolock _l(timeline_lock);
+            replay_skipped += gap - max_gap;
+        }
+        prev = r.time_ns;
+
+        // Run what falls due up to the record's trace time
+        pInfo->mTimeoutPoker->advanceClock(r.time_ns - replay_skipped);
+
+        replay(pInfo, r);
+    }
+
+    pInfo->mTimeoutPoker->advanceClock(powerhal_time() + drain);
+    return 0;
+}
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::residency"
+
+#include <algorithm>
+#include <limits.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "powerhal.h"
+#include "powerhal_parser.h"
+#include "powerhal_residency.h"
+
+// time_in_state counts in units of 10ms
+#define TIME_IN_STATE_UNIT_MS 10
+// No request sets the bound
+#define NO_BOUND INT_MIN
+
+namespace {
+
+struct Request {
+    int tag;
+    int priority;
+    int max;
+    int min;
+    nsecs_t expiry;     // 0 for held requests
+};
+
+struct TagStats {
+    uint64_t requests;
+    nsecs_t floor_ns;
+    nsecs_t cap_ns;
+};
+
+struct Account {
+    std::string name;
+    std::map<int, Request> held;
+    std::vector<Request> timed;
+    std::map<int, TagStats> stats;
+
+    // Tags of the requests currently setting the effective bounds
+    int floor_tag;
+    int cap_tag;
+    nsecs_t since;
+
+    int time_in_state_fd;
+    std::map<int, uint64_t> last_time_in_state;
+    std::map<int, uint64_t> boosted_ms;
+    std::map<int, uint64_t> unboosted_ms;
+};
+
+thread_local int current_tag = RESIDENCY_NO_TAG;
+
+Mutex residency_lock;
+std::map<ResourceBackend*, Account> accounts;
+
+}  // namespace
+
+ResidencyScope::ResidencyScope(int tag) : mPrevTag(current_tag)
+{
+    current_tag = tag;
+}
+
+ResidencyScope::~ResidencyScope()
+{
+    current_tag = mPrevTag;
+}
+
+/* Folds the time_in_state delta since the last read into the boosted or
+ * unboosted table, by whether a floor was held over that time. */
+static void sample_time_in_state(Account& acct, bool boosted)
+{
+    char buf[2048];
+    ssize_t len;
+    char *line, *save;
+
+    if (acct.time_in_state_fd < 0)
+        return;
+
+    len = pread(acct.time_in_state_fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return;
+    buf[len] = '\0';
+
+    std::map<int, uint64_t>& table = boosted ? acct.boosted_ms : acct.unboosted_ms;
+    for (line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        int freq;
+        unsigned long long ticks;
+
+        if (sscanf(line, "%d %llu", &freq, &ticks) != 2)
+            continue;
+
+        uint64_t ms = ticks * TIME_IN_STATE_UNIT_MS;
+        auto last = acct.last_time_in_state.find(freq);
+        if (last != acct.last_time_in_state.end() && ms >= last->second)
+            table[freq] += ms - last->second;
+        acct.last_time_in_state[freq] = ms;
+    }
+}
+
+/* Finds which requests set the effective range, walking from the highest
+ * priority down like AggregatedBackend does. */
+static void find_bounds(const Account& acct, int *floor_tag, int *cap_tag)
+{
+    std::vector<const Request*> reqs;
+    int lo = 0, hi = INT_MAX;
+
+    for (auto &it : acct.held)
+        reqs.push_back(&it.second);
+    for (auto &r : acct.timed)
+        reqs.push_back(&r);
+
+    std::stable_sort(reqs.begin(), reqs.end(),
+            [](const Request* a, const Request* b) { return a->priority > b->priority; });
+
+    *floor_tag = NO_BOUND;
+    *cap_tag = NO_BOUND;
+    for (auto r : reqs) {
+        if (r->min > lo) {
+            lo = std::min(r->min, hi);
+            *floor_tag = r->tag;
+        }
+        if (r->max != PM_QOS_DEFAULT_VALUE && r->max < hi) {
+            hi = std::max(r->max, lo);
+            *cap_tag = r->tag;
+        }
+    }
+}
+
+static void charge(Account& acct, nsecs_t until)
+{
+    nsecs_t dt = until - acct.since;
+
+    if (dt <= 0)
+        return;
+
+    if (acct.floor_tag != NO_BOUND)
+        acct.stats[acct.floor_tag].floor_ns += dt;
+    if (acct.cap_tag != NO_BOUND)
+        acct.stats[acct.cap_tag].cap_ns += dt;
+    acct.since = until;
+}
+
+static void refresh(Account& acct)
+{
+    int floor_tag, cap_tag;
+
+    find_bounds(acct, &floor_tag, &cap_tag);
+
+    bool was_boosted = acct.floor_tag != NO_BOUND;
+    if (was_boosted != (floor_tag != NO_BOUND))
+        sample_time_in_state(acct, was_boosted);
+
+    acct.floor_tag = floor_tag;
+    acct.cap_tag = cap_tag;
+}
+
+/* Charges elapsed time up to now, retiring timed requests in the order
+ * they expired. */
+static void advance(Account& acct, nsecs_t now)
+{
+    while (!acct.timed.empty()) {
+        auto first = std::min_element(acct.timed.begin(), acct.timed.end(),
+                [](const Request& a, const Request& b) { return a.expiry < b.expiry; });
+
+        if (first->expiry > now)
+            break;
+
+        charge(acct, first->expiry);
+        acct.timed.erase(first);
+        refresh(acct);
+    }
+
+    charge(acct, now);
+}
+
+static Account *find_account(ResourceBackend *backend)
+{
+    auto it = accounts.find(backend);
+    return it == accounts.end() ? NULL : &it->second;
+}
+
+void residency_register(ResourceBackend *backend, const char *name,
+                        const char *time_in_state_path)
+{
+    Mutex::Autolock _l(residency_lock);
+
+    if (!backend)
+        return;
+
+    Account& acct = accounts[backend];
+    acct.name = name;
+    acct.floor_tag = NO_BOUND;
+    acct.cap_tag = NO_BOUND;
+    acct.since = powerhal_time();
+    acct.time_in_state_fd = time_in_state_path ?
+            root_open(time_in_state_path, O_RDONLY | O_CLOEXEC) : -1;
+    sample_time_in_state(acct, false);
+}
+
+void residency_request(ResourceBackend *backend, int handle,
+                       int priority, int max, int min, int time_ms)
+{
+    Mutex::Autolock _l(residency_lock);
+    nsecs_t now = powerhal_time();
+    Account *acct = find_account(backend);
+
+    if (!acct)
+        return;
+
+    advance(*acct, now);
+    acct->stats[current_tag].requests++;
+
+    if (!time_ms) {
+        if (handle >= 0)
+            acct->held[handle] = { current_tag, priority, max, min, 0 };
+    } else {
+        nsecs_t expiry = now + ms2ns(time_ms);
+        auto same = std::find_if(acct->timed.begin(), acct->timed.end(),
+                [&](const Request& r) {
+                    return r.tag == current_tag && r.priority == priority &&
+                           r.max == max && r.min == min;
+                });
+
+        // Repeats only extend, as they do in TimeoutPoker
+        if (same != acct->timed.end())
+            same->expiry = std::max(same->expiry, expiry);
+        else
+            acct->timed.push_back({ current_tag, priority, max, min, expiry });
+    }
+
+    refresh(*acct);
+}
+
+void residency_update(ResourceBackend *backend, int handle,
+                      int priority, int max, int min)
+{
+    Mutex::Autolock _l(residency_lock);
+    Account *acct = find_account(backend);
+
+    if (!acct)
+        return;
+
+    auto it = acct->held.find(handle);
+    if (it == acct->held.end())
+        return;
+
+    advance(*acct, powerhal_time());
+
+    // Whoever changed the request last owns it
+    if (current_tag != RESIDENCY_NO_TAG)
+        it->second.tag = current_tag;
+    it->second.priority = priority;
+    it->second.max = max;
+    it->second.min = min;
+
+    refresh(*acct);
+}
+
+void residency_release(ResourceBackend *backend, int handle)
+{
+    Mutex::Autolock _l(residency_lock);
+    Account *acct = find_account(backend);
+
+    if (!acct)
+        return;
+
+    advance(*acct, powerhal_time());
+    if (acct->held.erase(handle))
+        refresh(*acct);
+}
+
+static std::string tag_name(int tag)
+{
+    const char *name;
+    char buf[16];
+
+    if (tag == RESIDENCY_NO_TAG)
+        return "(untagged)";
+
+    name = power_hint_name(static_cast<ExtPowerHint>(tag));
+    if (name)
+        return name;
+
+    snprintf(buf, sizeof(buf), "0x%x", tag);
+    return buf;
+}
+
+void residency_dump(std::string& out)
+{
+    Mutex::Autolock _l(residency_lock);
+    nsecs_t now = powerhal_time();
+    char line[128];
+
+    out += "Constraint residency:\n";
+
+    for (auto &it : accounts) {
+        Account& acct = it.second;
+
+        advance(acct, now);
+        sample_time_in_state(acct, acct.floor_tag != NO_BOUND);
+
+        out += "  " + acct.name + ":\n";
+        snprintf(line, sizeof(line), "    %-20s %10s %12s %12s\n",
+                 "hint", "requests", "floor_ms", "cap_ms");
+        out += line;
+        for (auto &s : acct.stats) {
+            snprintf(line, sizeof(line), "    %-20s %10llu %12lld %12lld\n",
+                     tag_name(s.first).c_str(),
+                     (unsigned long long)s.second.requests,
+                     (long long)ns2ms(s.second.floor_ns),
+                     (long long)ns2ms(s.second.cap_ns));
+            out += line;
+        }
+
+        if (acct.time_in_state_fd < 0)
+            continue;
+
+        snprintf(line, sizeof(line), "    %-20s %12s %12s\n",
+                 "freq_khz", "boosted_ms", "unboosted_ms");
+        out += line;
+        for (auto &f : acct.last_time_in_state) {
+            snprintf(line, sizeof(line), "    %-20d %12llu %12llu\n", f.first,
+                     (unsigned long long)acct.boosted_ms[f.first],
+                     (unsigned long long)acct.unboosted_ms[f.first]);
+            out += line;
+        }
+    }
+}
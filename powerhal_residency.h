@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_RESIDENCY_H
+#define POWER_HAL_RESIDENCY_H
+
+#include <string>
+
+#include "powerhal_resource.h"
+
+/*
+ * Constraint residency accounting. Every request placed through the
+ * resource_* helpers is tagged with the hint being handled at the time
+ * (see ResidencyScope), and for each resource we keep:
+ *
+ *   - how many requests each hint placed,
+ *   - how long each hint's request was the effective floor and the
+ *     effective cap, following the same priority rules the backends
+ *     apply,
+ *   - for CPU clusters, cpufreq time_in_state split between time with
+ *     and without a floor in place.
+ *
+ * Timed requests are retired lazily, when the resource is next touched
+ * or the report is produced, so time_in_state splits around an expiring
+ * timed boost are approximate.
+ */
+
+/* Requests made on this thread while in scope are tagged with tag.
+ * Requests made outside any scope are reported as untagged. */
+#define RESIDENCY_NO_TAG -1
+
+class ResidencyScope {
+public:
+    ResidencyScope(int tag);
+    ~ResidencyScope();
+
+private:
+    int mPrevTag;
+};
+
+/* time_in_state_path may be NULL for resources without cpufreq stats */
+void residency_register(ResourceBackend *backend, const char *name,
+                        const char *time_in_state_path);
+
+/* Called by the resource_* helpers. time_ms is 0 for held requests. */
+void residency_request(ResourceBackend *backend, int handle,
+                       int priority, int max, int min, int time_ms);
+void residency_update(ResourceBackend *backend, int handle,
+                      int priority, int max, int min);
+void residency_release(ResourceBackend *backend, int handle);
+
+/* Appends a human readable report */
+void residency_dump(std::string& out);
+
+#endif  // POWER_HAL_RESIDENCY_H
@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::resource"
+
+#include <algorithm>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <vector>
+
+#include "powerhal_residency.h"
+#include "powerhal_resource.h"
+#include "powerhal_utils.h"
+#include "powerhal.h"
+
+#define DEVFREQ_CLASS_PATH "/sys/class/devfreq"
+#define TEGRA_CAP_CBUS_STATE "/sys/kernel/tegra_cap/cbus_cap_state"
+#define TEGRA_CAP_CBUS_LEVEL "/sys/kernel/tegra_cap/cbus_cap_level"
+#define PMQOS_EMC_FREQ_MIN "/dev/emc_freq_min"
+#define PMQOS_MIN_ONLINE_CPUS "/dev/min_online_cpus"
+#define PMQOS_MAX_ONLINE_CPUS "/dev/max_online_cpus"
+
+/*
+ * PmQosConstraintBackend
+ */
+int PmQosConstraintBackend::request(int priority, int max, int min)
+{
+    return mPoker->requestPmQos(mPath.c_str(), priority, max, min);
+}
+
+void PmQosConstraintBackend::requestTimed(int priority, int max, int min, nsecs_t timeoutNs)
+{
+    mPoker->requestPmQosTimed(mPath.c_str(), priority, max, min, timeoutNs);
+}
+
+void PmQosConstraintBackend::update(int handle, int priority, int max, int min)
+{
+    mPoker->updatePmQos(handle, priority, max, min);
+}
+
+void PmQosConstraintBackend::release(int handle)
+{
+    if (handle >= 0)
+        close(handle);
+}
+
+/*
+ * AggregatedBackend
+ */
+AggregatedBackend::AggregatedBackend(TimeoutPoker* poker, int hwMin, int hwMax) :
+    ResourceBackend(poker),
+    mHwMin(hwMin),
+    mHwMax(hwMax),
+    mNextHandle(0),
+    mCurMin(hwMin),
+    mCurMax(hwMax)
+{
+}
+
+int AggregatedBackend::request(int priority, int max, int min)
+{
+    Mutex::Autolock _l(mLock);
+
+    int handle = mNextHandle;
+    mNextHandle = (mNextHandle + 1) & INT_MAX;
+    mRequests[handle] = { priority, max, min };
+    refresh();
+
+    return handle;
+}
+
+void AggregatedBackend::requestTimed(int priority, int max, int min, nsecs_t timeoutNs)
+{
+    if (timeoutNs == 0)
+        return;
+
+    int handle = request(priority, max, min);
+    mPoker->postTaskDelayed(new ReleaseTask(this, handle), timeoutNs);
+}
+
+void AggregatedBackend::update(int handle, int priority, int max, int min)
+{
+    Mutex::Autolock _l(mLock);
+
+    auto it = mRequests.find(handle);
+    if (it == mRequests.end())
+        return;
+
+    it->second = { priority, max, min };
+    refresh();
+}
+
+void AggregatedBackend::release(int handle)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (mRequests.erase(handle))
+        refresh();
+}
+
+void AggregatedBackend::refresh()
+{
+    std::vector<Request> reqs;
+    int lo = mHwMin;
+    int hi = mHwMax;
+
+    for (auto &it : mRequests)
+        reqs.push_back(it.second);
+
+    // Walk from the highest priority down, so that a lower priority floor
+    // can never push past a higher priority ceiling and vice versa.
+    std::stable_sort(reqs.begin(), reqs.end(),
+            [](const Request& a, const Request& b) { return a.priority > b.priority; });
+
+    for (auto &r : reqs) {
+        if (r.min != PM_QOS_DEFAULT_VALUE && r.min > lo)
+            lo = std::min(r.min, hi);
+        if (r.max != PM_QOS_DEFAULT_VALUE && r.max < hi)
+            hi = std::max(r.max, lo);
+    }
+
+    if (lo == mCurMin && hi == mCurMax)
+        return;
+
+    mCurMin = lo;
+    mCurMax = hi;
+    apply(lo, hi);
+}
+
+/*
+ * PmQosValueBackend
+ */
+PmQosValueBackend::PmQosValueBackend(TimeoutPoker* poker, const char* minPath,
+        const char* maxPath) :
+    AggregatedBackend(poker, 0, INT_MAX),
+    mMinPath(minPath ? minPath : ""),
+    mMaxPath(maxPath ? maxPath : ""),
+    mMinFd(-1),
+    mMaxFd(-1)
+{
+}
+
+PmQosValueBackend::~PmQosValueBackend()
+{
+    if (mMinFd >= 0)
+        close(mMinFd);
+    if (mMaxFd >= 0)
+        close(mMaxFd);
+}
+
+const char* PmQosValueBackend::path() const
+{
+    return mMinPath.empty() ? mMaxPath.c_str() : mMinPath.c_str();
+}
+
+static void pmqos_value_set(const std::string& path, int* fd, int value, bool constrained)
+{
+    if (path.empty())
+        return;
+
+    if (!constrained) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+        return;
+    }
+
+    if (*fd < 0) {
+        *fd = root_open(path.c_str(), O_RDWR);
+        if (*fd < 0) {
+            ALOGE("unable to open pm_qos file for %s: %s", path.c_str(), strerror(errno));
+            return;
+        }
+    }
+    write(*fd, &value, sizeof(value));
+}
+
+void PmQosValueBackend::apply(int min, int max)
+{
+    pmqos_value_set(mMinPath, &mMinFd, min, min != mHwMin);
+    pmqos_value_set(mMaxPath, &mMaxFd, max, max != mHwMax);
+}
+
+/*
+ * SysfsBackend
+ */
+SysfsBackend::SysfsBackend(TimeoutPoker* poker, const char* type,
+        const char* minPath, const char* maxPath,
+        int hwMin, int hwMax, int scale) :
+    AggregatedBackend(poker, hwMin, hwMax),
+    mType(type),
+    mMinPath(minPath),
+    mMaxPath(maxPath),
+    mScale(scale),
+    mWrittenMin(hwMin)
+{
+}
+
+void SysfsBackend::apply(int min, int max)
+{
+    // The kernel rejects a floor above the current ceiling, so raise the
+    // ceiling first when the floor moves past it.
+    if (min > mWrittenMin) {
+        sysfs_write_int(mMaxPath.c_str(), max * mScale);
+        sysfs_write_int(mMinPath.c_str(), min * mScale);
+    } else {
+        sysfs_write_int(mMinPath.c_str(), min * mScale);
+        sysfs_write_int(mMaxPath.c_str(), max * mScale);
+    }
+    mWrittenMin = min;
+}
+
+/*
+ * TegraCapBackend
+ */
+TegraCapBackend::TegraCapBackend(TimeoutPoker* poker, const char* stateNode,
+        const char* levelNode) :
+    AggregatedBackend(poker, 0, INT_MAX),
+    mStatePath(stateNode),
+    mLevelPath(levelNode)
+{
+}
+
+void TegraCapBackend::apply(__attribute__((unused)) int min, int max)
+{
+    if (max == mHwMax) {
+        sysfs_write_int(mStatePath.c_str(), 0);
+        return;
+    }
+    sysfs_write_int(mStatePath.c_str(), 1);
+    sysfs_write_int(mLevelPath.c_str(), max);
+}
+
+/*
+ * Helpers
+ */
+int resource_request(ResourceBackend* backend, int priority, int max, int min)
+{
+    int handle;
+
+    if (!backend)
+        return -1;
+
+    handle = backend->request(priority, max, min);
+    residency_request(backend, handle, priority, max, min, 0);
+    return handle;
+}
+
+void resource_request_timed(ResourceBackend* backend, int priority,
+                            int max, int min, int time_ms)
+{
+    if (!backend || time_ms <= 0)
+        return;
+
+    backend->requestTimed(priority, max, min, ms2ns(time_ms));
+    residency_request(backend, -1, priority, max, min, time_ms);
+}
+
+/* Updates a held request, placing it first if there is none. */
+void resource_update(ResourceBackend* backend, int* handle, int priority, int max, int min)
+{
+    if (!backend)
+        return;
+
+    if (*handle < 0) {
+        *handle = resource_request(backend, priority, max, min);
+    } else {
+        backend->update(*handle, priority, max, min);
+        residency_update(backend, *handle, priority, max, min);
+    }
+}
+
+void resource_release(ResourceBackend* backend, int* handle)
+{
+    if (backend && *handle >= 0) {
+        backend->release(*handle);
+        residency_release(backend, *handle);
+    }
+    *handle = -1;
+}
+
+/*
+ * Probing
+ */
+static int read_sysfs_int(const char* path, int* value)
+{
+    char buf[32] = { 0 };
+
+    if (root_access(path, R_OK))
+        return -1;
+
+    sysfs_read(path, buf, sizeof(buf));
+    if (buf[0] < '0' || buf[0] > '9')
+        return -1;
+
+    *value = atoi(buf);
+    return 0;
+}
+
+static bool node_writable(const char* path)
+{
+    return path && !root_access(path, W_OK);
+}
+
+/* Looks for a devfreq device whose name contains match. */
+static bool find_devfreq_dir(const char* match, std::string& dir)
+{
+    DIR* d = opendir(root_path(DEVFREQ_CLASS_PATH).c_str());
+    struct dirent* de;
+
+    if (!d)
+        return false;
+
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.' || !strstr(de->d_name, match))
+            continue;
+        dir = std::string(DEVFREQ_CLASS_PATH "/") + de->d_name;
+        closedir(d);
+        return true;
+    }
+
+    closedir(d);
+    return false;
+}
+
+/* Devfreq works in Hz, the rest of the HAL in kHz. */
+static ResourceBackend* probe_devfreq_backend(TimeoutPoker* poker, const char* match)
+{
+    std::string dir;
+    char buf[512] = { 0 };
+    int lo = INT_MAX, hi = 0;
+
+    if (!find_devfreq_dir(match, dir))
+        return NULL;
+
+    std::string minPath = dir + "/min_freq";
+    std::string maxPath = dir + "/max_freq";
+    std::string freqsPath = dir + "/available_frequencies";
+
+    if (!node_writable(minPath.c_str()) || !node_writable(maxPath.c_str()))
+        return NULL;
+
+    sysfs_read(freqsPath.c_str(), buf, sizeof(buf));
+    for (char* pch = strtok(buf, " \n"); pch; pch = strtok(NULL, " \n")) {
+        int khz = atoi(pch) / 1000;
+        if (khz <= 0)
+            continue;
+        lo = std::min(lo, khz);
+        hi = std::max(hi, khz);
+    }
+    if (lo > hi) {
+        ALOGW("%s: no frequencies in %s", __func__, freqsPath.c_str());
+        return NULL;
+    }
+
+    return new SysfsBackend(poker, "devfreq", minPath.c_str(), maxPath.c_str(),
+                            lo, hi, 1000);
+}
+
+static resource_probe_hook_t probe_hook;
+
+void resource_set_probe_hook(resource_probe_hook_t hook)
+{
+    probe_hook = hook;
+}
+
+static ResourceBackend* run_probe_hook(TimeoutPoker* poker, const char* resource,
+                                       const char* path)
+{
+    return probe_hook ? probe_hook(poker, resource, path) : NULL;
+}
+
+ResourceBackend* probe_cpu_backend(TimeoutPoker* poker, const char* pmqos_constraint_path,
+                                   const char* available_freqs_path)
+{
+    ResourceBackend* backend = run_probe_hook(poker, "cpu", pmqos_constraint_path);
+    if (backend)
+        return backend;
+
+    if (node_writable(pmqos_constraint_path))
+        return new PmQosConstraintBackend(poker, pmqos_constraint_path);
+
+    // Fall back to the cpufreq policy the frequency table belongs to.
+    if (!available_freqs_path)
+        return NULL;
+
+    std::string dir(available_freqs_path);
+    dir = dir.substr(0, dir.rfind('/'));
+
+    std::string minPath = dir + "/scaling_min_freq";
+    std::string maxPath = dir + "/scaling_max_freq";
+    int lo, hi;
+
+    if (!node_writable(minPath.c_str()) || !node_writable(maxPath.c_str()) ||
+        read_sysfs_int((dir + "/cpuinfo_min_freq").c_str(), &lo) ||
+        read_sysfs_int((dir + "/cpuinfo_max_freq").c_str(), &hi))
+        return NULL;
+
+    return new SysfsBackend(poker, "cpufreq", minPath.c_str(), maxPath.c_str(), lo, hi, 1);
+}
+
+ResourceBackend* probe_gpu_backend(TimeoutPoker* poker)
+{
+    ResourceBackend* backend = run_probe_hook(poker, "gpu", NULL);
+    if (backend)
+        return backend;
+
+    if (node_writable(PMQOS_CONSTRAINT_GPU_FREQ))
+        return new PmQosConstraintBackend(poker, PMQOS_CONSTRAINT_GPU_FREQ);
+
+    backend = probe_devfreq_backend(poker, "gpu");
+    if (backend)
+        return backend;
+
+    if (node_writable(TEGRA_CAP_CBUS_STATE) && node_writable(TEGRA_CAP_CBUS_LEVEL))
+        return new TegraCapBackend(poker, TEGRA_CAP_CBUS_STATE, TEGRA_CAP_CBUS_LEVEL);
+
+    return NULL;
+}
+
+ResourceBackend* probe_emc_backend(TimeoutPoker* poker)
+{
+    ResourceBackend* backend = run_probe_hook(poker, "emc", NULL);
+    if (backend)
+        return backend;
+
+    if (node_writable(PMQOS_EMC_FREQ_MIN))
+        return new PmQosValueBackend(poker, PMQOS_EMC_FREQ_MIN, NULL);
+
+    return probe_devfreq_backend(poker, "emc");
+}
+
+ResourceBackend* probe_online_cpus_backend(TimeoutPoker* poker)
+{
+    ResourceBackend* backend = run_probe_hook(poker, "online_cpus", NULL);
+    bool has_min, has_max;
+
+    if (backend)
+        return backend;
+
+    if (node_writable(PMQOS_CONSTRAINT_ONLINE_CPUS))
+        return new PmQosConstraintBackend(poker, PMQOS_CONSTRAINT_ONLINE_CPUS);
+
+    has_min = node_writable(PMQOS_MIN_ONLINE_CPUS);
+    has_max = node_writable(PMQOS_MAX_ONLINE_CPUS);
+    if (has_min || has_max)
+        return new PmQosValueBackend(poker,
+                                     has_min ? PMQOS_MIN_ONLINE_CPUS : NULL,
+                                     has_max ? PMQOS_MAX_ONLINE_CPUS : NULL);
+
+    return NULL;
+}
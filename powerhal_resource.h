@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_RESOURCE_H
+#define POWER_HAL_RESOURCE_H
+
+#include <map>
+#include <string>
+
+#include "timeoutpoker.h"
+
+/*
+ * A resource backend drives one frequency or core-count resource through
+ * whichever kernel interface the platform provides. Backends are picked
+ * once at startup by the probe functions below, so the hint code never
+ * needs to know which kernel it runs on.
+ *
+ * Values are in the resource's request unit (kHz for CPU, GPU and EMC,
+ * cores for online cpus). A bound of PM_QOS_DEFAULT_VALUE leaves that
+ * side of the range unconstrained. When requests conflict, the one with
+ * the higher priority wins.
+ */
+class ResourceBackend {
+public:
+    ResourceBackend(TimeoutPoker* poker) : mPoker(poker) {}
+    virtual ~ResourceBackend() {}
+
+    virtual const char* type() const = 0;
+    virtual const char* path() const = 0;
+
+    // Places a constraint until release() is called with the returned
+    // handle. Returns -1 on failure.
+    virtual int request(int priority, int max, int min) = 0;
+    // Places a constraint which is dropped after timeoutNs.
+    virtual void requestTimed(int priority, int max, int min, nsecs_t timeoutNs) = 0;
+    // Changes the range of a held request in place.
+    virtual void update(int handle, int priority, int max, int min) = 0;
+    virtual void release(int handle) = 0;
+
+protected:
+    TimeoutPoker* mPoker;
+};
+
+/* Kernel-aggregated constraint node taking "max min priority timeout"
+ * commands, e.g. /dev/constraint_cpu_freq. The handle is the open fd. */
+class PmQosConstraintBackend : public ResourceBackend {
+public:
+    PmQosConstraintBackend(TimeoutPoker* poker, const char* path) :
+        ResourceBackend(poker), mPath(path) {}
+
+    virtual const char* type() const { return "pmqos_constraint"; }
+    virtual const char* path() const { return mPath.c_str(); }
+
+    virtual int request(int priority, int max, int min);
+    virtual void requestTimed(int priority, int max, int min, nsecs_t timeoutNs);
+    virtual void update(int handle, int priority, int max, int min);
+    virtual void release(int handle);
+
+private:
+    const std::string mPath;
+};
+
+/* Base for interfaces that only hold a single value per bound. All
+ * outstanding requests are kept here and folded into one effective
+ * range, which is written out whenever it changes. */
+class AggregatedBackend : public ResourceBackend {
+public:
+    AggregatedBackend(TimeoutPoker* poker, int hwMin, int hwMax);
+
+    virtual int request(int priority, int max, int min);
+    virtual void requestTimed(int priority, int max, int min, nsecs_t timeoutNs);
+    virtual void update(int handle, int priority, int max, int min);
+    virtual void release(int handle);
+
+protected:
+    // Called with mLock held whenever the effective range changes. A
+    // bound equal to the hardware limit means it is unconstrained.
+    virtual void apply(int min, int max) = 0;
+
+    const int mHwMin;
+    const int mHwMax;
+
+private:
+    struct Request {
+        int priority;
+        int max;
+        int min;
+    };
+
+    class ReleaseTask : public TimeoutPoker::Task {
+    public:
+        ReleaseTask(AggregatedBackend* backend, int handle) :
+            backend(backend), handle(handle) {}
+        virtual void run() { backend->release(handle); }
+    private:
+        AggregatedBackend* backend;
+        int handle;
+    };
+
+    void refresh();
+
+    Mutex mLock;
+    std::map<int, Request> mRequests;
+    int mNextHandle;
+    int mCurMin;
+    int mCurMax;
+};
+
+/* Legacy PM QoS value nodes, e.g. /dev/emc_freq_min, which take a raw
+ * binary int and hold it for as long as the fd stays open. Either path
+ * may be NULL if the platform only exposes one bound. */
+class PmQosValueBackend : public AggregatedBackend {
+public:
+    PmQosValueBackend(TimeoutPoker* poker, const char* minPath, const char* maxPath);
+    virtual ~PmQosValueBackend();
+
+    virtual const char* type() const { return "pmqos_value"; }
+    virtual const char* path() const;
+
+protected:
+    virtual void apply(int min, int max);
+
+private:
+    const std::string mMinPath;
+    const std::string mMaxPath;
+    int mMinFd;
+    int mMaxFd;
+};
+
+/* Plain sysfs min/max nodes: cpufreq scaling_{min,max}_freq and devfreq
+ * {min,max}_freq. scale converts the request unit to the node's unit. */
+class SysfsBackend : public AggregatedBackend {
+public:
+    SysfsBackend(TimeoutPoker* poker, const char* type,
+            const char* minPath, const char* maxPath,
+            int hwMin, int hwMax, int scale);
+
+    virtual const char* type() const { return mType; }
+    virtual const char* path() const { return mMaxPath.c_str(); }
+
+protected:
+    virtual void apply(int min, int max);
+
+private:
+    const char* const mType;
+    const std::string mMinPath;
+    const std::string mMaxPath;
+    const int mScale;
+    int mWrittenMin;
+};
+
+/* Pre-T124 tegra_cap nodes, which can only cap the bus. */
+class TegraCapBackend : public AggregatedBackend {
+public:
+    TegraCapBackend(TimeoutPoker* poker, const char* stateNode, const char* levelNode);
+
+    virtual const char* type() const { return "tegra_cap"; }
+    virtual const char* path() const { return mLevelPath.c_str(); }
+
+protected:
+    virtual void apply(int min, int max);
+
+private:
+    const std::string mStatePath;
+    const std::string mLevelPath;
+};
+
+/* Helpers for optional resources; all of them accept a NULL backend.
+ * resource_release() resets the handle to -1. */
+int resource_request(ResourceBackend* backend, int priority, int max, int min);
+void resource_request_timed(ResourceBackend* backend, int priority,
+                            int max, int min, int time_ms);
+void resource_update(ResourceBackend* backend, int* handle, int priority, int max, int min);
+void resource_release(ResourceBackend* backend, int* handle);
+
+/* A probe hook is consulted before the kernel interfaces, e.g. so that the
+ * replay tool can record constraints instead of applying them. resource is
+ * "cpu", "gpu", "emc" or "online_cpus"; path is the cluster's constraint
+ * node for "cpu" and NULL otherwise. Returning NULL falls through to the
+ * normal probe. */
+typedef ResourceBackend* (*resource_probe_hook_t)(TimeoutPoker* poker,
+                                                  const char* resource, const char* path);
+void resource_set_probe_hook(resource_probe_hook_t hook);
+
+/* Probe functions return NULL when no interface for the resource exists. */
+ResourceBackend* probe_cpu_backend(TimeoutPoker* poker, const char* pmqos_constraint_path,
+                                   const char* available_freqs_path);
+ResourceBackend* probe_gpu_backend(TimeoutPoker* poker);
+ResourceBackend* probe_emc_backend(TimeoutPoker* poker);
+ResourceBackend* probe_online_cpus_backend(TimeoutPoker* poker);
+
+#endif  // POWER_HAL_RESOURCE_H
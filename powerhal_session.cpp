@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::session"
+
+#include <algorithm>
+
+#include "powerhal_residency.h"
+#include "powerhal_session.h"
+
+// Controller gains, in table positions per unit of relative error
+#define SESSION_KP 0.5f
+#define SESSION_KI 0.2f
+// Sessions that stop reporting are closed after this long
+#define SESSION_STALE_MS 1000
+
+HintSessionManager::HintSessionManager(struct powerhal_info *pInfo) :
+    mInfo(pInfo),
+    mHandles(pInfo->cpu_clusters.size(), -1),
+    mFloors(pInfo->cpu_clusters.size(), 0),
+    mStaleCheckPending(false)
+{
+}
+
+void HintSessionManager::create(int id, int target_us)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (target_us <= 0) {
+        ALOGE("%s: invalid target %d for session %d", __func__, target_us, id);
+        return;
+    }
+    if (!mSessions.count(id) && mSessions.size() >= SESSION_MAX) {
+        ALOGE("%s: %zu sessions open, refusing session %d", __func__, mSessions.size(), id);
+        return;
+    }
+
+    Session &session = mSessions[id];
+    session.target_us = target_us;
+    session.position = 0;
+    session.prev_error = 0;
+    session.last_report = powerhal_time();
+
+    if (!mStaleCheckPending) {
+        mStaleCheckPending = true;
+        mInfo->mTimeoutPoker->postTaskDelayed(new StaleCheckTask(this),
+                                              ms2ns(SESSION_STALE_MS));
+    }
+
+    ALOGV("%s: session %d target %dus", __func__, id, target_us);
+}
+
+void HintSessionManager::report(int id, const int32_t *actual_us, size_t count)
+{
+    Mutex::Autolock _l(mLock);
+
+    auto it = mSessions.find(id);
+    if (it == mSessions.end()) {
+        ALOGW("%s: unknown session %d", __func__, id);
+        return;
+    }
+
+    Session &session = it->second;
+    for (size_t i = 0; i < count; i++) {
+        if (actual_us[i] <= 0)
+            continue;
+
+        // Relative error, positive when the work overran its target.
+        // Clamped so a single hitch cannot slam the floor to the top.
+        float error = (float)(actual_us[i] - session.target_us) / session.target_us;
+        error = std::min(1.0f, std::max(-1.0f, error));
+
+        session.position += SESSION_KP * (error - session.prev_error) + SESSION_KI * error;
+        session.position = std::min(1.0f, std::max(0.0f, session.position));
+        session.prev_error = error;
+    }
+    session.last_report = powerhal_time();
+
+    applyFloors();
+}
+
+void HintSessionManager::setTarget(int id, int target_us)
+{
+    Mutex::Autolock _l(mLock);
+
+    auto it = mSessions.find(id);
+    if (it == mSessions.end() || target_us <= 0)
+        return;
+
+    it->second.target_us = target_us;
+    it->second.prev_error = 0;
+}
+
+void HintSessionManager::close(int id)
+{
+    Mutex::Autolock _l(mLock);
+
+    if (mSessions.erase(id))
+        applyFloors();
+}
+
+void HintSessionManager::checkStale()
+{
+    Mutex::Autolock _l(mLock);
+    nsecs_t now = powerhal_time();
+
+    // Clients that die without closing never report again
+    for (auto it = mSessions.begin(); it != mSessions.end(); ) {
+        if (now - it->second.last_report >= ms2ns(SESSION_STALE_MS)) {
+            ALOGV("%s: closing stale session %d", __func__, it->first);
+            it = mSessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    applyFloors();
+
+    mStaleCheckPending = !mSessions.empty();
+    if (mStaleCheckPending)
+        mInfo->mTimeoutPoker->postTaskDelayed(new StaleCheckTask(this),
+                                              ms2ns(SESSION_STALE_MS));
+}
+
+/* Must be called with mLock held. Every cluster gets the floor of the
+ * most demanding session, mapped onto its own frequency table. */
+void HintSessionManager::applyFloors()
+{
+    float position = 0;
+
+    for (auto &it : mSessions)
+        position = std::max(position, it.second.position);
+
+    for (size_t i = 0; i < mInfo->cpu_clusters.size(); i++) {
+        cpu_cluster_data_t &cluster = mInfo->cpu_clusters[i];
+        int floor = thermal_boost_min(mInfo, THERMAL_CPU, cluster_freq_at(&cluster, position),
+                                      cluster_freq_top(&cluster));
+
+        if (floor == mFloors[i])
+            continue;
+        mFloors[i] = floor;
+
+        // The lowest entry needs no request at all
+        if (!floor)
+            resource_release(cluster.backend, &mHandles[i]);
+        else
+            resource_update(cluster.backend, &mHandles[i], PM_QOS_BOOST_PRIORITY,
+                            PM_QOS_DEFAULT_VALUE, floor);
+    }
+}
+
+void HintSessionManager::refresh()
+{
+    Mutex::Autolock _l(mLock);
+
+    applyFloors();
+}
+
+void HintSessionManager::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    nsecs_t now = powerhal_time();
+    char line[160];
+
+    snprintf(line, sizeof(line), "Hint sessions: %zu\n", mSessions.size());
+    out += line;
+    for (auto &it : mSessions) {
+        snprintf(line, sizeof(line),
+                 "  session %d: target %dus, position %.2f, last report %lld ms ago\n",
+                 it.first, it.second.target_us, it.second.position,
+                 (long long)ns2ms(now - it.second.last_report));
+        out += line;
+    }
+    for (size_t i = 0; i < mHandles.size(); i++) {
+        snprintf(line, sizeof(line), "  cpu%zu floor %d (handle %d)\n",
+                 i, mFloors[i], mHandles[i]);
+        out += line;
+    }
+}
+
+bool is_session_hint(ExtPowerHint hint)
+{
+    return hint == POWER_HINT_SESSION_CREATE ||
+           hint == POWER_HINT_SESSION_REPORT ||
+           hint == POWER_HINT_SESSION_TARGET ||
+           hint == POWER_HINT_SESSION_CLOSE;
+}
+
+void common_power_session_hint(struct powerhal_info *pInfo, ExtPowerHint hint,
+                               const int32_t *data, size_t len)
+{
+    if (!pInfo || !pInfo->sessions)
+        return;
+
+    if (len < 1 || (hint != POWER_HINT_SESSION_CLOSE && len < 2)) {
+        ALOGE("%s: not enough data for hint 0x%x", __func__, static_cast<int>(hint));
+        return;
+    }
+
+    ResidencyScope scope(static_cast<int>(hint));
+
+    if (hint == POWER_HINT_SESSION_CREATE)
+        pInfo->sessions->create(data[0], data[1]);
+    else if (hint == POWER_HINT_SESSION_REPORT)
+        pInfo->sessions->report(data[0], data + 1, len - 1);
+    else if (hint == POWER_HINT_SESSION_TARGET)
+        pInfo->sessions->setTarget(data[0], data[1]);
+    else if (hint == POWER_HINT_SESSION_CLOSE)
+        pInfo->sessions->close(data[0]);
+}
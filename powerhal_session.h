@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_SESSION_H
+#define POWER_HAL_SESSION_H
+
+#include <map>
+#include <vector>
+
+#include "powerhal.h"
+
+/*
+ * Performance hint sessions, sent through powerHintExt with private hint
+ * ids above the ExtPowerHint range. A session covers a set of threads
+ * doing periodic work with a target duration. The client reports how
+ * long each unit of work actually took, and a PI controller moves the
+ * cluster floors along the frequency table until the reports meet the
+ * target. Durations are in microseconds; session ids are picked by the
+ * client. The floors apply to whole clusters, so the thread ids passed at
+ * create are accepted but not kept, and are lowered by the thermal policy
+ * like boosts. At most SESSION_MAX sessions are open
+ * at once, and a session that stops reporting is closed for the client.
+ *
+ *   SESSION_CREATE   {id, target_us, tid...}
+ *   SESSION_REPORT   {id, actual_us...}
+ *   SESSION_TARGET   {id, target_us}
+ *   SESSION_CLOSE    {id}
+ */
+#define POWER_HINT_SESSION_CREATE static_cast<ExtPowerHint>(0x7f000001)
+#define POWER_HINT_SESSION_REPORT static_cast<ExtPowerHint>(0x7f000002)
+#define POWER_HINT_SESSION_TARGET static_cast<ExtPowerHint>(0x7f000003)
+#define POWER_HINT_SESSION_CLOSE  static_cast<ExtPowerHint>(0x7f000004)
+
+#define SESSION_MAX 32
+
+class HintSessionManager {
+public:
+    HintSessionManager(struct powerhal_info *pInfo);
+
+    void create(int id, int target_us);
+    void report(int id, const int32_t *actual_us, size_t count);
+    void setTarget(int id, int target_us);
+    void close(int id);
+    /* Places the floors again, after the thermal limits on them changed */
+    void refresh();
+    void dump(std::string& out);
+
+private:
+    struct Session {
+        int target_us;
+        // Normalized position in the frequency table, 0 is the lowest
+        // entry and 1 the highest.
+        float position;
+        float prev_error;
+        nsecs_t last_report;
+    };
+
+    class StaleCheckTask : public TimeoutPoker::Task {
+    public:
+        StaleCheckTask(HintSessionManager *manager) : manager(manager) {}
+        virtual void run() { manager->checkStale(); }
+    private:
+        HintSessionManager *manager;
+    };
+
+    void checkStale();
+    void applyFloors();
+
+    struct powerhal_info *mInfo;
+    Mutex mLock;
+    std::map<int, Session> mSessions;
+    std::vector<int> mHandles;
+    std::vector<int> mFloors;
+    bool mStaleCheckPending;
+};
+
+bool is_session_hint(ExtPowerHint hint);
+void common_power_session_hint(struct powerhal_info *pInfo, ExtPowerHint hint,
+                               const int32_t *data, size_t len);
+
+#endif  // POWER_HAL_SESSION_H
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::thermal"
+
+#include <algorithm>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "powerhal_floor.h"
+#include "powerhal_framepacer.h"
+#ifdef USE_LOCAL_PHS
+#include "powerhal_phs.h"
+#endif
+#include "powerhal_session.h"
+#include "powerhal_thermal.h"
+
+#define THERMAL_ZONE_PATH "/sys/class/thermal/thermal_zone%d/%s"
+
+static const char *thermal_resource_names[THERMAL_RESOURCE_COUNT] = {
+    "cpu",
+    "gpu",
+    "emc",
+};
+
+ThermalMonitor *ThermalMonitor::create(struct powerhal_info *pInfo,
+                                       const thermal_policy_t& policy)
+{
+    ThermalMonitor *monitor;
+
+    if (policy.zones.empty())
+        return NULL;
+
+    monitor = new ThermalMonitor(pInfo, policy);
+    for (auto &zone : monitor->mPolicy.zones) {
+        for (auto &node : thermal_zone_open(zone.type))
+            monitor->mZones.push_back({&zone, node.id, node.fd, INT_MIN});
+    }
+    if (monitor->mZones.empty()) {
+        ALOGW("None of the thermal policy zones exist, boosts are not capped");
+        delete monitor;
+        return NULL;
+    }
+
+    ALOGI("Thermal policy: %zu zones", monitor->mZones.size());
+    monitor->sample();
+    return monitor;
+}
+
+ThermalMonitor::ThermalMonitor(struct powerhal_info *pInfo, const thermal_policy_t& policy) :
+    mInfo(pInfo),
+    mPolicy(policy),
+    mScale(100),
+    mFast(false)
+{
+    for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++)
+        mCaps[i] = PM_QOS_DEFAULT_VALUE;
+}
+
+std::vector<thermal_zone_node_t> thermal_zone_open(const std::string& type)
+{
+    std::vector<thermal_zone_node_t> nodes;
+    char path[80];
+
+    for (int id = 0; ; id++) {
+        char name[64] = { 0 };
+        int fd;
+
+        snprintf(path, sizeof(path), THERMAL_ZONE_PATH, id, "type");
+        if (root_access(path, F_OK))
+            break;
+
+        sysfs_read(path, name, sizeof(name));
+        name[strcspn(name, "\n")] = '\0';
+        if (type != name)
+            continue;
+
+        snprintf(path, sizeof(path), THERMAL_ZONE_PATH, id, "temp");
+        fd = root_open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            ALOGE("Cannot open %s: %s", path, strerror(errno));
+            continue;
+        }
+        nodes.push_back({id, fd});
+    }
+    return nodes;
+}
+
+int thermal_zone_read(int fd)
+{
+    char buf[16];
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+
+    if (len <= 0)
+        return INT_MIN;
+    buf[len] = '\0';
+    return atoi(buf);
+}
+
+/* Runs on the looper */
+void ThermalMonitor::sample()
+{
+    int scale = 100;
+    int caps[THERMAL_RESOURCE_COUNT];
+    std::vector<int> temps;
+    bool fast = false;
+    bool changed;
+
+    for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++)
+        caps[i] = PM_QOS_DEFAULT_VALUE;
+
+    for (auto &zone : mZones) {
+        const thermal_zone_policy_t *policy = zone.policy;
+        int temp = thermal_zone_read(zone.fd);
+        int headroom;
+
+        temps.push_back(temp);
+        if (temp == INT_MIN)
+            continue;
+
+        headroom = policy->trip - temp;
+        if (headroom < 2 * policy->margin)
+            fast = true;
+        if (headroom >= policy->margin)
+            continue;
+
+        // 100% at trip - margin down to scale% at the trip
+        headroom = std::max(headroom, 0);
+        scale = std::min(scale, policy->scale +
+                         (100 - policy->scale) * headroom / policy->margin);
+        for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++) {
+            if (policy->caps[i] != PM_QOS_DEFAULT_VALUE &&
+                (caps[i] == PM_QOS_DEFAULT_VALUE || policy->caps[i] < caps[i]))
+                caps[i] = policy->caps[i];
+        }
+    }
+
+    {
+        Mutex::Autolock _l(mLock);
+
+        changed = scale != mScale;
+        for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++)
+            changed |= caps[i] != mCaps[i];
+        if (changed)
+            ALOGI("Thermal boost limits: scale %d%%, caps %d/%d/%d", scale,
+                  caps[THERMAL_CPU], caps[THERMAL_GPU], caps[THERMAL_EMC]);
+
+        mScale = scale;
+        for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++)
+            mCaps[i] = caps[i];
+        mFast = fast;
+        for (size_t i = 0; i < mZones.size(); i++)
+            mZones[i].temp = temps[i];
+    }
+
+    // Not under mLock, they all ask for the limits
+    if (changed) {
+        if (mInfo->platform_floor)
+            mInfo->platform_floor->refresh();
+        interaction_boost_refresh(mInfo);
+        media_floors_refresh(mInfo);
+        mInfo->frame_pacer->refresh();
+        mInfo->sessions->refresh();
+#ifdef USE_LOCAL_PHS
+        powerhal_phs_refresh();
+#endif
+    }
+
+    mInfo->mTimeoutPoker->postTaskDelayed(new SampleTask(this),
+            ms2ns(fast ? mPolicy.fast_interval_ms : mPolicy.interval_ms));
+}
+
+int ThermalMonitor::boostMin(int resource, int min, int top)
+{
+    Mutex::Autolock _l(mLock);
+    int cap;
+
+    if (resource < 0 || resource >= THERMAL_RESOURCE_COUNT || min <= 0)
+        return min;
+
+    if (mScale < 100) {
+        if (min == INT_MAX && top > 0)
+            min = top;
+        if (min != INT_MAX)
+            min = (int)((int64_t)min * mScale / 100);
+    }
+
+    cap = mCaps[resource];
+    if (cap != PM_QOS_DEFAULT_VALUE && min > cap)
+        min = cap;
+    return min;
+}
+
+void ThermalMonitor::dump(std::string& out)
+{
+    Mutex::Autolock _l(mLock);
+    char line[160];
+
+    snprintf(line, sizeof(line), "Thermal boost limits: scale %d%%, sampling every %d ms\n",
+             mScale, mFast ? mPolicy.fast_interval_ms : mPolicy.interval_ms);
+    out += line;
+    for (int i = 0; i < THERMAL_RESOURCE_COUNT; i++) {
+        if (mCaps[i] == PM_QOS_DEFAULT_VALUE)
+            continue;
+        snprintf(line, sizeof(line), "  %s cap %d\n", thermal_resource_names[i], mCaps[i]);
+        out += line;
+    }
+    for (auto &zone : mZones) {
+        snprintf(line, sizeof(line), "  thermal_zone%d %s: %d (trip %d, margin %d)\n",
+                 zone.id, zone.policy->type.c_str(), zone.temp,
+                 zone.policy->trip, zone.policy->margin);
+        out += line;
+    }
+}
+
+int thermal_boost_min(struct powerhal_info *pInfo, int resource, int min, int top)
+{
+    if (!pInfo || !pInfo->thermal)
+        return min;
+    return pInfo->thermal->boostMin(resource, min, top);
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_THERMAL_H
+#define POWER_HAL_THERMAL_H
+
+#include <string>
+#include <vector>
+
+#include "powerhal.h"
+
+/*
+ * Boost floors lowered as thermal zones heat up, so that boosts on a
+ * fanless device do not run it into hardware throttling, which costs
+ * more than the boost gains. The policy comes from the <thermal_policy>
+ * section of the XML:
+ *
+ *   <thermal_policy interval="2000" fast_interval="250">
+ *     <thermal_zone type="CPU-therm" trip="95000" margin="10000" scale="50"
+ *                   cpu_cap="1428000"/>
+ *     <thermal_zone type="GPU-therm" trip="95000" margin="10000" scale="60"
+ *                   gpu_cap="614400"/>
+ *   </thermal_policy>
+ *
+ * Zones are matched by /sys/class/thermal/thermal_zoneN/type, and every
+ * zone of a type is watched. Temperatures are in millidegrees C and
+ * frequencies in kHz.
+ *
+ * Once a zone is within margin of its trip, the mins of timed boosts,
+ * touch boosts, camera and video encode floors, frame pacing, hint
+ * session, PHS and platform floors are scaled down linearly, from 100%
+ * at trip - margin to scale% at the trip, and held at or below the
+ * zone's caps. A boost to the top frequency, such as the PHS load hint
+ * of FRAMEWORKS_UI, is scaled from the cluster's top frequency where
+ * that is known, and is otherwise only capped. The zone with the least headroom
+ * sets the scale, and the caps of every zone within its margin apply.
+ * Maxima are never touched.
+ *
+ * Each zone's temp node is opened once. Zones are sampled from the
+ * looper every interval ms, 2000 by default, and every fast_interval ms,
+ * 250 by default, while one is within two margins of its trip. Touch
+ * boosts and all the held floors are placed again whenever the limits
+ * change; timed boosts, including those of smaller video encodes, keep
+ * their range until they expire.
+ */
+#define THERMAL_INTERVAL_MS 2000
+#define THERMAL_FAST_INTERVAL_MS 250
+
+typedef struct thermal_zone_node {
+    int id;     // N of thermal_zoneN
+    int fd;     // its temp node
+} thermal_zone_node_t;
+
+/* Opens the temp node of every thermal zone of type */
+std::vector<thermal_zone_node_t> thermal_zone_open(const std::string& type);
+/* Reads a temp node, INT_MIN if it fails */
+int thermal_zone_read(int fd);
+
+class ThermalMonitor {
+public:
+    /* Returns NULL if no zone of the policy exists */
+    static ThermalMonitor *create(struct powerhal_info *pInfo, const thermal_policy_t& policy);
+
+    int boostMin(int resource, int min, int top);
+    void dump(std::string& out);
+
+private:
+    class SampleTask : public TimeoutPoker::Task {
+    public:
+        SampleTask(ThermalMonitor *monitor) : monitor(monitor) {}
+        virtual void run() { monitor->sample(); }
+    private:
+        ThermalMonitor *monitor;
+    };
+
+    struct Zone {
+        const thermal_zone_policy_t *policy;
+        int id;
+        int fd;
+        // Last reading, INT_MIN if it failed, guarded by mLock
+        int temp;
+    };
+
+    ThermalMonitor(struct powerhal_info *pInfo, const thermal_policy_t& policy);
+
+    void sample();
+
+    struct powerhal_info *mInfo;
+    const thermal_policy_t mPolicy;
+    std::vector<Zone> mZones;
+
+    // Limits in effect, guarded by mLock
+    Mutex mLock;
+    int mScale;
+    int mCaps[THERMAL_RESOURCE_COUNT];
+    bool mFast;
+};
+
+#endif  // POWER_HAL_THERMAL_H
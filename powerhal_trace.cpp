@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "powerHAL::trace"
+
+#include <algorithm>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "powerhal_trace.h"
+#include "powerhal_utils.h"
+#include "timeoutpoker.h"
+
+static Mutex trace_lock;
+static trace_header_t *trace_header;
+static trace_record_t *trace_records;
+
+void trace_open(void)
+{
+    int records = property_get_int32(POWERHAL_TRACE_RECORDS_PROP,
+                                     POWERHAL_TRACE_DEFAULT_RECORDS);
+    size_t size;
+    void *map;
+    int fd;
+
+    if (records <= 0)
+        return;
+
+    size = sizeof(trace_header_t) + records * sizeof(trace_record_t);
+
+    // Keep what the previous instance recorded up to its exit
+    rename(root_path(POWERHAL_TRACE_PATH).c_str(),
+           root_path(POWERHAL_TRACE_PATH ".prev").c_str());
+
+    fd = root_open(POWERHAL_TRACE_PATH, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        ALOGE("Error opening %s: %s\n", POWERHAL_TRACE_PATH, strerror(errno));
+        return;
+    }
+
+    if (ftruncate(fd, size)) {
+        ALOGE("Error sizing %s: %s\n", POWERHAL_TRACE_PATH, strerror(errno));
+        close(fd);
+        return;
+    }
+
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ALOGE("Error mapping %s: %s\n", POWERHAL_TRACE_PATH, strerror(errno));
+        return;
+    }
+
+    Mutex::Autolock _l(trace_lock);
+    trace_header = static_cast<trace_header_t*>(map);
+    trace_header->version = POWERHAL_TRACE_VERSION;
+    trace_header->capacity = records;
+    trace_header->record_size = sizeof(trace_record_t);
+    trace_header->count = 0;
+    trace_header->magic = POWERHAL_TRACE_MAGIC;
+    trace_records = reinterpret_cast<trace_record_t*>(trace_header + 1);
+
+    ALOGI("Recording up to %d hints to %s", records, POWERHAL_TRACE_PATH);
+}
+
+void trace_record(trace_event_t event, int32_t hint, const int32_t *data, size_t len)
+{
+    Mutex::Autolock _l(trace_lock);
+
+    if (!trace_header)
+        return;
+
+    trace_record_t *r = &trace_records[trace_header->count % trace_header->capacity];
+    size_t kept = std::min(len, (size_t)POWERHAL_TRACE_MAX_DATA);
+
+    r->time_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    r->event = event;
+    r->len = std::min(len, (size_t)UINT16_MAX);
+    r->hint = hint;
+    if (kept)
+        memcpy(r->data, data, kept * sizeof(int32_t));
+    memset(r->data + kept, 0, (POWERHAL_TRACE_MAX_DATA - kept) * sizeof(int32_t));
+
+    // Publish the record only once it is complete
+    __atomic_store_n(&trace_header->count, trace_header->count + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_TRACE_H
+#define POWER_HAL_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hint trace recorder. Every call into the HAL is appended to a ring
+ * buffer mapped from POWERHAL_TRACE_PATH, so the trace survives a crash
+ * and can be pulled off the device and fed to powerhal_replay. The trace
+ * of the previous HAL instance is kept at POWERHAL_TRACE_PATH ".prev".
+ *
+ * Recording is off unless POWERHAL_TRACE_RECORDS_PROP sets the number of
+ * records to keep, e.g. 4096.
+ */
+#define POWERHAL_TRACE_PATH             "/data/vendor/powerhal/hints.trace"
+#define POWERHAL_TRACE_RECORDS_PROP     "persist.vendor.powerhal.trace_records"
+#define POWERHAL_TRACE_DEFAULT_RECORDS  0
+
+#define POWERHAL_TRACE_MAGIC    0x52544850  /* "PHTR" */
+#define POWERHAL_TRACE_VERSION  1
+// Ints of hint data kept per record, longer data is truncated
+#define POWERHAL_TRACE_MAX_DATA 28
+
+typedef enum {
+    TRACE_POWER_HINT = 1,       // IPower::powerHint, one int of data
+    TRACE_POWER_HINT_EXT,       // IPower::powerHintExt
+    TRACE_SET_INTERACTIVE,      // IPower::setInteractive, data[0] is on
+} trace_event_t;
+
+typedef struct trace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;      // records in the ring
+    uint32_t record_size;
+    // Records ever written. The oldest record is at count % capacity once
+    // the ring has wrapped.
+    uint64_t count;
+} trace_header_t;
+
+typedef struct trace_record {
+    int64_t time_ns;        // CLOCK_MONOTONIC
+    uint16_t event;         // trace_event_t
+    uint16_t len;           // ints of data passed in, before truncation
+    int32_t hint;
+    int32_t data[POWERHAL_TRACE_MAX_DATA];
+} trace_record_t;
+
+void trace_open(void);
+void trace_record(trace_event_t event, int32_t hint, const int32_t *data, size_t len);
+
+#endif  // POWER_HAL_TRACE_H
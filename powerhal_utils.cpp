@@ -17,12 +17,19 @@
 #define LOG_TAG "powerHAL::common"
 
 #include "powerhal_utils.h"
+#include <algorithm>
+#include <atomic>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #define INTERACTIVE_GOVERNOR "interactive"
 #define SCHEDUTIL_GOVERNOR "schedutil"
 
+#ifndef POWERHAL_ROOT
+#define POWERHAL_ROOT ""
+#endif
+
 const char* scaling_gov_path[8] = {"/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor",
                                    "/sys/devices/system/cpu/cpu1/cpufreq/scaling_governor",
                                    "/sys/devices/system/cpu/cpu2/cpufreq/scaling_governor",
@@ -32,11 +39,69 @@ const char* scaling_gov_path[8] = {"/sys/devices/system/cpu/cpu0/cpufreq/scaling
                                    "/sys/devices/system/cpu/cpu6/cpufreq/scaling_governor",
                                    "/sys/devices/system/cpu/cpu7/cpufreq/scaling_governor"};
 
+static const std::string& root_dir(void)
+{
+    static const std::string root = [] {
+        const char *env = getenv(POWERHAL_ROOT_ENV);
+        std::string dir(env ? env : POWERHAL_ROOT);
+
+        // "/" and "" both mean the real root
+        while (!dir.empty() && dir.back() == '/')
+            dir.pop_back();
+        if (!dir.empty())
+            ALOGI("Using %s as filesystem root", dir.c_str());
+        return dir;
+    }();
+
+    return root;
+}
+
+std::string root_path(const char *path)
+{
+    return root_dir() + path;
+}
+
+int root_open(const char *path, int flags, mode_t mode)
+{
+    if (root_dir().empty())
+        return open(path, flags, mode);
+
+    return open(root_path(path).c_str(), flags, mode);
+}
+
+int root_access(const char *path, int mode)
+{
+    if (root_dir().empty())
+        return access(path, mode);
+
+    return access(root_path(path).c_str(), mode);
+}
+
+// Virtual time, or -1 while on the monotonic clock
+static std::atomic<nsecs_t> virtual_time(-1);
+
+nsecs_t powerhal_time()
+{
+    nsecs_t now = virtual_time.load();
+
+    return now < 0 ? systemTime(SYSTEM_TIME_MONOTONIC) : now;
+}
+
+void powerhal_set_virtual_time(nsecs_t now)
+{
+    virtual_time.store(std::max(now, (nsecs_t)0));
+}
+
+bool powerhal_virtual_clock()
+{
+    return virtual_time.load() >= 0;
+}
+
 void sysfs_write(const char *path, const char *s)
 {
     char buf[80];
     int len;
-    int fd = open(path, O_WRONLY);
+    int fd = root_open(path, O_WRONLY);
 
     if (fd < 0) {
         strerror_r(errno, buf, sizeof(buf));
@@ -55,7 +120,7 @@ void sysfs_write(const char *path, const char *s)
 void sysfs_read(const char *path, char *s, int size)
 {
     int len;
-    int fd = open(path, O_RDONLY);
+    int fd = root_open(path, O_RDONLY);
 
     if (fd < 0) {
         strerror_r(errno, s, size);
@@ -78,7 +143,7 @@ void sysfs_read(const char *path, char *s, int size)
 bool sysfs_exists(const char *path)
 {
     bool val;
-    int fd = open(path, O_RDONLY);
+    int fd = root_open(path, O_RDONLY);
 
     val = fd < 0 ? false : true;
     close(fd);
@@ -27,11 +27,34 @@
 #include <fcntl.h>
 #include <dlfcn.h>
 
+#include <string>
+
 #include <utils/Log.h>
+#include <utils/Timers.h>
 #include <cutils/properties.h>
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*(x)))
 
+/* Filesystem root utilities. Every sysfs, device and config path is
+ * resolved below the root, which is "/" unless the POWERHAL_ROOT_ENV
+ * environment variable or the POWERHAL_ROOT build option names another
+ * directory, e.g. a fake tree to run the HAL against on a host. Paths
+ * are stored and logged without the root. */
+#define POWERHAL_ROOT_ENV "POWERHAL_ROOT"
+
+std::string root_path(const char *path);
+int root_open(const char *path, int flags, mode_t mode = 0);
+int root_access(const char *path, int mode);
+
+/* Clock utilities. Timeouts, rate limits and looper tasks read
+ * powerhal_time(), which is the monotonic clock unless a virtual clock
+ * has been set. powerhal_replay runs on a virtual clock, which only
+ * moves when TimeoutPoker::advanceClock() is called, so that a trace
+ * replays the same way every time. */
+nsecs_t powerhal_time();
+void powerhal_set_virtual_time(nsecs_t now);
+bool powerhal_virtual_clock();
+
 /* sysfs utilities */
 void sysfs_write(const char *path, const char *s);
 void sysfs_write_int(const char *path, int value);
@@ -18,6 +18,7 @@
 #include <linux/hdreg.h>
 #include <errno.h>
 #include <cutils/log.h>
+#include "powerhal_utils.h"
 #include "tegra_sata_hal.h"
 
 #define STATUS_SIZE 512
@@ -49,9 +50,9 @@ static int check_node_existence(const char* node)
 {
     int error;
 
-    IF_ERROR_EXIT(access(node, F_OK), ALOGE("HAL: sysfs %s not exist", node));
+    IF_ERROR_EXIT(root_access(node, F_OK), ALOGE("HAL: sysfs %s not exist", node));
 
-    IF_ERROR_EXIT(access(node, R_OK|W_OK), ALOGE("HAL: sysfs %s permission is not proper", node));
+    IF_ERROR_EXIT(root_access(node, R_OK|W_OK), ALOGE("HAL: sysfs %s permission is not proper", node));
 
     return 0;
 
@@ -90,7 +91,7 @@ int hdd_get_temperature(const char* device_node, int *temperature)
     args[2] = SMART_READ_LOG_SECTOR; /* FEATURE */
     args[3] = 0x1;                   /* NSECTOR */
 
-    IF_ERROR_EXIT(open(device_node, O_RDONLY | O_NONBLOCK), ALOGE("HAL: Failed to open %s", device_node));
+    IF_ERROR_EXIT(root_open(device_node, O_RDONLY | O_NONBLOCK), ALOGE("HAL: Failed to open %s", device_node));
     fd = error;
 
     IF_ERROR_EXIT(tegra_sata_hal_ioctl(fd, HDIO_DRIVE_CMD, args), ALOGE("HAL: Ioctl failed in %s", device_node));
@@ -129,7 +130,7 @@ int hdd_set_standby_timer(int timer_sec)
 
     /* Implement this function base on RTPM */
     /* Setp1: Set power control to be "auto"*/
-    IF_ERROR_EXIT(open(POWER_CONTROL_PATH, O_WRONLY), ALOGE("HAL: Failed to open %s", POWER_CONTROL_PATH));
+    IF_ERROR_EXIT(root_open(POWER_CONTROL_PATH, O_WRONLY), ALOGE("HAL: Failed to open %s", POWER_CONTROL_PATH));
     fd = error;
 
     IF_ERROR_EXIT(write(fd, VALUE_AUTO, strlen(VALUE_AUTO)), ALOGE("HAL: Failed to set %s , fd=%d, returned '%s'(%d)", POWER_CONTROL_PATH, fd, strerror(errno), errno));
@@ -137,7 +138,7 @@ int hdd_set_standby_timer(int timer_sec)
     fd = -1;
 
     /* Step2: Set suspend delay time */
-    IF_ERROR_EXIT(open(AUTO_SUSPEND_DELAY_PATH, O_WRONLY), ALOGE("HAL: Failed to open %s", AUTO_SUSPEND_DELAY_PATH));
+    IF_ERROR_EXIT(root_open(AUTO_SUSPEND_DELAY_PATH, O_WRONLY), ALOGE("HAL: Failed to open %s", AUTO_SUSPEND_DELAY_PATH));
     fd = error;
 
     IF_ERROR_EXIT(write(fd, buf, strlen(buf)), ALOGE("HAL: Failed to set %s , fd=%d, returned '%s'(%d)", AUTO_SUSPEND_DELAY_PATH, fd, strerror(errno), errno));
@@ -145,7 +146,7 @@ int hdd_set_standby_timer(int timer_sec)
     fd = -1;
 
     /* Step3: Set host power control to be "auto"*/
-    IF_ERROR_EXIT(open(HOST_CONTROL_PATH, O_WRONLY), ALOGE("HAL: Failed to open %s", HOST_CONTROL_PATH));
+    IF_ERROR_EXIT(root_open(HOST_CONTROL_PATH, O_WRONLY), ALOGE("HAL: Failed to open %s", HOST_CONTROL_PATH));
     fd = error;
 
     IF_ERROR_EXIT(write(fd, VALUE_AUTO, strlen(VALUE_AUTO)), ALOGE("HAL: Failed to set %s , fd=%d, returned '%s'(%d)", HOST_CONTROL_PATH, fd, strerror(errno), errno));
@@ -167,7 +168,7 @@ int hdd_disable_standby_timer()
 
     /* Implement this function base on RTPM */
     /* Setp1: Set power control to be "on" */
-    fd = open(POWER_CONTROL_PATH, O_WRONLY);
+    fd = root_open(POWER_CONTROL_PATH, O_WRONLY);
     if (fd < 0) {
         ALOGE("HAL: Failed to open %s", POWER_CONTROL_PATH);
         return -1;
@@ -181,7 +182,7 @@ int hdd_disable_standby_timer()
     close(fd);
 
     /* Step2: Set host power control to be "on" */
-    fd = open(HOST_CONTROL_PATH, O_WRONLY);
+    fd = root_open(HOST_CONTROL_PATH, O_WRONLY);
     if (fd < 0) {
         ALOGE("HAL: Failed to open %s", HOST_CONTROL_PATH);
         return -1;
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POWER_HAL_TESTS_FAKE_ROOT_H
+#define POWER_HAL_TESTS_FAKE_ROOT_H
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "powerhal.h"
+
+/*
+ * Fake filesystem root for the host tests and benchmarks, see
+ * root_path(). Paths passed to the helpers are the device paths the HAL
+ * uses, resolved below the fake root.
+ */
+
+/* Makes an empty fake root and points POWERHAL_ROOT at it. Has to run
+ * before the HAL resolves its first path. */
+static inline std::string fake_root_create(void)
+{
+    char dir[] = "/tmp/powerhal_root.XXXXXX";
+
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        abort();
+    }
+    setenv(POWERHAL_ROOT_ENV, dir, 1);
+    return dir;
+}
+
+static inline int fake_root_unlink(const char *path, __attribute__((unused)) const struct stat *st,
+                                   __attribute__((unused)) int flag,
+                                   __attribute__((unused)) struct FTW *ftw)
+{
+    return remove(path);
+}
+
+static inline void fake_root_destroy(const std::string& root)
+{
+    nftw(root.c_str(), fake_root_unlink, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/* Creates the parent directories of path */
+static inline void fake_root_mkdirs(const char *path)
+{
+    std::string dir = root_path(path);
+
+    for (size_t i = dir.find('/', 1); i != std::string::npos; i = dir.find('/', i + 1))
+        mkdir(dir.substr(0, i).c_str(), 0755);
+}
+
+static inline void fake_root_write(const char *path, const std::string& contents)
+{
+    fake_root_mkdirs(path);
+    std::ofstream(root_path(path), std::ofstream::trunc) << contents;
+}
+
+static inline std::string fake_root_read(const char *path)
+{
+    std::ostringstream contents;
+
+    contents << std::ifstream(root_path(path)).rdbuf();
+    return contents.str();
+}
+
+/* Makes path a link to target, e.g. /dev/null for a node whose writes
+ * are of no interest */
+static inline void fake_root_link(const char *path, const char *target)
+{
+    fake_root_mkdirs(path);
+    unlink(root_path(path).c_str());
+    symlink(target, root_path(path).c_str());
+}
+
+/* One cluster with a frequency table and the PM QoS nodes of T210,
+ * which take every write and keep none of them */
+static inline void fake_root_add_board(void)
+{
+    fake_root_write("/sys/devices/system/cpu/cpu0/cpufreq/scaling_available_frequencies",
+                    "204000 408000 612000 816000 1020000 1224000 1428000 1632000 1912500\n");
+    fake_root_link(PMQOS_CONSTRAINT_CPU_FREQ, "/dev/null");
+    fake_root_link(PMQOS_CONSTRAINT_GPU_FREQ, "/dev/null");
+    fake_root_link(PMQOS_CONSTRAINT_ONLINE_CPUS, "/dev/null");
+    fake_root_link("/dev/emc_freq_min", "/dev/null");
+}
+
+#endif  // POWER_HAL_TESTS_FAKE_ROOT_H
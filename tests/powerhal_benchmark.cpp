@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host benchmarks of the hint engine:
+ *
+ *   powerhal_benchmark [--benchmark_filter=regex]
+ *
+ * The HAL runs against a fake tree with one CPU cluster and the T210
+ * constraint nodes, which are links to /dev/null, so a hint costs the
+ * same syscalls as on a device. It runs on a virtual clock, so work the
+ * service hands to its looper runs inline and is counted. Hints are
+ * spaced HINT_STEP_MS apart on that clock, which lets timed boosts expire
+ * as they would on a device, and rate limits are cleared where a
+ * benchmark wants every hint to get through.
+ */
+#define LOG_TAG "powerhal_benchmark"
+
+#include <benchmark/benchmark.h>
+
+#include "fake_root.h"
+#include "powerhal.h"
+#include "powerhal_config_cache.h"
+#include "powerhal_parser.h"
+
+using ::vendor::nvidia::hardware::power::V1_0::AppProfileKnob;
+
+#define BENCHMARK_XML           "/vendor/etc/powerhal.benchmark.xml"
+#define HINT_STEP_MS            10
+
+static const char benchmark_xml[] = R"(<powerhal>
+  <boot_boost time="15000"/>
+  <cpu_cluster>
+    <available_freqs path="/sys/devices/system/cpu/cpu0/cpufreq/scaling_available_frequencies"/>
+    <pmqos_constraint path="/dev/constraint_cpu_freq"/>
+  </cpu_cluster>
+  <hints>
+    <hint name="INTERACTION">
+      <interval time="90"/>
+      <cpu min="1020000" duration="2000"/>
+      <gpu min="384000" duration="2000"/>
+      <online_cpus min="2" duration="2000"/>
+    </hint>
+    <hint name="APP_LAUNCH">
+      <interval time="1500"/>
+      <cpu min="1912500" duration="2500"/>
+      <gpu min="614400" duration="2500"/>
+      <emc min="800000" duration="2500"/>
+      <online_cpus min="4" duration="2500"/>
+    </hint>
+    <hint name="MULTITHREAD_BOOST">
+      <cpu min="1224000" duration="1000"/>
+      <online_cpus min="4" duration="1000"/>
+    </hint>
+    <hint name="DISPLAY_ROTATION">
+      <interval time="200"/>
+      <cpu min="1428000" duration="1500"/>
+    </hint>
+    <hint name="CAMERA">
+      <cpu min="816000"/>
+      <gpu min="307200"/>
+      <emc min="408000"/>
+    </hint>
+    <hint name="VIDEO_ENCODE">
+      <cpu min="1020000"/>
+      <emc min="600000"/>
+    </hint>
+  </hints>
+  <governor_profiles governor="interactive"
+                     path="/sys/devices/system/cpu/cpufreq/interactive">
+    <profile mode="max_perf">
+      <tunable name="hispeed_freq" value="1428000"/>
+      <tunable name="target_loads" value="65"/>
+      <tunable name="above_hispeed_delay" value="20000"/>
+    </profile>
+    <profile mode="opt_perf">
+      <tunable name="hispeed_freq" value="1224000"/>
+      <tunable name="target_loads" value="80"/>
+      <tunable name="above_hispeed_delay" value="40000"/>
+    </profile>
+    <profile mode="bat_save">
+      <tunable name="hispeed_freq" value="816000"/>
+      <tunable name="target_loads" value="90"/>
+      <tunable name="above_hispeed_delay" value="80000"/>
+    </profile>
+  </governor_profiles>
+  <power_floor>
+    <supply name="whitelisted" prop="persist.vendor.power.brick">
+      <supply_id prefix="PBTEST"/>
+      <supply_id prefix="PB" min="1706" max="9999"/>
+    </supply>
+    <floor_state supply="whitelisted">
+      <cpu_freq min="1100000" max="1912500"/>
+      <gpu_freq min="384000"/>
+    </floor_state>
+  </power_floor>
+  <thermal_policy interval="2000" fast_interval="250">
+    <thermal_zone type="CPU-therm" trip="95000" margin="10000" scale="50"
+                  cpu_cap="1428000"/>
+    <thermal_zone type="GPU-therm" trip="95000" margin="10000" scale="60"
+                  gpu_cap="614400"/>
+  </thermal_policy>
+  <fan_curve zone="thermal-fan-est" interval="2000" hysteresis="3000" slew="16">
+    <fan_point temp="45000" pwm="0"/>
+    <fan_point temp="60000" pwm="70"/>
+    <fan_point temp="80000" pwm="255"/>
+  </fan_curve>
+</powerhal>
+)";
+
+static struct powerhal_info *hal;
+
+/* Frees a powerhal_info filled by the parser along with the strings it
+ * copied, the way a reloaded config is freed */
+static void free_info(struct powerhal_info *pInfo)
+{
+    for (auto &dev : pInfo->input_devs)
+        free(const_cast<char*>(dev.dev_name));
+    for (auto &cluster : pInfo->cpu_clusters) {
+        free(const_cast<char*>(cluster.pmqos_constraint_path));
+        free(const_cast<char*>(cluster.available_freqs_path));
+    }
+    delete pInfo;
+}
+
+/* Runs the timeouts due by the next hint */
+static void hint_step(void)
+{
+    hal->mTimeoutPoker->advanceClock(powerhal_time() + ms2ns(HINT_STEP_MS));
+}
+
+static void BM_PowerHint(benchmark::State& state, ExtPowerHint hint)
+{
+    int data = 0;
+
+    for (auto _ : state) {
+        hal->hint_time[hint] = 0;
+        common_power_hint(hal, hint, &data, 1);
+        hint_step();
+    }
+}
+BENCHMARK_CAPTURE(BM_PowerHint, interaction, ExtPowerHint::INTERACTION);
+BENCHMARK_CAPTURE(BM_PowerHint, app_launch, ExtPowerHint::APP_LAUNCH);
+BENCHMARK_CAPTURE(BM_PowerHint, multithread_boost, ExtPowerHint::MULTITHREAD_BOOST);
+
+/* A hint inside its rate limit, which check_hint() turns away. The clock
+ * stands still so that the limit never runs out. */
+static void BM_CheckHint(benchmark::State& state)
+{
+    int data = 0;
+
+    hal->hint_time[ExtPowerHint::APP_LAUNCH] = 0;
+    common_power_hint(hal, ExtPowerHint::APP_LAUNCH, &data, 1);
+
+    for (auto _ : state)
+        common_power_hint(hal, ExtPowerHint::APP_LAUNCH, &data, 1);
+}
+BENCHMARK(BM_CheckHint);
+
+/* Switches between a profile setting every knob and one leaving them all
+ * at their defaults */
+static void BM_AppProfile(benchmark::State& state)
+{
+    static const int profiles[2][static_cast<int>(AppProfileKnob::APP_PROFILE_COUNT)] = {
+        { 1020000, 80, 2, 614400, 1, 0, 1, 70, 0 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    };
+    int i = 0;
+
+    for (auto _ : state) {
+        hal->hint_time[ExtPowerHint::APP_PROFILE] = 0;
+        common_power_hint(hal, ExtPowerHint::APP_PROFILE, profiles[i],
+                          static_cast<size_t>(AppProfileKnob::APP_PROFILE_COUNT));
+        hint_step();
+        i ^= 1;
+    }
+}
+BENCHMARK(BM_AppProfile);
+
+/* Parses the XML into a fresh powerhal_info, without the config cache */
+static void BM_ParseXml(benchmark::State& state)
+{
+    for (auto _ : state) {
+        state.PauseTiming();
+        struct powerhal_info *pInfo = new powerhal_info();
+        state.ResumeTiming();
+
+        if (parse_xml_file(pInfo, BENCHMARK_XML, false))
+            state.SkipWithError("parse_xml_file failed");
+
+        state.PauseTiming();
+        free_info(pInfo);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_ParseXml);
+
+/* Reads the config the way the service starts, from the XML and saving
+ * the cache when cold, from the cache otherwise */
+static void BM_ConfigInit(benchmark::State& state, bool cached)
+{
+    struct powerhal_info *pInfo = new powerhal_info();
+
+    // Leaves a cache for the cached runs
+    parse_xml_file(pInfo, BENCHMARK_XML, true);
+    free_info(pInfo);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        if (!cached)
+            unlink(root_path(POWERHAL_CONFIG_CACHE_PATH).c_str());
+        pInfo = new powerhal_info();
+        state.ResumeTiming();
+
+        if (parse_xml_file(pInfo, BENCHMARK_XML, true))
+            state.SkipWithError("parse_xml_file failed");
+
+        state.PauseTiming();
+        free_info(pInfo);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK_CAPTURE(BM_ConfigInit, cold, false);
+BENCHMARK_CAPTURE(BM_ConfigInit, cached, true);
+
+int main(int argc, char **argv)
+{
+    std::string root = fake_root_create();
+
+    fake_root_add_board();
+    fake_root_write(BENCHMARK_XML, benchmark_xml);
+    fake_root_mkdirs(POWERHAL_CONFIG_CACHE_PATH);
+
+    powerhal_set_virtual_time(s2ns(1));
+    hal = new powerhal_info();
+    common_power_open(hal);
+    common_power_init(hal);
+
+    benchmark::Initialize(&argc, argv);
+    if (!benchmark::ReportUnrecognizedArguments(argc, argv))
+        benchmark::RunSpecifiedBenchmarks();
+
+    fake_root_destroy(root);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests of what powerhal_check reports for broken configs. The checker
+ * reports whatever the parser rejects through the parser's report hook,
+ * so the configs are parsed here with the same hook, from a fake tree.
+ */
+#define LOG_TAG "powerhal_check_test"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake_root.h"
+#include "powerhal_parser.h"
+
+#define CHECK_XML               "/vendor/etc/powerhal.check.xml"
+
+struct problem {
+    int line;
+    std::string msg;
+};
+
+static std::vector<problem> problems;
+
+static void record_problem(__attribute__((unused)) const char *filename, int line,
+                           const char *msg)
+{
+    problems.push_back({ line, msg });
+}
+
+class CheckTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite()
+    {
+        root = fake_root_create();
+        parse_xml_set_report_hook(record_problem);
+    }
+
+    static void TearDownTestSuite()
+    {
+        parse_xml_set_report_hook(NULL);
+        fake_root_destroy(root);
+    }
+
+    void SetUp() override
+    {
+        problems.clear();
+        pInfo = new powerhal_info();
+    }
+
+    void TearDown() override
+    {
+        for (auto &cluster : pInfo->cpu_clusters) {
+            free(const_cast<char*>(cluster.pmqos_constraint_path));
+            free(const_cast<char*>(cluster.available_freqs_path));
+        }
+        delete pInfo;
+    }
+
+    /* Parses a config whose hints element holds hints */
+    int check(const char *hints)
+    {
+        std::string xml = std::string(R"(<powerhal>
+  <cpu_cluster>
+    <pmqos_constraint path="/dev/constraint_cpu_freq"/>
+  </cpu_cluster>
+  <hints>
+)") + hints + R"(  </hints>
+</powerhal>
+)";
+
+        fake_root_write(CHECK_XML, xml);
+        return parse_xml_file(pInfo, CHECK_XML, false);
+    }
+
+    static std::string root;
+    struct powerhal_info *pInfo;
+};
+
+std::string CheckTest::root;
+
+/* A cpu element with no attributes is reported on its line and sets
+ * nothing */
+TEST_F(CheckTest, CpuWithoutAttributes)
+{
+    ASSERT_EQ(0, check(R"(    <hint name="INTERACTION">
+      <cpu/>
+    </hint>
+)"));
+    ASSERT_EQ(1u, problems.size());
+    EXPECT_EQ(7, problems[0].line);
+    EXPECT_EQ("cpu element has no attributes", problems[0].msg);
+
+    ASSERT_EQ(1u, pInfo->cpu_clusters.size());
+    EXPECT_EQ(0, pInfo->cpu_clusters[0].hints[ExtPowerHint::INTERACTION].min);
+}
+
+/* The same hint with attributes parses cleanly */
+TEST_F(CheckTest, CpuWithAttributes)
+{
+    ASSERT_EQ(0, check(R"(    <hint name="INTERACTION">
+      <cpu cluster="0" min="1020000" duration="2000"/>
+    </hint>
+)"));
+    EXPECT_TRUE(problems.empty());
+
+    ASSERT_EQ(1u, pInfo->cpu_clusters.size());
+    EXPECT_EQ(1020000, pInfo->cpu_clusters[0].hints[ExtPowerHint::INTERACTION].min);
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests of the power cap controller against fake hwmon devices: an
+ * ina3221 whose VDD_IN rail reports volts and amps, and a device with a
+ * powerN_input channel. The budget is set by APP_PROFILE on a virtual
+ * clock, and the caps are read back from backends that record the range
+ * of every resource.
+ */
+#define LOG_TAG "powerhal_powercap_test"
+
+#include <climits>
+#include <map>
+
+#include <gtest/gtest.h>
+
+#include "fake_root.h"
+#include "powerhal_powercap.h"
+
+using ::vendor::nvidia::hardware::power::V1_0::AppProfileKnob;
+
+#define RAIL_MV             5000
+#define SAMPLE_MS           100
+#define MIN_SCALE           30
+#define MIN_CORES           2
+#define GPU_MAX             921600
+
+struct range {
+    int min;
+    int max;
+};
+
+/* Last range applied to each resource, by name */
+static std::map<std::string, range> ranges;
+
+class RecordingBackend : public AggregatedBackend {
+public:
+    RecordingBackend(TimeoutPoker* poker, const std::string& name) :
+        AggregatedBackend(poker, 0, INT_MAX), mName(name) {}
+
+    virtual const char* type() const { return "recording"; }
+    virtual const char* path() const { return mName.c_str(); }
+
+protected:
+    virtual void apply(int min, int max)
+    {
+        ranges[mName] = { min, max };
+    }
+
+private:
+    const std::string mName;
+};
+
+static ResourceBackend* recording_probe(TimeoutPoker* poker, const char* resource,
+                                        __attribute__((unused)) const char* path)
+{
+    return new RecordingBackend(poker, resource);
+}
+
+class PowerCapTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite()
+    {
+        power_cap_config_t *config;
+
+        root = fake_root_create();
+        fake_root_add_board();
+        fake_root_write("/sys/class/hwmon/hwmon0/name", "ina3221\n");
+        fake_root_write("/sys/class/hwmon/hwmon0/in0_label", "VDD_GPU\n");
+        fake_root_write("/sys/class/hwmon/hwmon0/in1_label", "VDD_IN\n");
+        fake_root_write("/sys/class/hwmon/hwmon1/name", "fakepm\n");
+        setRail(0);
+        setInput(0);
+
+        resource_set_probe_hook(recording_probe);
+        powerhal_set_virtual_time(s2ns(1));
+        hal = new powerhal_info();
+        common_power_open(hal);
+
+        config = &hal->power_cap_config;
+        config->interval_ms = SAMPLE_MS;
+        config->deadband = POWER_CAP_DEADBAND;
+        config->min_scale = MIN_SCALE;
+        config->min_cores = MIN_CORES;
+        config->gpu_max = GPU_MAX;
+        config->rails.push_back({ "ina3221", "VDD_IN", -1 });
+        config->rails.push_back({ "fakepm", "", 2 });
+        common_power_init(hal);
+        ASSERT_NE(nullptr, hal->power_cap);
+
+        // Past the boot boost
+        advance(s2ns(30));
+        maxCores = std::max(1, (int)sysconf(_SC_NPROCESSORS_CONF));
+    }
+
+    static void TearDownTestSuite()
+    {
+        fake_root_destroy(root);
+    }
+
+    void SetUp() override
+    {
+        setRail(0);
+        setInput(0);
+        setBudget(0);
+        advance(ms2ns(SAMPLE_MS));
+        uncapped = ranges;
+    }
+
+    /* VDD_IN, in mW */
+    static void setRail(int mw)
+    {
+        fake_root_write("/sys/class/hwmon/hwmon0/in1_input", std::to_string(RAIL_MV));
+        fake_root_write("/sys/class/hwmon/hwmon0/curr1_input",
+                        std::to_string(mw * 1000 / RAIL_MV));
+    }
+
+    /* The powerN_input rail, in mW */
+    static void setInput(int mw)
+    {
+        fake_root_write("/sys/class/hwmon/hwmon1/power2_input", std::to_string(mw * 1000));
+    }
+
+    static void setBudget(int mw)
+    {
+        int profile[static_cast<int>(AppProfileKnob::APP_PROFILE_COUNT)];
+
+        std::fill(profile, profile + static_cast<int>(AppProfileKnob::APP_PROFILE_COUNT), -1);
+        profile[static_cast<int>(AppProfileKnob::APP_PROFILE_PBC_POWER)] = mw;
+        hal->hint_time[ExtPowerHint::APP_PROFILE] = 0;
+        common_power_hint(hal, ExtPowerHint::APP_PROFILE, profile,
+                          static_cast<size_t>(AppProfileKnob::APP_PROFILE_COUNT));
+    }
+
+    static void advance(nsecs_t ns)
+    {
+        hal->mTimeoutPoker->advanceClock(powerhal_time() + ns);
+    }
+
+    /* Runs samples samples of the controller */
+    static void sample(int samples)
+    {
+        advance(ms2ns(samples * SAMPLE_MS));
+    }
+
+    bool capped(const char *resource)
+    {
+        return ranges[resource].max < uncapped[resource].max;
+    }
+
+    static std::string root;
+    static struct powerhal_info *hal;
+    static int maxCores;
+    std::map<std::string, range> uncapped;
+};
+
+std::string PowerCapTest::root;
+struct powerhal_info *PowerCapTest::hal;
+int PowerCapTest::maxCores;
+
+/* Over the budget the frequencies come down to min_scale first */
+TEST_F(PowerCapTest, OverBudgetCapsComeDown)
+{
+    setRail(10000);
+    setBudget(5000);
+
+    // 100% over: half of it off the scale at once
+    sample(0);
+    EXPECT_EQ(816000, ranges["cpu"].max);
+    EXPECT_EQ(GPU_MAX / 2, ranges["gpu"].max);
+    EXPECT_FALSE(capped("online_cpus"));
+
+    sample(1);
+    EXPECT_EQ(408000, ranges["cpu"].max);
+    EXPECT_EQ(GPU_MAX * MIN_SCALE / 100, ranges["gpu"].max);
+    EXPECT_FALSE(capped("online_cpus"));
+}
+
+/* At min_scale the cores go offline, one per sample, down to min_cores.
+ * The controller counts the cores of the host. */
+TEST_F(PowerCapTest, OverBudgetCoresGoOffline)
+{
+    if (maxCores <= MIN_CORES)
+        GTEST_SKIP() << "needs more than " << MIN_CORES << " cores";
+
+    setRail(10000);
+    setBudget(5000);
+    sample(2);
+    EXPECT_EQ(maxCores - 1, ranges["online_cpus"].max);
+
+    sample(maxCores);
+    EXPECT_EQ(408000, ranges["cpu"].max);
+    EXPECT_EQ(MIN_CORES, ranges["online_cpus"].max);
+
+    setBudget(0);
+    EXPECT_FALSE(capped("online_cpus"));
+}
+
+/* Under the budget the cores come back first, then the frequencies, and
+ * every cap is released once back at the top */
+TEST_F(PowerCapTest, UnderBudgetCapsGoBackUp)
+{
+    setRail(10000);
+    setBudget(5000);
+    sample(maxCores + 2);
+    ASSERT_TRUE(capped("cpu"));
+
+    setRail(1000);
+    sample(1);
+    EXPECT_TRUE(capped("cpu"));
+    EXPECT_TRUE(capped("gpu"));
+
+    sample(maxCores + 4);
+    EXPECT_FALSE(capped("cpu"));
+    EXPECT_FALSE(capped("gpu"));
+    EXPECT_FALSE(capped("online_cpus"));
+}
+
+/* Nothing moves within the deadband below the budget */
+TEST_F(PowerCapTest, WithinDeadbandHolds)
+{
+    setRail(4900);
+    setBudget(5000);
+    sample(10);
+    EXPECT_FALSE(capped("cpu"));
+    EXPECT_FALSE(capped("gpu"));
+    EXPECT_FALSE(capped("online_cpus"));
+}
+
+/* A budget of 0 lifts every cap at once and stops sampling */
+TEST_F(PowerCapTest, ZeroBudgetReleases)
+{
+    setRail(10000);
+    setBudget(5000);
+    sample(maxCores + 2);
+    ASSERT_TRUE(capped("cpu"));
+    ASSERT_TRUE(capped("gpu"));
+
+    setBudget(0);
+    EXPECT_FALSE(capped("cpu"));
+    EXPECT_FALSE(capped("gpu"));
+    EXPECT_FALSE(capped("online_cpus"));
+
+    sample(10);
+    EXPECT_FALSE(capped("cpu"));
+}
+
+/* The rails are summed, the powerN_input one read in uW */
+TEST_F(PowerCapTest, RailsAreSummed)
+{
+    setRail(3000);
+    setInput(3000);
+    setBudget(5000);
+    sample(0);
+    EXPECT_TRUE(capped("cpu"));
+
+    setBudget(0);
+    setInput(0);
+    setBudget(5000);
+    sample(10);
+    EXPECT_FALSE(capped("cpu"));
+}
+
+/* A rail missing from the board leaves no controller */
+TEST_F(PowerCapTest, MissingRailHasNoController)
+{
+    power_cap_config_t config = hal->power_cap_config;
+
+    config.interval_ms = SAMPLE_MS;
+    config.rails = { { "ina3221", "VDD_IN", -1 }, { "ina3221", "VDD_CPU", -1 } };
+    EXPECT_EQ(nullptr, PowerCap::create(hal, config));
+
+    config.rails = { { "ina3221x", "", 1 } };
+    EXPECT_EQ(nullptr, PowerCap::create(hal, config));
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stress tests of the timed PM QoS requests held by TimeoutPoker. The
+ * poker runs on a virtual clock against a fake tree whose constraint
+ * nodes are links to /dev/null, and the fds it holds are counted in
+ * /proc/self/fd.
+ */
+#define LOG_TAG "powerhal_stress_test"
+
+#include <dirent.h>
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "fake_root.h"
+#include "timeoutpoker.h"
+
+#define STRESS_REQUESTS     100000
+// Distinct commands per node, more than can be held at once
+#define STRESS_COMMANDS     64
+
+static int count_fds(void)
+{
+    DIR *dir = opendir("/proc/self/fd");
+    struct dirent *ent;
+    int fds = 0;
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] != '.')
+            fds++;
+    }
+    closedir(dir);
+
+    // Not counting the fd of dir itself
+    return fds - 1;
+}
+
+class TimeoutPokerStressTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite()
+    {
+        Barrier readyToRun;
+
+        root = fake_root_create();
+        fake_root_add_board();
+
+        powerhal_set_virtual_time(s2ns(1));
+        poker = new TimeoutPoker(&readyToRun);
+        readyToRun.wait();
+    }
+
+    static void TearDownTestSuite()
+    {
+        fake_root_destroy(root);
+    }
+
+    void SetUp() override
+    {
+        baseFds = count_fds();
+    }
+
+    void TearDown() override
+    {
+        // Let whatever a test left behind expire
+        poker->advanceClock(powerhal_time() + s2ns(60));
+        EXPECT_EQ(baseFds, count_fds());
+    }
+
+    static void request(const char *node, int min, nsecs_t timeout)
+    {
+        poker->requestPmQosTimed(node, PM_QOS_BOOST_PRIORITY, PM_QOS_DEFAULT_VALUE, min,
+                                 timeout);
+    }
+
+    static void advance(nsecs_t ns)
+    {
+        poker->advanceClock(powerhal_time() + ns);
+    }
+
+    static std::string root;
+    static TimeoutPoker *poker;
+    int baseFds;
+};
+
+std::string TimeoutPokerStressTest::root;
+TimeoutPoker *TimeoutPokerStressTest::poker;
+
+/* 10^5 requests 100 us apart on two nodes, each held 50 to 250 ms, so
+ * that thousands overlap. The fds held never exceed the per-node bound,
+ * and every one is closed once the requests have expired. */
+TEST_F(TimeoutPokerStressTest, OverlappingRequestsHoldBoundedFds)
+{
+    const char *nodes[] = { PMQOS_CONSTRAINT_CPU_FREQ, PMQOS_CONSTRAINT_GPU_FREQ };
+    int maxHeld = 0;
+
+    for (int i = 0; i < STRESS_REQUESTS; i++) {
+        request(nodes[i % 2], 100000 + (i % STRESS_COMMANDS) * 1000,
+                ms2ns(50 + i % 201));
+        advance(us2ns(100));
+
+        if (i % 64 == 0)
+            maxHeld = std::max(maxHeld, count_fds() - baseFds);
+    }
+
+    EXPECT_GT(maxHeld, 0);
+    EXPECT_LE(maxHeld, 2 * MAX_TIMED_REQUESTS_PER_NODE);
+
+    advance(ms2ns(250));
+    EXPECT_EQ(baseFds, count_fds());
+}
+
+/* A request is dropped only while its node is saturated */
+TEST_F(TimeoutPokerStressTest, SaturatedNodeAdmitsAgainAfterExpiry)
+{
+    for (int i = 0; i < MAX_TIMED_REQUESTS_PER_NODE; i++)
+        request(PMQOS_CONSTRAINT_CPU_FREQ, 100000 + i, ms2ns(100 + i));
+    EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE, count_fds());
+
+    // Dropped, and other nodes are not affected
+    request(PMQOS_CONSTRAINT_CPU_FREQ, 200000, ms2ns(1000));
+    EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE, count_fds());
+    request(PMQOS_CONSTRAINT_GPU_FREQ, 200000, ms2ns(1000));
+    EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE + 1, count_fds());
+
+    // The first one expires and makes room
+    advance(ms2ns(100));
+    EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE, count_fds());
+    request(PMQOS_CONSTRAINT_CPU_FREQ, 200000, ms2ns(1000));
+    EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE + 1, count_fds());
+}
+
+/* A request is released exactly when its timeout runs out, and an
+ * identical request extends it rather than holding another fd */
+TEST_F(TimeoutPokerStressTest, ExpiresOnTime)
+{
+    request(PMQOS_CONSTRAINT_CPU_FREQ, 100000, ms2ns(100));
+    EXPECT_EQ(baseFds + 1, count_fds());
+
+    advance(ms2ns(50));
+    request(PMQOS_CONSTRAINT_CPU_FREQ, 100000, ms2ns(100));
+    EXPECT_EQ(baseFds + 1, count_fds());
+
+    // Would have expired at 100 ms, now lasts until 150 ms
+    advance(ms2ns(100) - 1);
+    EXPECT_EQ(baseFds + 1, count_fds());
+    advance(1);
+    EXPECT_EQ(baseFds, count_fds());
+}
+
+/* Expiries of many requests land in order, each at its own time */
+TEST_F(TimeoutPokerStressTest, ManyExpiriesOnTime)
+{
+    for (int i = 0; i < MAX_TIMED_REQUESTS_PER_NODE; i++)
+        request(PMQOS_CONSTRAINT_CPU_FREQ, 100000 + i, ms2ns(10 * (i + 1)));
+
+    for (int i = 0; i < MAX_TIMED_REQUESTS_PER_NODE; i++) {
+        advance(ms2ns(10) - 1);
+        EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE - i, count_fds());
+        advance(1);
+        EXPECT_EQ(baseFds + MAX_TIMED_REQUESTS_PER_NODE - i - 1, count_fds());
+    }
+}
@@ -8,7 +8,9 @@
  * documentation without an express license agreement from NVIDIA Corporation
  * is strictly prohibited.
  */
+#include "powerhal_utils.h"
 #include "timeoutpoker.h"
+#include <algorithm>
 #include <fcntl.h>
 
 #undef LOG_TAG
@@ -32,6 +34,11 @@ TimeoutPoker::TimeoutPoker(Barrier* readyToRun)
 //Called usually from IPC thread
 void TimeoutPoker::pushEvent(QueuedEvent* event)
 {
+    if (mPokeHandler->mVirtual) {
+        event->run(mPokeHandler.get());
+        delete event;
+        return;
+    }
     mPokeHandler->sendEventDelayed(0, event);
 }
 
@@ -58,7 +65,7 @@ int TimeoutPoker::PokeHandler::createHandleForFd(int fd)
 
 int TimeoutPoker::PokeHandler::openPmQosNode(const char* filename, int val)
 {
-    int pm_qos_fd = open(filename, O_RDWR);;
+    int pm_qos_fd = root_open(filename, O_RDWR);;
     if (pm_qos_fd < 0) {
         ALOGE("unable to open pm_qos file for %s: %s", filename, strerror(errno));
         return -1;
@@ -69,7 +76,7 @@ int TimeoutPoker::PokeHandler::openPmQosNode(const char* filename, int val)
 
 int TimeoutPoker::PokeHandler::openPmQosNode(const char* filename, int priority, int max, int min)
 {
-    int pm_qos_fd = open(filename, O_RDWR);;
+    int pm_qos_fd = root_open(filename, O_RDWR);;
     if (pm_qos_fd < 0) {
         ALOGE("unable to open pm_qos file for %s: %s", filename, strerror(errno));
         return -1;
@@ -124,7 +131,7 @@ void TimeoutPoker::requestPmQosTimed(const char* filename,
 
 int TimeoutPoker::requestPmQos(const char* filename, int val)
 {
-    int pm_qos_fd = open(filename, O_RDWR);
+    int pm_qos_fd = root_open(filename, O_RDWR);
     if (pm_qos_fd < 0) {
         ALOGE("unable to open pm_qos file for %s: %s", filename, strerror(errno));
         return -1;
@@ -156,7 +163,7 @@ void TimeoutPoker::requestPmQosTimed(const char* filename,
 
 int TimeoutPoker::requestPmQos(const char* filename, int priority, int max, int min)
 {
-    int pm_qos_fd = open(filename, O_RDWR);
+    int pm_qos_fd = root_open(filename, O_RDWR);
     if (pm_qos_fd < 0) {
         ALOGE("unable to open pm_qos file for %s: %s", filename, strerror(errno));
         return -1;
@@ -169,6 +176,53 @@ int TimeoutPoker::requestPmQos(const char* filename, int priority, int max, int
     return pm_qos_fd;
 }
 
+int TimeoutPoker::updatePmQos(int fd, int priority, int max, int min)
+{
+    char command[COMMAND_SIZE];
+    int size = createConstraintCommand((char*)command, COMMAND_SIZE, priority, max, min);
+
+    if (write(fd, command, size) < 0) {
+        ALOGE("unable to update pm_qos request: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void TimeoutPoker::postTaskDelayed(Task* task, nsecs_t delayNs)
+{
+    mPokeHandler->sendEventDelayed(delayNs, new TaskEvent(task));
+}
+
+int TimeoutPoker::watchFd(int fd, int (*callback)(int fd, int events, void* data),
+        void* data)
+{
+    //addFd is threadsafe
+    return mPokeHandler->mWorker->mLooper->addFd(fd, ALOOPER_POLL_CALLBACK,
+            ALOOPER_EVENT_INPUT, callback, data) == 1 ? 0 : -1;
+}
+
+void TimeoutPoker::advanceClock(nsecs_t to)
+{
+    QueuedEvent* e;
+
+    if (!mPokeHandler->mVirtual)
+        return;
+
+    while ((e = mPokeHandler->nextVirtualEvent(to)) != NULL) {
+        e->run(mPokeHandler.get());
+        delete e;
+    }
+    powerhal_set_virtual_time(std::max(to, powerhal_time()));
+}
+
+void TimeoutPoker::dump(std::string& out)
+{
+    Barrier done;
+    pushEvent(new DumpEvent(&out, &done));
+
+    done.wait();
+}
+
 /*
  * PokeHandler
  */
@@ -178,7 +232,26 @@ void TimeoutPoker::PokeHandler::sendEventDelayed(
 
     int key = generateNewKey();
     mQueuedEvents.add(key, ev);
-    mWorker->mLooper->sendMessageDelayed(delay, this, key);
+    if (mVirtual)
+        mVirtualEvents.emplace(powerhal_time() + delay, key);
+    else
+        mWorker->mLooper->sendMessageDelayed(delay, this, key);
+}
+
+// Takes the first virtual event due by to and moves the clock to it
+TimeoutPoker::QueuedEvent*
+TimeoutPoker::PokeHandler::nextVirtualEvent(nsecs_t to) {
+    Mutex::Autolock _l(mEvLock);
+
+    auto next = mVirtualEvents.begin();
+    if (next == mVirtualEvents.end() || next->first > to)
+        return NULL;
+
+    powerhal_set_virtual_time(std::max(next->first, powerhal_time()));
+    TimeoutPoker::QueuedEvent* e = mQueuedEvents.valueFor(next->second);
+    mQueuedEvents.removeItem(next->second);
+    mVirtualEvents.erase(next);
+    return e;
 }
 
 TimeoutPoker::QueuedEvent*
@@ -199,6 +272,7 @@ int TimeoutPoker::PokeHandler::generateNewKey(void)
 }
 
 TimeoutPoker::PokeHandler::PokeHandler(Barrier* readyToRun) :
+    mVirtual(powerhal_virtual_clock()),
     mKey(0)
 {
     mWorker = new LooperThread(readyToRun);
@@ -225,29 +299,127 @@ void TimeoutPoker::PokeHandler::handleMessage(const Message& msg)
 void TimeoutPoker::PokeHandler::openPmQosTimed(const char* filename,
         int val, nsecs_t timeout)
 {
+    std::string command = "=" + std::to_string(val);
+
+    if (extendTimedRequest(filename, command, timeout) || !admitTimedRequest(filename))
+        return;
+
     int fd = openPmQosNode(filename, val);
     if (fd < 0) {
         return;
     }
 
-    sendEventDelayed(timeout, new TimeoutEvent(fd));
+    addTimedRequest(filename, command, fd, timeout);
 }
 
 void TimeoutPoker::PokeHandler::openPmQosTimed(const char* filename,
         int priority, int max, int min,  nsecs_t timeout)
 {
+    char command[COMMAND_SIZE];
+    createConstraintCommand(command, COMMAND_SIZE, priority, max, min);
+
+    if (extendTimedRequest(filename, command, timeout) || !admitTimedRequest(filename))
+        return;
+
     int fd = openPmQosNode(filename, priority, max, min);
     if (fd < 0) {
         return;
     }
 
-    sendEventDelayed(timeout, new TimeoutEvent(fd));
+    addTimedRequest(filename, command, fd, timeout);
+}
+
+// Pushes out the expiry of an identical outstanding request, if any.
+// Its pending TimeoutEvent notices the new expiry and re-arms itself.
+bool TimeoutPoker::PokeHandler::extendTimedRequest(const char* filename,
+        const std::string& command, nsecs_t timeout)
+{
+    auto node = mTimedNodes.find(filename);
+    if (node == mTimedNodes.end())
+        return false;
+
+    auto it = node->second.requests.find(command);
+    if (it == node->second.requests.end())
+        return false;
+
+    it->second.expiry = std::max(it->second.expiry,
+            powerhal_time() + timeout);
+    return true;
 }
 
+bool TimeoutPoker::PokeHandler::admitTimedRequest(const char* filename)
+{
+    TimedNode& node = mTimedNodes[filename];
+
+    if (node.requests.size() < MAX_TIMED_REQUESTS_PER_NODE)
+        return true;
+
+    if (!node.saturated)
+        ALOGW("%s: %d timed requests outstanding, dropping new ones",
+              filename, MAX_TIMED_REQUESTS_PER_NODE);
+    node.saturated = true;
+    return false;
+}
 
-void TimeoutPoker::PokeHandler::timeoutRequest(int fd)
+void TimeoutPoker::PokeHandler::addTimedRequest(const char* filename,
+        const std::string& command, int fd, nsecs_t timeout)
 {
-    close(fd);
+    mTimedNodes[filename].requests[command] = {
+        fd, powerhal_time() + timeout };
+    sendEventDelayed(timeout, new TimeoutEvent(filename, command));
+}
+
+void TimeoutPoker::PokeHandler::timeoutRequest(const std::string& node,
+        const std::string& command)
+{
+    auto n = mTimedNodes.find(node);
+    if (n == mTimedNodes.end())
+        return;
+
+    auto it = n->second.requests.find(command);
+    if (it == n->second.requests.end())
+        return;
+
+    nsecs_t now = powerhal_time();
+    if (it->second.expiry > now) {
+        sendEventDelayed(it->second.expiry - now, new TimeoutEvent(node, command));
+        return;
+    }
+
+    close(it->second.fd);
+    n->second.requests.erase(it);
+    if (n->second.requests.size() < MAX_TIMED_REQUESTS_PER_NODE)
+        n->second.saturated = false;
+}
+
+void TimeoutPoker::PokeHandler::dumpTimedRequests(std::string& out)
+{
+    nsecs_t now = powerhal_time();
+    size_t queued;
+    char line[160];
+
+    {
+        Mutex::Autolock _l(mEvLock);
+        queued = mQueuedEvents.size();
+    }
+
+    snprintf(line, sizeof(line), "Timed requests (%zu looper events queued):\n", queued);
+    out += line;
+
+    for (auto &node : mTimedNodes) {
+        if (node.second.requests.empty())
+            continue;
+
+        snprintf(line, sizeof(line), "  %s%s\n", node.first.c_str(),
+                 node.second.saturated ? " (saturated)" : "");
+        out += line;
+        for (auto &req : node.second.requests) {
+            snprintf(line, sizeof(line), "    fd %-4d \"%s\" expires in %lld ms\n",
+                     req.second.fd, req.first.c_str(),
+                     (long long)ns2ms(std::max(req.second.expiry - now, (nsecs_t)0)));
+            out += line;
+        }
+    }
 }
 
 status_t TimeoutPoker::PokeHandler::LooperThread::readyToRun()
@@ -21,9 +21,14 @@
 #include <utils/Looper.h>
 #include <utils/Log.h>
 
+#include <map>
+#include <string>
+
 #include "barrier.h"
 
 #define COMMAND_SIZE 20
+// Most timed requests held open on one node at a time
+#define MAX_TIMED_REQUESTS_PER_NODE 16
 #define NODE_TYPE_DEFAULT 0
 #define NODE_TYPE_PRIORITY 1
 
@@ -68,9 +73,42 @@ public:
     // Interface for requests with a priority parameter.
     // Uses /dev/constraint_[cpu_freq, onlines_cpus, gpu_freq] sysnodes.
     // Command format: "max min priority timeoutMs"
+    //
+    // Each timed request holds an fd until it times out. A timed request
+    // identical to one still outstanding on the node only extends it, and
+    // at most MAX_TIMED_REQUESTS_PER_NODE distinct ones are held per node;
+    // past that new ones are dropped, so a client flooding boosts cannot
+    // run the service out of fds.
     int createPmQosHandle(const char* filename, int priority, int max, int min);
     int requestPmQos(const char* filename, int priority, int max, int min);
     void requestPmQosTimed(const char* filename, int priority, int max, int min, nsecs_t timeoutNs);
+    // Rewrites the command of a request held open by requestPmQos().
+    int updatePmQos(int fd, int priority, int max, int min);
+
+    // Work to be run on the looper thread. The task is deleted once it
+    // has run.
+    class Task {
+    public:
+        virtual ~Task() {}
+        virtual void run() = 0;
+    };
+    void postTaskDelayed(Task* task, nsecs_t delayNs);
+
+    // Calls callback on the looper thread whenever fd is readable. The
+    // callback returns 1 to keep watching and 0 to stop. Returns 0 on
+    // success.
+    int watchFd(int fd, int (*callback)(int fd, int events, void* data), void* data);
+
+    // On a virtual clock, see powerhal_time(), nothing runs on the looper
+    // thread: events run on the caller, and delayed ones and tasks once
+    // the clock is advanced past them here, in order of their due time.
+    // The clock steps to each one as it runs and ends at to. Does nothing
+    // on the monotonic clock.
+    void advanceClock(nsecs_t to);
+
+    // Appends the outstanding timed requests. The report is built on the
+    // looper thread, which owns them, and the caller waits for it.
+    void dump(std::string& out);
 
 private:
 
@@ -185,14 +223,46 @@ private:
     class TimeoutEvent : public QueuedEvent {
     public:
         virtual ~TimeoutEvent() {}
-        TimeoutEvent(int pmQosFd) : pmQosFd(pmQosFd) {}
+        TimeoutEvent(const std::string& node, const std::string& command) :
+            node(node), command(command) {}
+
+        virtual void run(PokeHandler * const thiz) {
+            thiz->timeoutRequest(node, command);
+        }
+
+    private:
+        const std::string node;
+        const std::string command;
+    };
+
+    class DumpEvent : public QueuedEvent {
+    public:
+        virtual ~DumpEvent() {}
+        DumpEvent(std::string* out, Barrier* done) :
+            out(out), done(done) {}
 
         virtual void run(PokeHandler * const thiz) {
-            thiz->timeoutRequest(pmQosFd);
+            thiz->dumpTimedRequests(*out);
+            done->open();
         }
 
     private:
-        int pmQosFd;
+        std::string* out;
+        Barrier* done;
+    };
+
+    class TaskEvent : public QueuedEvent {
+    public:
+        virtual ~TaskEvent() {}
+        TaskEvent(Task* task) : task(task) {}
+
+        virtual void run(__attribute__((unused)) PokeHandler * const thiz) {
+            task->run();
+            delete task;
+        }
+
+    private:
+        Task* task;
     };
 
     void pushEvent(QueuedEvent* event);
@@ -220,8 +290,13 @@ private:
         void sendEventDelayed(nsecs_t delay, QueuedEvent* ev);
         int listenForHandleToCloseFd(int handle, int fd);
         QueuedEvent* removeEventByKey(int key);
+        QueuedEvent* nextVirtualEvent(nsecs_t to);
         int createHandleForFd(int fd);
-        void timeoutRequest(int fd);
+        void timeoutRequest(const std::string& node, const std::string& command);
+        void dumpTimedRequests(std::string& out);
+
+        // Set if the clock was virtual when the poker was created
+        const bool mVirtual;
 
         void openPmQosTimed(const char* fileName, int val, nsecs_t timeout);
         int createHandleForPmQosRequest(const char* filename, int val);
@@ -232,9 +307,32 @@ private:
         int openPmQosNode(const char* filename, int prioirity, int max, int min);
 
     private:
+        struct TimedRequest {
+            int fd;
+            nsecs_t expiry;
+        };
+
+        struct TimedNode {
+            // Keyed by the command written to the node
+            std::map<std::string, TimedRequest> requests;
+            bool saturated;
+        };
+
+        bool extendTimedRequest(const char* filename, const std::string& command,
+                nsecs_t timeout);
+        bool admitTimedRequest(const char* filename);
+        void addTimedRequest(const char* filename, const std::string& command,
+                int fd, nsecs_t timeout);
+
         int mKey;
 
         mutable Mutex mEvLock;
+
+        // Event keys by due time on a virtual clock, guarded by mEvLock
+        std::multimap<nsecs_t, int> mVirtualEvents;
+
+        // Outstanding timed requests by node, only used on the looper thread
+        std::map<std::string, TimedNode> mTimedNodes;
     };
 
     sp<PokeHandler> mPokeHandler;